@@ -0,0 +1,268 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ragel.h"
+#include "blobgen.h"
+#include "redfsm.h"
+#include <string.h>
+#include <assert.h>
+
+using std::ostream;
+using std::endl;
+
+BlobWriter::BlobWriter( unsigned int numMachines )
+:
+	numMachines(numMachines),
+	nextMachine(0)
+{
+	/* Room for the header and the machines. */
+	long front = sizeof(RlbHeader) + numMachines * sizeof(RlbMachine);
+	data.setAsNew( front );
+	memset( data.data, 0, front );
+}
+
+RlbSection BlobWriter::section( const void *items, long itemSize, long length )
+{
+	while ( data.length() % RLB_ALIGN != 0 )
+		data.append( (char)0 );
+
+	RlbSection section;
+	section.offset = data.length();
+	section.length = length;
+	if ( length > 0 )
+		data.append( (const char*)items, itemSize * length );
+	return section;
+}
+
+void BlobWriter::machine( const RlbMachine &machine )
+{
+	assert( nextMachine < numMachines );
+	long offset = sizeof(RlbHeader) + nextMachine * sizeof(RlbMachine);
+	memcpy( data.data + offset, &machine, sizeof(RlbMachine) );
+	nextMachine += 1;
+}
+
+void BlobWriter::finish( ostream &out )
+{
+	assert( nextMachine == numMachines );
+	while ( data.length() % RLB_ALIGN != 0 )
+		data.append( (char)0 );
+
+	RlbHeader header;
+	header.magic = RLB_MAGIC;
+	header.version = RLB_VERSION;
+	header.numMachines = numMachines;
+	header.fileLength = data.length();
+	memcpy( data.data, &header, sizeof(RlbHeader) );
+
+	out.write( data.data, data.length() );
+}
+
+/* Add a string to the strings of a machine, returning its offset. */
+static uint32_t blobString( Vector<char> &strings, const char *str )
+{
+	uint32_t offset = strings.length();
+	strings.append( str, strlen(str) + 1 );
+	return offset;
+}
+
+void BlobCodeGen::finishRagelDef()
+{
+	/* The actions of scanners are made by ragel and have no name that a
+	 * program could supply the code for. */
+	if ( hasLongestMatch ) {
+		error() << "machine " << fsmName <<
+				": scanners can not be written with --blob" << endl;
+	}
+
+	/* The engine looks up states by id. */
+	redFsm->sortByStateId();
+}
+
+bool BlobCodeGen::writeStatement( InputLoc &loc, int nargs, char **args )
+{
+	/* Nothing is written in place of write statements. The machines are all
+	 * written into the file at the end. */
+	return true;
+}
+
+void BlobCodeGen::writeMachine( BlobWriter &writer )
+{
+	RlbMachine m;
+	memset( &m, 0, sizeof(m) );
+
+	Vector<char> strings;
+	m.name = blobString( strings, fsmName );
+
+	m.minKey = thisKeyOps.minKey.getVal();
+	m.maxKey = thisKeyOps.maxKey.getVal();
+	m.alphSize = thisKeyOps.alphSize();
+	m.keySize = thisKeyOps.alphType->size;
+	m.keySigned = thisKeyOps.isSigned;
+
+	/* The engine needs somewhere to go on the keys no state has a range
+	 * for. If the machine has no error state, one is added after the
+	 * others. The error state is never final. */
+	int numStates = redFsm->stateList.length();
+	int errState = redFsm->errState != 0 ? redFsm->errState->id : numStates;
+	m.numStates = numStates + ( redFsm->errState != 0 ? 0 : 1 );
+	m.startState = redFsm->startState->id;
+	m.firstFinal = redFsm->firstFinState != 0 ?
+			redFsm->firstFinState->id : m.numStates;
+	m.errState = errState;
+
+	/* Action lists go where the table styles put them, shifted by one for
+	 * the empty list at the front. */
+	Vector<uint32_t> actionItems;
+	actionItems.append( 0 );
+	for ( GenActionTableMap::Iter redAct = redFsm->actionMap;
+			redAct.lte(); redAct++ )
+	{
+		assert( redAct->location + 1 == actionItems.length() );
+		actionItems.append( redAct->key.length() );
+		for ( GenActionTable::Iter item = redAct->key; item.lte(); item++ )
+			actionItems.append( item->value->actionId );
+	}
+
+	/* Transitions. */
+	m.numTrans = redFsm->transSet.length();
+	Vector<uint32_t> transTargs, transActions;
+	transTargs.setAsNew( m.numTrans );
+	transActions.setAsNew( m.numTrans );
+	for ( TransApSet::Iter trans = redFsm->transSet; trans.lte(); trans++ ) {
+		assert( trans->id < (int)m.numTrans );
+		transTargs[trans->id] = trans->targ != 0 ? trans->targ->id : errState;
+		transActions[trans->id] = trans->action != 0 ?
+				trans->action->location + 1 : 0;
+	}
+
+	/* States. */
+	Vector<uint32_t> stateRanges, toStateActions, fromStateActions;
+	Vector<uint32_t> eofActions, eofTrans, stateConds;
+	Vector<RlbRange> ranges;
+	Vector<RlbCondRange> condRanges;
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ ) {
+		assert( st->id == stateRanges.length() );
+
+		stateRanges.append( ranges.length() );
+		for ( RedTransList::Iter rtel = st->outRange; rtel.lte(); rtel++ ) {
+			RlbRange range;
+			range.lowKey = rtel->lowKey.getVal();
+			range.highKey = rtel->highKey.getVal();
+			range.trans = rtel->value->id;
+			range.pad = 0;
+			ranges.append( range );
+		}
+
+		stateConds.append( condRanges.length() );
+		for ( GenStateCondList::Iter sc = st->stateCondList; sc.lte(); sc++ ) {
+			RlbCondRange condRange;
+			condRange.lowKey = sc->lowKey.getVal();
+			condRange.highKey = sc->highKey.getVal();
+			condRange.condSpace = sc->condSpace - allCondSpaces;
+			condRange.pad = 0;
+			condRanges.append( condRange );
+		}
+
+		toStateActions.append( st->toStateAction != 0 ?
+				st->toStateAction->location + 1 : 0 );
+		fromStateActions.append( st->fromStateAction != 0 ?
+				st->fromStateAction->location + 1 : 0 );
+		eofActions.append( st->eofAction != 0 ?
+				st->eofAction->location + 1 : 0 );
+		eofTrans.append( st->eofTrans != 0 ? st->eofTrans->id + 1 : 0 );
+	}
+
+	/* The added error state, which has nothing. */
+	if ( redFsm->errState == 0 ) {
+		stateRanges.append( ranges.length() );
+		stateConds.append( condRanges.length() );
+		toStateActions.append( 0 );
+		fromStateActions.append( 0 );
+		eofActions.append( 0 );
+		eofTrans.append( 0 );
+	}
+
+	stateRanges.append( ranges.length() );
+	stateConds.append( condRanges.length() );
+
+	/* Condition spaces. */
+	Vector<RlbCondSpace> condSpaces;
+	Vector<uint32_t> condItems;
+	for ( CondSpaceList::Iter cs = condSpaceList; cs.lte(); cs++ ) {
+		RlbCondSpace condSpace;
+		condSpace.baseKey = cs->baseKey.getVal();
+		condSpace.firstCond = condItems.length();
+		condSpace.numConds = cs->condSet.length();
+		for ( GenCondSet::Iter csi = cs->condSet; csi.lte(); csi++ )
+			condItems.append( (*csi)->actionId );
+		condSpaces.append( condSpace );
+	}
+
+	/* Actions, by id. */
+	Vector<RlbAction> actions;
+	for ( GenActionList::Iter act = actionList; act.lte(); act++ ) {
+		assert( act->actionId == actions.length() );
+		RlbAction action;
+		action.name = blobString( strings, act->nameOrLoc().c_str() );
+		action.pad = 0;
+		actions.append( action );
+	}
+
+	/* Entry points. */
+	Vector<RlbEntry> entries;
+	for ( EntryNameVect::Iter en = entryPointNames; en.lte(); en++ ) {
+		RlbEntry entry;
+		entry.name = blobString( strings, *en );
+		entry.state = allStates[entryPointIds[en.pos()]].id;
+		entries.append( entry );
+	}
+
+	m.stateRanges = writer.section( stateRanges.data,
+			sizeof(uint32_t), stateRanges.length() );
+	m.ranges = writer.section( ranges.data,
+			sizeof(RlbRange), ranges.length() );
+	m.transTargs = writer.section( transTargs.data,
+			sizeof(uint32_t), transTargs.length() );
+	m.transActions = writer.section( transActions.data,
+			sizeof(uint32_t), transActions.length() );
+	m.toStateActions = writer.section( toStateActions.data,
+			sizeof(uint32_t), toStateActions.length() );
+	m.fromStateActions = writer.section( fromStateActions.data,
+			sizeof(uint32_t), fromStateActions.length() );
+	m.eofActions = writer.section( eofActions.data,
+			sizeof(uint32_t), eofActions.length() );
+	m.eofTrans = writer.section( eofTrans.data,
+			sizeof(uint32_t), eofTrans.length() );
+	m.actionItems = writer.section( actionItems.data,
+			sizeof(uint32_t), actionItems.length() );
+	m.actions = writer.section( actions.data,
+			sizeof(RlbAction), actions.length() );
+	m.stateConds = writer.section( stateConds.data,
+			sizeof(uint32_t), stateConds.length() );
+	m.condRanges = writer.section( condRanges.data,
+			sizeof(RlbCondRange), condRanges.length() );
+	m.condSpaces = writer.section( condSpaces.data,
+			sizeof(RlbCondSpace), condSpaces.length() );
+	m.condItems = writer.section( condItems.data,
+			sizeof(uint32_t), condItems.length() );
+	m.entries = writer.section( entries.data,
+			sizeof(RlbEntry), entries.length() );
+	m.strings = writer.section( strings.data, 1, strings.length() );
+
+	writer.machine( m );
+}
@@ -0,0 +1,63 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _BLOBGEN_H
+#define _BLOBGEN_H
+
+#include <iostream>
+#include "gendata.h"
+#include "rlbformat.h"
+#include "vector.h"
+
+/*
+ * Collects the machines of a --blob file. The header and the machines are
+ * kept at the front and filled in when the file is finished.
+ */
+struct BlobWriter
+{
+	BlobWriter( unsigned int numMachines );
+
+	/* Add a section holding length items of itemSize bytes. */
+	RlbSection section( const void *items, long itemSize, long length );
+
+	/* Place a machine, which must be done numMachines times. */
+	void machine( const RlbMachine &machine );
+
+	void finish( std::ostream &out );
+
+	Vector<char> data;
+	unsigned int numMachines;
+	unsigned int nextMachine;
+};
+
+/*
+ * Writes the reduced machine into a --blob file, to be run by the engine in
+ * runtime/. Actions are written as their ids and names only. Their code is
+ * supplied by the program running the machine.
+ */
+class BlobCodeGen : public CodeGenData
+{
+public:
+	BlobCodeGen( ostream &out ) : CodeGenData(out) {}
+
+	virtual void finishRagelDef();
+	virtual bool writeStatement( InputLoc &loc, int nargs, char **args );
+
+	void writeMachine( BlobWriter &writer );
+};
+
+#endif
@@ -0,0 +1,253 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ * 
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA 
+ */
+
+#include "ragel.h"
+#include "cdcgoto.h"
+#include "redfsm.h"
+#include "gendata.h"
+
+std::ostream &ComputedGotoCodeGen::CLASS_MAP()
+{
+	out << '\t';
+	for ( unsigned long long k = 0; k < redFsm->classMapLen; k++ ) {
+		out << redFsm->classMap[k].getVal() - keyOps->minKey.getVal();
+		if ( k < redFsm->classMapLen-1 ) {
+			out << ", ";
+			if ( (k+1) % IALL == 0 )
+				out << "\n\t";
+		}
+	}
+	out << "\n";
+	return out;
+}
+
+/* The label that TRANS_GOTO would jump to. */
+std::ostream &ComputedGotoCodeGen::TRANS_LABEL( RedTransAp *trans )
+{
+	if ( trans->action != 0 )
+		out << "&&tr" << trans->id;
+	else
+		out << "&&st" << trans->targ->id;
+	return out;
+}
+
+/* Dispatch on the class of the current key. The flat rows have been
+ * rewritten over classes, so classes outside the row go to the default. */
+std::ostream &ComputedGotoCodeGen::JUMP_TABLE( RedStateAp *state )
+{
+	out << 
+		"	{\n"
+		"	static void *_jt" << state->id << "[] = {\n"
+		"		";
+
+	long lowClass = 0, highClass = -1;
+	if ( state->transList != 0 ) {
+		lowClass = state->lowKey.getVal() - keyOps->minKey.getVal();
+		highClass = state->highKey.getVal() - keyOps->minKey.getVal();
+	}
+
+	for ( long c = 0; c < redFsm->numClasses; c++ ) {
+		RedTransAp *trans = state->defTrans;
+		if ( lowClass <= c && c <= highClass )
+			trans = state->transList[c - lowClass];
+		else if ( trans == 0 ) {
+			/* The state never sees this class. Any entry will do. */
+			trans = state->transList[0];
+		}
+
+		TRANS_LABEL( trans );
+		if ( c < redFsm->numClasses-1 ) {
+			out << ", ";
+			if ( (c+1) % IALL == 0 )
+				out << "\n\t\t";
+		}
+	}
+
+	out << "\n"
+		"	};\n"
+		"	goto *_jt" << state->id << "[" << CM() << "[" << GET_KEY() << 
+				" - " << KEY(keyOps->minKey) << "]];\n"
+		"	}\n";
+	return out;
+}
+
+std::ostream &ComputedGotoCodeGen::STATE_GOTOS()
+{
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ ) {
+		if ( st == redFsm->errState )
+			STATE_GOTO_ERROR();
+		else {
+			/* Writing code above state gotos. */
+			GOTO_HEADER( st );
+
+			if ( st->stateCondVect.length() == 0 && redFsm->classMap != 0 ) {
+				JUMP_TABLE( st );
+				continue;
+			}
+
+			if ( st->stateCondVect.length() > 0 )
+				emitCondWidec( st );
+
+			/* Try singles. */
+			if ( st->outSingle.length() > 0 )
+				emitSingleSwitch( st );
+
+			/* Default case is to binary search for the ranges, if that fails then */
+			if ( st->outRange.length() > 0 )
+				emitRangeBSearch( st, 1, 0, st->outRange.length() - 1 );
+
+			/* Write the default transition. */
+			TRANS_GOTO( st->defTrans, 1 ) << "\n";
+		}
+	}
+	return out;
+}
+
+void ComputedGotoCodeGen::STATE_CASE( RedStateAp *state )
+{
+	out << "	/* fall through */\n";
+	out << "ent" << state->id << ":\n";
+}
+
+/* Labels to enter each state at, indexed by state id. */
+std::ostream &ComputedGotoCodeGen::ENTRY_TARGS()
+{
+	RedStateAp **byId = new RedStateAp*[redFsm->nextStateId];
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ )
+		byId[st->id] = st;
+
+	out << "\t\t";
+	for ( int id = 0; id < redFsm->nextStateId; id++ ) {
+		if ( byId[id] == redFsm->errState )
+			out << "&&st" << id;
+		else
+			out << "&&ent" << id;
+		if ( id < redFsm->nextStateId-1 ) {
+			out << ", ";
+			if ( (id+1) % IALL == 0 )
+				out << "\n\t\t";
+		}
+	}
+	out << "\n";
+
+	delete[] byId;
+	return out;
+}
+
+std::ostream &ComputedGotoCodeGen::AGAIN_TARGS()
+{
+	out << "\t\t";
+	for ( int id = 0; id < redFsm->nextStateId; id++ ) {
+		out << "&&st" << id;
+		if ( id < redFsm->nextStateId-1 ) {
+			out << ", ";
+			if ( (id+1) % IALL == 0 )
+				out << "\n\t\t";
+		}
+	}
+	out << "\n";
+	return out;
+}
+
+void ComputedGotoCodeGen::writeData()
+{
+	if ( redFsm->classMap != 0 ) {
+		OPEN_ARRAY( ARRAY_TYPE(redFsm->numClasses), CM() );
+		CLASS_MAP();
+		CLOSE_ARRAY() <<
+		"\n";
+	}
+
+	IpGotoCodeGen::writeData();
+}
+
+void ComputedGotoCodeGen::writeExec()
+{
+	/* Must set labels immediately before writing because we may depend on the
+	 * noend write option. */
+	setLabelsNeeded();
+	testEofUsed = false;
+	outLabelUsed = false;
+
+	/* The entry table sends the error state to its label. */
+	if ( redFsm->errState != 0 )
+		redFsm->errState->labelNeeded = true;
+
+	out << "	{\n";
+
+	if ( redFsm->anyRegCurStateRef() )
+		out << "	int _ps = 0;\n";
+
+	if ( redFsm->anyConditions() )
+		out << "	" << WIDE_ALPH_TYPE() << " _widec;\n";
+
+	out <<
+		"	static void *_entry_targs[] = {\n";
+		ENTRY_TARGS() <<
+		"	};\n";
+
+	if ( useAgainLabel() ) {
+		out <<
+			"	static void *_again_targs[] = {\n";
+			AGAIN_TARGS() <<
+			"	};\n";
+	}
+
+	if ( !noEnd ) {
+		testEofUsed = true;
+		out << 
+			"	if ( " << P() << " == " << PE() << " )\n"
+			"		goto _test_eof;\n";
+	}
+
+	if ( useAgainLabel() ) {
+		out << 
+			"	goto _resume;\n"
+			"\n"
+			"_again:\n"
+			"	goto *_again_targs[" << vCS() << "];\n"
+			"\n"
+			"_resume:\n";
+	}
+
+	out << 
+		"	goto *_entry_targs[" << vCS() << "];\n";
+		STATE_GOTOS();
+		EXIT_STATES() << 
+		"\n";
+
+	if ( testEofUsed ) 
+		out << "	_test_eof: {}\n";
+
+	if ( redFsm->anyEofTrans() || redFsm->anyEofActions() ) {
+		out <<
+			"	if ( " << P() << " == " << vEOF() << " )\n"
+			"	{\n"
+			"	switch ( " << vCS() << " ) {\n";
+			FINISH_CASES();
+			SWITCH_DEFAULT() <<
+			"	}\n"
+			"	}\n"
+			"\n";
+	}
+
+	if ( outLabelUsed ) 
+		out << "	_out: {}\n";
+
+	out <<
+		"	}\n";
+}
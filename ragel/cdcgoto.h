@@ -0,0 +1,66 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ * 
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA 
+ */
+
+#ifndef _CDCGOTO_H
+#define _CDCGOTO_H
+
+#include <iostream>
+#include "cdipgoto.h"
+
+/* Forwards. */
+struct CodeGenData;
+
+/*
+ * ComputedGotoCodeGen
+ *
+ * Really fast goto-driven code that dispatches through tables of label
+ * addresses, a GCC and Clang extension. Each state jumps through its own
+ * table, indexed by the character class of the current key. Entering the
+ * machine also jumps through a table indexed by the current state. States
+ * with conditions, and machines whose keys span too much for a class map,
+ * use the -G2 compare trees.
+ */
+class ComputedGotoCodeGen : public IpGotoCodeGen
+{
+public:
+	ComputedGotoCodeGen( ostream &out ) : FsmCodeGen(out), IpGotoCodeGen(out) {}
+
+	std::ostream &CLASS_MAP();
+	std::ostream &TRANS_LABEL( RedTransAp *trans );
+	std::ostream &JUMP_TABLE( RedStateAp *state );
+	std::ostream &STATE_GOTOS();
+	std::ostream &ENTRY_TARGS();
+	std::ostream &AGAIN_TARGS();
+
+	virtual void writeData();
+	virtual void writeExec();
+
+protected:
+	virtual void STATE_CASE( RedStateAp *state );
+};
+
+/*
+ * class CComputedGotoCodeGen
+ */
+struct CComputedGotoCodeGen
+	: public ComputedGotoCodeGen, public CCodeGen
+{
+	CComputedGotoCodeGen( ostream &out ) : 
+		FsmCodeGen(out), ComputedGotoCodeGen(out), CCodeGen(out) {}
+};
+
+#endif
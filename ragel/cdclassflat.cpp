@@ -0,0 +1,70 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ * 
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA 
+ */
+
+#include "ragel.h"
+#include "cdclassflat.h"
+#include "redfsm.h"
+#include "gendata.h"
+
+std::ostream &ClassFlatCodeGen::CLASS_MAP()
+{
+	out << '\t';
+	for ( unsigned long long k = 0; k < redFsm->classMapLen; k++ ) {
+		out << KEY( redFsm->classMap[k] );
+		if ( k < redFsm->classMapLen-1 ) {
+			out << ", ";
+			if ( (k+1) % IALL == 0 )
+				out << "\n\t";
+		}
+	}
+	out << "\n";
+	return out;
+}
+
+void ClassFlatCodeGen::LOCATE_TRANS()
+{
+	if ( redFsm->classMap == 0 ) {
+		FFlatCodeGen::LOCATE_TRANS();
+		return;
+	}
+
+	out <<
+		"	_keys = " << ARR_OFF( K(), "(" + vCS() + "<<1)" ) << ";\n"
+		"	_inds = " << ARR_OFF( I(), IO() + "[" + vCS() + "]" ) << ";\n"
+		"\n"
+		"	_slen = " << SP() << "[" << vCS() << "];\n"
+		"	{\n"
+		"	" << WIDE_ALPH_TYPE() << " _class = " << CM() << "[" << 
+				GET_WIDE_KEY() << " - " << KEY(keyOps->minKey) << "];\n"
+		"	_trans = _inds[ _slen > 0 && _keys[0] <= _class &&\n"
+		"		_class <= _keys[1] ?\n"
+		"		_class - _keys[0] : _slen ];\n"
+		"	}\n"
+		"\n";
+}
+
+void ClassFlatCodeGen::writeData()
+{
+	if ( redFsm->classMap != 0 ) {
+		OPEN_ARRAY( WIDE_ALPH_TYPE(), CM() );
+		CLASS_MAP();
+		CLOSE_ARRAY() <<
+		"\n";
+	}
+
+	FFlatCodeGen::writeData();
+}
@@ -0,0 +1,76 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ * 
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA 
+ */
+
+#ifndef _CDCLASSFLAT_H
+#define _CDCLASSFLAT_H
+
+#include <iostream>
+#include "cdfflat.h"
+
+/* Forwards. */
+struct CodeGenData;
+
+/*
+ * ClassFlatCodeGen
+ *
+ * Fast flat tables indexed by character class. One shared array maps each
+ * key to its class and the per state index runs cover classes instead of
+ * keys. When the keys span too much for a class map the tables are the same
+ * as -F1.
+ */
+class ClassFlatCodeGen : public FFlatCodeGen
+{
+protected:
+	ClassFlatCodeGen( ostream &out ) : FsmCodeGen(out), FFlatCodeGen(out) {}
+
+	std::ostream &CLASS_MAP();
+	virtual void LOCATE_TRANS();
+
+	virtual void writeData();
+};
+
+/*
+ * CClassFlatCodeGen
+ */
+struct CClassFlatCodeGen
+	: public ClassFlatCodeGen, public CCodeGen
+{
+	CClassFlatCodeGen( ostream &out ) : 
+		FsmCodeGen(out), ClassFlatCodeGen(out), CCodeGen(out) {}
+};
+
+/*
+ * DClassFlatCodeGen
+ */
+struct DClassFlatCodeGen
+	: public ClassFlatCodeGen, public DCodeGen
+{
+	DClassFlatCodeGen( ostream &out ) : 
+		FsmCodeGen(out), ClassFlatCodeGen(out), DCodeGen(out) {}
+};
+
+/*
+ * D2ClassFlatCodeGen
+ */
+struct D2ClassFlatCodeGen
+	: public ClassFlatCodeGen, public D2CodeGen
+{
+	D2ClassFlatCodeGen( ostream &out ) : 
+		FsmCodeGen(out), ClassFlatCodeGen(out), D2CodeGen(out) {}
+};
+
+#endif
@@ -25,6 +25,8 @@
 #include "ragel.h"
 #include "redfsm.h"
 #include "gendata.h"
+#include "profile.h"
+#include "mergesort.h"
 #include <sstream>
 #include <string>
 #include <assert.h>
@@ -573,6 +575,152 @@ void FsmCodeGen::CONDITION( ostream &ret, GenAction *condition )
 	INLINE_LIST( ret, condition->inlineList, 0, false, false );
 }
 
+/* Keys counted for each state. States with conditions take their
+ * transitions on the wide keys, which lie above the alphabet. */
+long long FsmCodeGen::INSTRUMENT_SPAN()
+{
+	if ( redFsm->anyConditions() )
+		return keyOps->span( keyOps->minKey, redFsm->maxKey );
+	return keyOps->alphSize();
+}
+
+bool FsmCodeGen::INSTRUMENT_KEYS()
+{
+	return keyOps->alphSize() <= _INSTRUMENT_KEY_LIMIT &&
+			INSTRUMENT_SPAN() <= _INSTRUMENT_WIDE_KEY_LIMIT;
+}
+
+void FsmCodeGen::INSTRUMENT_DATA()
+{
+	if ( !instrument )
+		return;
+
+	int numStates = redFsm->nextStateId;
+	out << 
+		"static unsigned long " << SH() << "[" << numStates << "];\n";
+
+	bool keyHits = INSTRUMENT_KEYS();
+	long long span = INSTRUMENT_SPAN();
+	long long minKey = keyOps->minKey.getLongLong();
+	if ( keyHits ) {
+		out << 
+			"static unsigned long " << KH() << "[" << 
+					numStates * span << "];\n";
+	}
+
+	/* Profiles use the ids given by the frontend. If the states were
+	 * renumbered, write out the way back. */
+	bool renumbered = false;
+	RedStateAp **byId = new RedStateAp*[numStates];
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ ) {
+		byId[st->id] = st;
+		if ( st->id != st->profileId )
+			renumbered = true;
+	}
+
+	string profileId = "s";
+	if ( renumbered ) {
+		out << "static const int " << PI() << "[] = {\n\t";
+		for ( int id = 0; id < numStates; id++ ) {
+			out << byId[id]->profileId;
+			if ( id < numStates - 1 ) {
+				out << ", ";
+				if ( (id+1) % IALL == 0 )
+					out << "\n\t";
+			}
+		}
+		out << "\n};\n";
+		profileId = PI() + "[s]";
+	}
+	delete[] byId;
+
+	/* The program may not call it. Stdio is included at the top of the
+	 * output. */
+	out << 
+		"\n"
+		"#if defined(__GNUC__)\n"
+		"__attribute__((unused))\n"
+		"#endif\n"
+		"static void " << DATA_PREFIX() << "write_profile( FILE *f )\n"
+		"{\n"
+		"	int s, k;\n"
+		"	fprintf( f, \"machine " << fsmName << "\\n\" );\n"
+		"	for ( s = 0; s < " << numStates << "; s++ ) {\n"
+		"		if ( " << SH() << "[s] != 0 ) {\n"
+		"			fprintf( f, \"state %d %lu\\n\", " << profileId << ",\n"
+		"					" << SH() << "[s] );\n"
+		"		}\n";
+
+	if ( keyHits ) {
+		/* The counters are indexed from the lowest key. */
+		ostringstream key;
+		key << "(long) k";
+		if ( minKey < 0 )
+			key << " - " << -minKey;
+		else if ( minKey > 0 )
+			key << " + " << minKey;
+
+		out << 
+			"		for ( k = 0; k < " << span << "; k++ ) {\n"
+			"			if ( " << KH() << "[s * " << span << " + k] != 0 ) {\n"
+			"				fprintf( f, \"trans %d %ld %ld %lu\\n\", " << 
+						profileId << ", " << 
+						key.str() << ", " << key.str() << ",\n"
+			"						" << KH() << "[s * " << span << " + k] );\n"
+			"			}\n"
+			"		}\n";
+	}
+
+	out <<
+		"	}\n"
+		"}\n"
+		"\n";
+}
+
+/* Count the state and the key it is about to take. In machines with
+ * conditions the key is counted once the wide key is known. */
+string FsmCodeGen::INSTRUMENT( const string &state )
+{
+	ostringstream ret;
+	ret << "	" << SH() << "[" << state << "] += 1;\n";
+	if ( !redFsm->anyConditions() )
+		ret << INSTRUMENT_KEY( state, GET_KEY() );
+	return ret.str();
+}
+
+/* The goto styles know which states have conditions. */
+string FsmCodeGen::INSTRUMENT( RedStateAp *state )
+{
+	ostringstream ret;
+	ret << "	" << SH() << "[" << state->id << "] += 1;\n";
+	if ( state->stateCondVect.length() == 0 )
+		ret << INSTRUMENT_KEY( state->id, GET_KEY() );
+	return ret.str();
+}
+
+string FsmCodeGen::INSTRUMENT_KEY( const string &state, const string &key )
+{
+	ostringstream ret;
+	if ( INSTRUMENT_KEYS() ) {
+		long long minKey = keyOps->minKey.getLongLong();
+		ret << "	" << KH() << "[" << state << " * " << INSTRUMENT_SPAN() << 
+				" + " << CAST("int") << key;
+		if ( minKey < 0 )
+			ret << " + " << -minKey;
+		else if ( minKey > 0 )
+			ret << " - " << minKey;
+		ret << "] += 1;\n";
+	}
+	return ret.str();
+}
+
+string FsmCodeGen::INSTRUMENT_KEY( int stateId, const string &key )
+{
+	ostringstream state;
+	state << stateId;
+	return INSTRUMENT_KEY( state.str(), key );
+}
+
 string FsmCodeGen::ERROR_STATE()
 {
 	ostringstream ret;
@@ -667,7 +815,7 @@ void FsmCodeGen::STATE_IDS()
 	if ( !noEntry && entryPointNames.length() > 0 ) {
 		for ( EntryNameVect::Iter en = entryPointNames; en.lte(); en++ ) {
 			STATIC_VAR( "int", DATA_PREFIX() + "en_" + *en ) << 
-					" = " << entryPointIds[en.pos()] << ";\n";
+					" = " << allStates[entryPointIds[en.pos()]].id << ";\n";
 		}
 		out << "\n";
 	}
@@ -765,6 +913,521 @@ void CCodeGen::writeExports()
 	}
 }
 
+/* Orders keys by their class so far, then by where they go from one state. */
+struct CmpKeyClass
+{
+	int compare( int k1, int k2 )
+	{
+		if ( cls[k1] != cls[k2] )
+			return cls[k1] < cls[k2] ? -1 : 1;
+		else if ( row[k1] != row[k2] )
+			return row[k1] < row[k2] ? -1 : 1;
+		else
+			return 0;
+	}
+
+	int *cls, *row;
+};
+
+KeyClassTables::KeyClassTables( RedFsmAp *redFsm, bool stopActions )
+{
+	numStates = redFsm->nextStateId;
+	span = keyOps->alphSize();
+	stopTarg = numStates;
+
+	/* Target of every state and key. A key with no target goes to the error
+	 * state, which only exists when some key has no target. */
+	targs = new int[numStates * span];
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ ) {
+		bool stopState = stopActions && ( st->fromStateAction != 0 || 
+				st->stateCondList.length() > 0 );
+
+		Key key = keyOps->minKey;
+		for ( int k = 0; k < span; k++, key.increment() ) {
+			RedTransAp *trans = redFsm->findTrans( st, key );
+			int targ;
+			if ( trans != 0 && trans->targ != 0 )
+				targ = trans->targ->id;
+			else {
+				assert( redFsm->errState != 0 );
+				targ = redFsm->errState->id;
+			}
+
+			if ( stopActions && ( stopState || ( trans != 0 && 
+					( trans->action != 0 || ( trans->targ != 0 && 
+					trans->targ->toStateAction != 0 ) ) ) ) )
+				targ = stopTarg;
+
+			targs[st->id * span + k] = targ;
+		}
+	}
+
+	/* Split the keys into classes that go to the same place from every
+	 * state. Each state refines the classes found so far. */
+	cls = new int[span];
+	int *keys = new int[span];
+	numClasses = 1;
+	for ( int k = 0; k < span; k++ )
+		cls[k] = 0;
+
+	MergeSort<int, CmpKeyClass> mergeSort;
+	for ( int s = 0; s < numStates; s++ ) {
+		for ( int k = 0; k < span; k++ )
+			keys[k] = k;
+
+		mergeSort.cls = cls;
+		mergeSort.row = targs + s * span;
+		mergeSort.sort( keys, span );
+
+		int *newCls = new int[span];
+		numClasses = 0;
+		for ( int k = 0; k < span; k++ ) {
+			if ( k == 0 || mergeSort.compare( keys[k-1], keys[k] ) != 0 )
+				numClasses += 1;
+			newCls[keys[k]] = numClasses - 1;
+		}
+		delete[] cls;
+		cls = newCls;
+	}
+	delete[] keys;
+
+	/* Number the classes by their lowest key. */
+	int *classId = new int[numClasses];
+	classKey = new int[numClasses];
+	for ( int c = 0; c < numClasses; c++ )
+		classId[c] = -1;
+	int nextClass = 0;
+	for ( int k = 0; k < span; k++ ) {
+		if ( classId[cls[k]] < 0 ) {
+			classKey[nextClass] = k;
+			classId[cls[k]] = nextClass++;
+		}
+		cls[k] = classId[cls[k]];
+	}
+	delete[] classId;
+}
+
+KeyClassTables::~KeyClassTables()
+{
+	delete[] targs;
+	delete[] cls;
+	delete[] classKey;
+}
+
+/* The class of a key, as an index into a key class array. */
+string CCodeGen::KEY_CLASS_INDEX( string key )
+{
+	long long minKey = keyOps->minKey.getLongLong();
+	ostringstream ret;
+	ret << "(int)(" << key << ")";
+	if ( minKey < 0 )
+		ret << " + " << -minKey;
+	else if ( minKey > 0 )
+		ret << " - " << minKey;
+	return ret.str();
+}
+
+void CCodeGen::writeKeyClassTables( KeyClassTables &tables, 
+		string clsName, string transName )
+{
+	OPEN_ARRAY( ARRAY_TYPE( tables.numClasses - 1 ), clsName );
+	out << "\t";
+	for ( int k = 0; k < tables.span; k++ ) {
+		out << tables.cls[k];
+		if ( k < tables.span - 1 ) {
+			out << ", ";
+			if ( (k+1) % IALL == 0 )
+				out << "\n\t";
+		}
+	}
+	out << "\n";
+	CLOSE_ARRAY() << "\n";
+
+	int numStates = tables.numStates, numClasses = tables.numClasses;
+	OPEN_ARRAY( ARRAY_TYPE( tables.stopTarg ), transName );
+	out << "\t";
+	for ( int s = 0; s < numStates; s++ ) {
+		for ( int c = 0; c < numClasses; c++ ) {
+			out << tables.targs[s * tables.span + tables.classKey[c]];
+			if ( s < numStates - 1 || c < numClasses - 1 ) {
+				out << ", ";
+				if ( ( s * numClasses + c + 1 ) % IALL == 0 )
+					out << "\n\t";
+			}
+		}
+	}
+	out << "\n";
+	CLOSE_ARRAY() << "\n";
+}
+
+/* Writes a C API that runs the machine over a buffer in chunks, on several
+ * threads. A chunk that does not start the buffer is run from every state at
+ * once, giving a map from the state it starts in to the state it ends in.
+ * Composing the maps gives the state the whole run ends in. The machine must
+ * not have actions or conditions, which the caller checks. */
+void CCodeGen::writeChunks()
+{
+	KeyClassTables tables( redFsm, false );
+	int numStates = tables.numStates;
+	int numClasses = tables.numClasses;
+	string alphType = ALPH_TYPE();
+	string prefix = DATA_PREFIX();
+	string classOf = KEY_CLASS_INDEX();
+
+	out <<
+		"#include <stdlib.h>\n"
+		"#include <pthread.h>\n"
+		"\n";
+
+	writeKeyClassTables( tables, CHC(), CHT() );
+
+	out <<
+		"static int " << prefix << "chunk_run( int cs, const " << alphType << 
+				" *p, const " << alphType << " *pe )\n"
+		"{\n"
+		"	for ( ; p < pe; p++ ) {\n"
+		"		cs = " << CHT() << "[cs * " << numClasses << " + " << 
+				CHC() << "[" << classOf << "]];\n";
+	
+	if ( redFsm->errState != 0 ) {
+		out <<
+			"		if ( cs == " << redFsm->errState->id << " )\n"
+			"			break;\n";
+	}
+
+	out <<
+		"	}\n"
+		"	return cs;\n"
+		"}\n"
+		"\n"
+		"static void " << prefix << "chunk_map( int *map, const " << alphType << 
+				" *p, const " << alphType << " *pe )\n"
+		"{\n"
+		"	int *work = (int*) malloc( sizeof(int) * " << 4 * numStates << " );\n"
+		"	int *active, *next, *slot, *seen, *tmp;\n"
+		"	int nactive = " << numStates << ", nnext, s, i, t, c;\n"
+		"\n"
+		"	if ( work == 0 ) {\n"
+		"		for ( s = 0; s < " << numStates << "; s++ )\n"
+		"			map[s] = " << prefix << "chunk_run( s, p, pe );\n"
+		"		return;\n"
+		"	}\n"
+		"\n"
+		"	active = work;\n"
+		"	next = work + " << numStates << ";\n"
+		"	slot = work + " << 2 * numStates << ";\n"
+		"	seen = work + " << 3 * numStates << ";\n"
+		"	for ( s = 0; s < " << numStates << "; s++ ) {\n"
+		"		active[s] = s;\n"
+		"		map[s] = s;\n"
+		"		seen[s] = -1;\n"
+		"	}\n"
+		"\n"
+		"	/* Step the distinct states together. States that meet share a\n"
+		"	 * slot from then on. */\n"
+		"	for ( ; p < pe && nactive > 1; p++ ) {\n"
+		"		c = " << CHC() << "[" << classOf << "];\n"
+		"		nnext = 0;\n"
+		"		for ( i = 0; i < nactive; i++ ) {\n"
+		"			t = " << CHT() << "[active[i] * " << numClasses << " + c];\n"
+		"			if ( seen[t] < 0 ) {\n"
+		"				seen[t] = nnext;\n"
+		"				next[nnext++] = t;\n"
+		"			}\n"
+		"			slot[i] = seen[t];\n"
+		"		}\n"
+		"		for ( i = 0; i < nnext; i++ )\n"
+		"			seen[next[i]] = -1;\n"
+		"		if ( nnext < nactive ) {\n"
+		"			for ( s = 0; s < " << numStates << "; s++ )\n"
+		"				map[s] = slot[map[s]];\n"
+		"		}\n"
+		"		tmp = active;\n"
+		"		active = next;\n"
+		"		next = tmp;\n"
+		"		nactive = nnext;\n"
+		"	}\n"
+		"\n"
+		"	/* Once all have met, one run finishes the chunk. */\n"
+		"	if ( nactive == 1 )\n"
+		"		active[0] = " << prefix << "chunk_run( active[0], p, pe );\n"
+		"	for ( s = 0; s < " << numStates << "; s++ )\n"
+		"		map[s] = active[map[s]];\n"
+		"	free( work );\n"
+		"}\n"
+		"\n"
+		"struct " << prefix << "chunk_job\n"
+		"{\n"
+		"	int *map;\n"
+		"	const " << alphType << " *p, *pe;\n"
+		"};\n"
+		"\n"
+		"static void *" << prefix << "chunk_thread( void *arg )\n"
+		"{\n"
+		"	struct " << prefix << "chunk_job *job = (struct " << prefix << 
+				"chunk_job*) arg;\n"
+		"	" << prefix << "chunk_map( job->map, job->p, job->pe );\n"
+		"	return 0;\n"
+		"}\n"
+		"\n"
+		"static int " << prefix << "chunk_exec( int cs, const " << alphType << 
+				" *p, const " << alphType << " *pe, int nthreads )\n"
+		"{\n"
+		"	struct " << prefix << "chunk_job *jobs;\n"
+		"	pthread_t *threads;\n"
+		"	int *maps, *started, k;\n"
+		"	long size;\n"
+		"\n"
+		"	if ( nthreads < 2 || pe - p < (long) nthreads * " << 
+				_CHUNK_MIN_SIZE << " )\n"
+		"		return " << prefix << "chunk_run( cs, p, pe );\n"
+		"\n"
+		"	jobs = (struct " << prefix << "chunk_job*) malloc( sizeof(struct " << 
+				prefix << "chunk_job) * nthreads );\n"
+		"	threads = (pthread_t*) malloc( sizeof(pthread_t) * nthreads );\n"
+		"	maps = (int*) malloc( sizeof(int) * " << numStates << " * nthreads );\n"
+		"	started = (int*) malloc( sizeof(int) * nthreads );\n"
+		"	if ( jobs == 0 || threads == 0 || maps == 0 || started == 0 ) {\n"
+		"		free( jobs );\n"
+		"		free( threads );\n"
+		"		free( maps );\n"
+		"		free( started );\n"
+		"		return " << prefix << "chunk_run( cs, p, pe );\n"
+		"	}\n"
+		"\n"
+		"	size = ( pe - p ) / nthreads;\n"
+		"	for ( k = 1; k < nthreads; k++ ) {\n"
+		"		jobs[k].map = maps + k * " << numStates << ";\n"
+		"		jobs[k].p = p + k * size;\n"
+		"		jobs[k].pe = k == nthreads - 1 ? pe : p + ( k + 1 ) * size;\n"
+		"		started[k] = pthread_create( &threads[k], 0, " << 
+				prefix << "chunk_thread, &jobs[k] ) == 0;\n"
+		"		if ( !started[k] )\n"
+		"			" << prefix << "chunk_thread( &jobs[k] );\n"
+		"	}\n"
+		"\n"
+		"	/* The first chunk has a known start, so it runs here. */\n"
+		"	cs = " << prefix << "chunk_run( cs, p, p + size );\n"
+		"	for ( k = 1; k < nthreads; k++ ) {\n"
+		"		if ( started[k] )\n"
+		"			pthread_join( threads[k], 0 );\n"
+		"		cs = jobs[k].map[cs];\n"
+		"	}\n"
+		"\n"
+		"	free( jobs );\n"
+		"	free( threads );\n"
+		"	free( maps );\n"
+		"	free( started );\n"
+		"	return cs;\n"
+		"}\n"
+		"\n";
+}
+
+/* Writes a C API that advances many streams through the machine together.
+ * Each round steps every stream in the lanes by one key, so the table loads
+ * of different streams overlap. A stream leaves its lane at its end, in the
+ * error state, or before a transition that needs actions or conditions. The
+ * caller finishes those with the exec code. Returns the number of streams
+ * that stopped for actions or conditions. */
+void CCodeGen::writeStreams()
+{
+	KeyClassTables tables( redFsm, true );
+	int numClasses = tables.numClasses;
+	string alphType = ALPH_TYPE();
+	string prefix = DATA_PREFIX();
+	string classOf = KEY_CLASS_INDEX();
+
+	writeKeyClassTables( tables, STC(), STT() );
+
+	out <<
+		"struct " << prefix << "stream\n"
+		"{\n"
+		"	int cs;\n"
+		"	const " << alphType << " *p, *pe;\n"
+		"};\n"
+		"\n"
+		"static int " << prefix << "stream_exec( struct " << prefix << 
+				"stream *streams, int nstreams )\n"
+		"{\n"
+		"	struct " << prefix << "stream *lane[" << _STREAM_LANES << "], *s;\n"
+		"	int nlanes = 0, next = 0, stopped = 0, i, cs;\n"
+		"	const " << alphType << " *p, *pe;\n"
+		"\n"
+		"	while ( 1 ) {\n"
+		"		while ( nlanes < " << _STREAM_LANES << " && next < nstreams ) {\n"
+		"			s = &streams[next++];\n"
+		"			if ( s->p < s->pe";
+
+	if ( redFsm->errState != 0 )
+		out << " && s->cs != " << redFsm->errState->id;
+
+	out << " )\n"
+		"				lane[nlanes++] = s;\n"
+		"		}\n"
+		"		if ( nlanes < 2 )\n"
+		"			break;\n"
+		"\n"
+		"		for ( i = 0; i < nlanes; ) {\n"
+		"			s = lane[i];\n"
+		"			p = s->p;\n"
+		"			cs = " << STT() << "[s->cs * " << numClasses << " + " << 
+				STC() << "[" << classOf << "]];\n"
+		"			if ( cs == " << tables.stopTarg << " ) {\n"
+		"				stopped += 1;\n"
+		"				lane[i] = lane[--nlanes];\n"
+		"				continue;\n"
+		"			}\n"
+		"			s->cs = cs;\n";
+
+	if ( redFsm->errState != 0 ) {
+		out <<
+			"			if ( cs == " << redFsm->errState->id << " )\n"
+			"				lane[i] = lane[--nlanes];\n"
+			"			else ";
+	}
+	else {
+		out << "			";
+	}
+
+	out <<
+		"if ( ++s->p == s->pe )\n"
+		"				lane[i] = lane[--nlanes];\n"
+		"			else\n"
+		"				i += 1;\n"
+		"		}\n"
+		"	}\n"
+		"\n"
+		"	/* The last stream runs alone. */\n"
+		"	if ( nlanes == 1 ) {\n"
+		"		s = lane[0];\n"
+		"		cs = s->cs;\n"
+		"		pe = s->pe;\n"
+		"		for ( p = s->p; p < pe; p++ ) {\n"
+		"			i = " << STT() << "[cs * " << numClasses << " + " << 
+				STC() << "[" << classOf << "]];\n"
+		"			if ( i == " << tables.stopTarg << " ) {\n"
+		"				stopped += 1;\n"
+		"				break;\n"
+		"			}\n"
+		"			cs = i;\n";
+
+	if ( redFsm->errState != 0 ) {
+		out <<
+			"			if ( cs == " << redFsm->errState->id << " )\n"
+			"				break;\n";
+	}
+
+	out <<
+		"		}\n"
+		"		s->cs = cs;\n"
+		"		s->p = p;\n"
+		"	}\n"
+		"	return stopped;\n"
+		"}\n"
+		"\n";
+}
+
+/* Writes a C API that steps the machine two keys at a time through a table
+ * over pairs of key classes, halving the dependent loads per key. A pair
+ * that needs actions or conditions, or that ends in the error state, is
+ * taken one key at a time. The run stops at the end, in the error state, or
+ * before a transition that needs actions or conditions, and returns where it
+ * stopped. The caller finishes with the exec code from there. */
+void CCodeGen::writeStride()
+{
+	KeyClassTables tables( redFsm, true );
+	int numStates = tables.numStates;
+	int numClasses = tables.numClasses;
+	int stopTarg = tables.stopTarg;
+	int errId = redFsm->errState != 0 ? redFsm->errState->id : -1;
+	string alphType = ALPH_TYPE();
+	string prefix = DATA_PREFIX();
+
+	writeKeyClassTables( tables, SDC(), SDT() );
+
+	bool pairs = (long long)numStates * numClasses * numClasses <= 
+			_STRIDE_MAX_PAIRS;
+	if ( pairs ) {
+		OPEN_ARRAY( ARRAY_TYPE( stopTarg ), SDP() );
+		out << "\t";
+		long long total = (long long)numStates * numClasses * numClasses;
+		long long n = 0;
+		for ( int s = 0; s < numStates; s++ ) {
+			for ( int c1 = 0; c1 < numClasses; c1++ ) {
+				int mid = tables.targs[s * tables.span + tables.classKey[c1]];
+				for ( int c2 = 0; c2 < numClasses; c2++ ) {
+					int targ = stopTarg;
+					if ( mid != stopTarg && mid != errId ) {
+						targ = tables.targs[mid * tables.span + 
+								tables.classKey[c2]];
+						if ( targ == errId )
+							targ = stopTarg;
+					}
+
+					out << targ;
+					if ( ++n < total ) {
+						out << ", ";
+						if ( n % IALL == 0 )
+							out << "\n\t";
+					}
+				}
+			}
+		}
+		out << "\n";
+		CLOSE_ARRAY() << "\n";
+	}
+
+	out <<
+		"static const " << alphType << " *" << prefix << "stride_exec( "
+				"int *pcs, const " << alphType << " *p, const " << 
+				alphType << " *pe )\n"
+		"{\n"
+		"	int cs = *pcs, t;\n"
+		"\n"
+		"	while ( p < pe ) {\n";
+
+	if ( pairs ) {
+		out <<
+			"		if ( p + 1 < pe ) {\n"
+			"			t = " << SDP() << "[( cs * " << numClasses << " + " << 
+					SDC() << "[" << KEY_CLASS_INDEX( "p[0]" ) << "] ) * " << 
+					numClasses << " + " << SDC() << "[" << 
+					KEY_CLASS_INDEX( "p[1]" ) << "]];\n"
+			"			if ( t != " << stopTarg << " ) {\n"
+			"				cs = t;\n"
+			"				p += 2;\n"
+			"				continue;\n"
+			"			}\n"
+			"		}\n"
+			"\n";
+	}
+	else {
+		out <<
+			"		/* The pair table would be too large for this machine. */\n";
+	}
+
+	out <<
+		"		t = " << SDT() << "[cs * " << numClasses << " + " << 
+				SDC() << "[" << KEY_CLASS_INDEX() << "]];\n"
+		"		if ( t == " << stopTarg << " )\n"
+		"			break;\n"
+		"		cs = t;\n";
+
+	if ( redFsm->errState != 0 ) {
+		out <<
+			"		if ( cs == " << errId << " )\n"
+			"			break;\n";
+	}
+
+	out <<
+		"		p += 1;\n"
+		"	}\n"
+		"	*pcs = cs;\n"
+		"	return p;\n"
+		"}\n"
+		"\n";
+}
+
 /*
  * D Specific
  */
@@ -954,39 +1617,132 @@ void D2CodeGen::ACTION( ostream &ret, GenAction *action, int targState,
  * End D2-specific code.
  */
 
+void FsmCodeGen::orderStates()
+{
+	if ( stateOrder == StateOrderBfs )
+		redFsm->breadthFirstOrdering();
+	else if ( stateOrder == StateOrderAffinity )
+		redFsm->affinityOrdering();
+	else if ( redFsm->profiled )
+		redFsm->profileOrdering();
+	else
+		redFsm->depthFirstOrdering();
+}
+
 void FsmCodeGen::finishRagelDef()
 {
+	/* Load any hit counts recorded for the machine. The state ids in the
+	 * profile are the ones given by the frontend, so this comes first. */
+	ProfileMachine *profile = findProfile( fsmName );
+	if ( profile != 0 && !redFsm->applyProfile( profile ) ) {
+		warning( sectionLoc ) << "profile " << profileUseFile << 
+				" does not match machine " << fsmName << 
+				", it may be out of date" << endl;
+	}
+
 	if ( codeStyle == GenGoto || codeStyle == GenFGoto || 
-			codeStyle == GenIpGoto || codeStyle == GenSplit )
+			codeStyle == GenIpGoto || codeStyle == GenComputedGoto || 
+			codeStyle == GenTailCall || codeStyle == GenHybrid || 
+			codeStyle == GenSplit )
 	{
 		/* For directly executable machines there is no required state
-		 * ordering. Choose a depth-first ordering to increase the
-		 * potential for fall-throughs. */
-		redFsm->depthFirstOrdering();
+		 * ordering. Unless asked otherwise, choose a depth-first ordering
+		 * to increase the potential for fall-throughs, following the hot
+		 * paths when there is a profile. */
+		orderStates();
+	}
+	else if ( stateOrder != StateOrderDefault ) {
+		/* Tables are indexed by state id. Renumber the states in the order
+		 * asked for so that states used together share cache lines. */
+		orderStates();
+		redFsm->listStateIds();
 	}
 	else {
 		/* The frontend will do this for us, but it may be a good idea to
 		 * force it if the intermediate file is edited. */
 		redFsm->sortByStateId();
+
+		/* Tables are indexed by state id. Renumbering puts the rows of the
+		 * hot states next to each other. */
+		if ( redFsm->profiled )
+			redFsm->profileStateIds();
 	}
 
-	/* Choose default transitions and the single transition. */
-	redFsm->chooseDefaultSpan();
+	/* Choose default transitions and the single transition. Goto styles
+	 * with a profile keep a hot transition out of the default when the
+	 * compare tree can reach it sooner. */
+	if ( redFsm->profiled && ( codeStyle == GenGoto || 
+			codeStyle == GenFGoto || codeStyle == GenIpGoto || 
+			codeStyle == GenComputedGoto || codeStyle == GenTailCall || 
+			codeStyle == GenSplit ) )
+		redFsm->chooseDefaultProfile();
+	else
+		redFsm->chooseDefaultSpan();
 		
 	/* Maybe do flat expand, otherwise choose single. */
-	if ( codeStyle == GenFlat || codeStyle == GenFFlat )
+	if ( codeStyle == GenFlat || codeStyle == GenFFlat || 
+			codeStyle == GenClassFlat || codeStyle == GenDenseFlat ||
+			codeStyle == GenCombTables )
 		redFsm->makeFlat();
-	else
+	else if ( codeStyle == GenHybrid )
+		redFsm->chooseHybrid();
+	else {
+		/* The computed goto jump tables are built from the flat rows, over
+		 * character classes. States that cannot use them need singles. */
+		if ( codeStyle == GenComputedGoto && 
+				keyOps->alphSize() <= _CLASS_MAP_LIMIT ) {
+			redFsm->makeFlat();
+			if ( !redFsm->makeFlatClasses() ) {
+				warning( sectionLoc ) << "the keys of " << fsmName << 
+						" with conditions span more than " << _CLASS_MAP_LIMIT << 
+						", -G3 is testing every state with compare trees" << endl;
+			}
+		}
+
+		/* With -G3 only the states left out of the jump tables take
+		 * bitmaps, all of them when the keys are too wide for classes. */
+		if ( rangeBitmaps && ( codeStyle == GenGoto || 
+				codeStyle == GenFGoto || codeStyle == GenIpGoto || 
+				codeStyle == GenComputedGoto ) ) {
+			redFsm->chooseRangeBitmaps();
+		}
+
+		if ( switchDensity > 0 && ( codeStyle == GenGoto || 
+				codeStyle == GenFGoto || codeStyle == GenIpGoto || 
+				codeStyle == GenComputedGoto || codeStyle == GenTailCall || 
+				codeStyle == GenSplit ) )
+			redFsm->chooseKeySwitches( switchDensity );
+
 		redFsm->chooseSingle();
+	}
+
+	/* The skip loops scan the input directly, so they need plain bytes. */
+	if ( ( skipLoops || prefilter ) && hostLang->lang == HostLang::C && 
+			( codeStyle == GenGoto || codeStyle == GenFGoto || 
+			codeStyle == GenIpGoto || codeStyle == GenComputedGoto || 
+			codeStyle == GenHybrid ) &&
+			keyOps->alphType->size == 1 && getKeyExpr == 0 )
+		redFsm->findSkipLoops( skipLoops, prefilter );
+
+	if ( codeStyle == GenClassFlat ) {
+		if ( !redFsm->makeFlatClasses() ) {
+			warning( sectionLoc ) << "the keys of " << fsmName << 
+					" span more than " << _CLASS_MAP_LIMIT << 
+					", writing -F1 tables in place of -F2" << endl;
+		}
+	}
+	else if ( codeStyle == GenCombTables )
+		redFsm->packComb();
 
 	/* If any errors have occured in the input file then don't write anything. */
 	if ( gblErrorCount > 0 )
 		return;
 	
 	if ( codeStyle == GenSplit )
-		redFsm->partitionFsm( numSplitPartitions );
+		redFsm->partitionFsm( numSplitPartitions, partitionSize );
 
-	if ( codeStyle == GenIpGoto || codeStyle == GenSplit )
+	if ( codeStyle == GenIpGoto || codeStyle == GenComputedGoto || 
+			codeStyle == GenHybrid || codeStyle == GenSplit )
 		redFsm->setInTrans();
 
 	/* Anlayze Machine will find the final action reference counts, among
@@ -36,6 +36,23 @@ using std::ostream;
 /* Integer array line length. */
 #define IALL 8
 
+/* Alphabets up to this size get an instrumentation counter for every state
+ * and key, larger ones only for every state. With conditions the counters
+ * cover the wide keys, which may span up to the second limit. */
+#define _INSTRUMENT_KEY_LIMIT 256
+#define _INSTRUMENT_WIDE_KEY_LIMIT 4096
+
+/* Buffers shorter than this per thread are not worth splitting by write
+ * chunks. */
+#define _CHUNK_MIN_SIZE 65536
+
+/* Number of streams write streams advances together. */
+#define _STREAM_LANES 8
+
+/* Largest pair table write stride emits, in entries. Machines with more
+ * states and key classes step one key at a time. */
+#define _STRIDE_MAX_PAIRS 262144
+
 /* Forwards. */
 struct RedFsmAp;
 struct RedStateAp;
@@ -50,6 +67,27 @@ struct LongestMatchPart;
 
 string itoa( int i );
 
+/* The transitions of every state over classes of keys that go to the same
+ * place from every state. With stopActions, keys that need actions or
+ * conditions go to stopTarg instead. */
+struct KeyClassTables
+{
+	KeyClassTables( RedFsmAp *redFsm, bool stopActions );
+	~KeyClassTables();
+
+	int numStates;
+	int span;
+	int numClasses;
+	int stopTarg;
+
+	/* Target of every state and key, by state id then key. */
+	int *targs;
+
+	/* Class of every key, and the lowest key of every class. */
+	int *cls;
+	int *classKey;
+};
+
 /*
  * class FsmCodeGen
  */
@@ -125,6 +163,23 @@ protected:
 	string EA() { return "_" + DATA_PREFIX() + "eof_actions"; }
 	string ET() { return "_" + DATA_PREFIX() + "eof_trans"; }
 	string SP() { return "_" + DATA_PREFIX() + "key_spans"; }
+	string CM() { return "_" + DATA_PREFIX() + "char_class"; }
+	string IC() { return "_" + DATA_PREFIX() + "index_checks"; }
+	string DI() { return "_" + DATA_PREFIX() + "default_indicies"; }
+	string DT() { return "_" + DATA_PREFIX() + "dense_trans"; }
+	string PF() { return "_" + DATA_PREFIX() + "prefilter"; }
+	string HI() { return "_" + DATA_PREFIX() + "hybrid_index"; }
+	string RB() { return "_" + DATA_PREFIX() + "range_bits"; }
+	string SH() { return "_" + DATA_PREFIX() + "state_hits"; }
+	string KH() { return "_" + DATA_PREFIX() + "key_hits"; }
+	string PI() { return "_" + DATA_PREFIX() + "profile_ids"; }
+	string CHC() { return "_" + DATA_PREFIX() + "chunk_class"; }
+	string CHT() { return "_" + DATA_PREFIX() + "chunk_trans"; }
+	string STC() { return "_" + DATA_PREFIX() + "stream_class"; }
+	string STT() { return "_" + DATA_PREFIX() + "stream_trans"; }
+	string SDC() { return "_" + DATA_PREFIX() + "stride_class"; }
+	string SDT() { return "_" + DATA_PREFIX() + "stride_trans"; }
+	string SDP() { return "_" + DATA_PREFIX() + "stride_pairs"; }
 	string CSP() { return "_" + DATA_PREFIX() + "cond_key_spans"; }
 	string START() { return DATA_PREFIX() + "start"; }
 	string ERROR() { return DATA_PREFIX() + "error"; }
@@ -159,6 +214,16 @@ protected:
 			int targState, bool inFinish, bool csForced );
 	void STATE_IDS();
 
+	/* Counters for --instrument and the function that writes them out in
+	 * the form read by --profile-use. */
+	long long INSTRUMENT_SPAN();
+	bool INSTRUMENT_KEYS();
+	void INSTRUMENT_DATA();
+	string INSTRUMENT( const string &state );
+	string INSTRUMENT( RedStateAp *state );
+	string INSTRUMENT_KEY( const string &state, const string &key );
+	string INSTRUMENT_KEY( int stateId, const string &key );
+
 	string ERROR_STATE();
 	string FIRST_FINAL_STATE();
 
@@ -182,6 +247,9 @@ protected:
 
 	void genLineDirective( ostream &out );
 
+	/* Put the state list in the order given by --state-order. */
+	void orderStates();
+
 public:
 	/* Determine if we should use indicies. */
 	virtual void calcIndexSize() {}
@@ -206,6 +274,13 @@ public:
 	virtual string CTRL_FLOW();
 
 	virtual void writeExports();
+	virtual void writeChunks();
+	virtual void writeStreams();
+	virtual void writeStride();
+
+	string KEY_CLASS_INDEX( string key = "*p" );
+	void writeKeyClassTables( KeyClassTables &tables, 
+			string clsName, string transName );
 };
 
 class DCodeGen : virtual public FsmCodeGen
@@ -0,0 +1,79 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ * 
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA 
+ */
+
+#ifndef _CDCOMB_H
+#define _CDCOMB_H
+
+#include <iostream>
+#include "cdfflat.h"
+
+/* Forwards. */
+struct CodeGenData;
+
+/*
+ * CombCodeGen
+ *
+ * Fast flat tables with the rows of all states overlaid in one index array.
+ * Each state's row keeps only the keys that do not take its default
+ * transition and is displaced to where it fits among the other rows. A check
+ * array records which state owns each slot.
+ */
+class CombCodeGen : public FFlatCodeGen
+{
+protected:
+	CombCodeGen( ostream &out ) : FsmCodeGen(out), FFlatCodeGen(out) {}
+
+	std::ostream &COMB_BASES();
+	std::ostream &COMB_NEXT();
+	std::ostream &COMB_CHECK();
+	std::ostream &COMB_DEFAULTS();
+	virtual void LOCATE_TRANS();
+
+	virtual void writeData();
+};
+
+/*
+ * CCombCodeGen
+ */
+struct CCombCodeGen
+	: public CombCodeGen, public CCodeGen
+{
+	CCombCodeGen( ostream &out ) : 
+		FsmCodeGen(out), CombCodeGen(out), CCodeGen(out) {}
+};
+
+/*
+ * DCombCodeGen
+ */
+struct DCombCodeGen
+	: public CombCodeGen, public DCodeGen
+{
+	DCombCodeGen( ostream &out ) : 
+		FsmCodeGen(out), CombCodeGen(out), DCodeGen(out) {}
+};
+
+/*
+ * D2CombCodeGen
+ */
+struct D2CombCodeGen
+	: public CombCodeGen, public D2CodeGen
+{
+	D2CombCodeGen( ostream &out ) : 
+		FsmCodeGen(out), CombCodeGen(out), D2CodeGen(out) {}
+};
+
+#endif
@@ -0,0 +1,413 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ragel.h"
+#include "cdcxxtable.h"
+#include "redfsm.h"
+#include "gendata.h"
+#include <string.h>
+
+std::ostream &CxxTabCodeGen::OPEN_ARRAY( string type, string name )
+{
+	out << "static constexpr " << type << " " << name << "[] = {\n";
+	return out;
+}
+
+std::ostream &CxxTabCodeGen::STATIC_VAR( string type, string name )
+{
+	out << "static constexpr " << type << " " << name;
+	return out;
+}
+
+void CxxTabCodeGen::writeExports()
+{
+	if ( exportList.length() > 0 ) {
+		for ( ExportList::Iter ex = exportList; ex.lte(); ex++ ) {
+			STATIC_VAR( ALPH_TYPE(), DATA_PREFIX() + "ex_" + ex->name ) <<
+					" = " << KEY(ex->key) << ";\n";
+		}
+		out << "\n";
+	}
+}
+
+/* Jump back into the engine, which goes to the test for eof if the jump is
+ * made by an eof action at the end of the input. */
+void CxxTabCodeGen::JUMP( ostream &ret, bool inFinish )
+{
+	if ( inFinish && !noEnd )
+		ret << "if ( " << P() << " == " << PE() << " ) return RlExecTestEof; ";
+
+	ret << "return RlExecAgain;";
+}
+
+void CxxTabCodeGen::GOTO( ostream &ret, int gotoDest, bool inFinish )
+{
+	ret << "{" << vCS() << " = " << gotoDest << "; ";
+	JUMP( ret, inFinish );
+	ret << "}";
+}
+
+void CxxTabCodeGen::GOTO_EXPR( ostream &ret, GenInlineItem *ilItem, bool inFinish )
+{
+	ret << "{" << vCS() << " = (";
+	INLINE_LIST( ret, ilItem->children, 0, inFinish, false );
+	ret << "); ";
+	JUMP( ret, inFinish );
+	ret << "}";
+}
+
+void CxxTabCodeGen::CURS( ostream &ret, bool inFinish )
+{
+	ret << "(_ps)";
+}
+
+void CxxTabCodeGen::CALL( ostream &ret, int callDest, int targState, bool inFinish )
+{
+	if ( prePushExpr != 0 ) {
+		ret << "{";
+		INLINE_LIST( ret, prePushExpr, 0, false, false );
+	}
+
+	ret << "{" << STACK() << "[" << TOP() << "++] = " << vCS() << "; " <<
+			vCS() << " = " << callDest << "; ";
+	JUMP( ret, inFinish );
+	ret << "}";
+
+	if ( prePushExpr != 0 )
+		ret << "}";
+}
+
+void CxxTabCodeGen::CALL_EXPR( ostream &ret, GenInlineItem *ilItem, int targState, bool inFinish )
+{
+	if ( prePushExpr != 0 ) {
+		ret << "{";
+		INLINE_LIST( ret, prePushExpr, 0, false, false );
+	}
+
+	ret << "{" << STACK() << "[" << TOP() << "++] = " << vCS() << "; " <<
+			vCS() << " = (";
+	INLINE_LIST( ret, ilItem->children, targState, inFinish, false );
+	ret << "); ";
+	JUMP( ret, inFinish );
+	ret << "}";
+
+	if ( prePushExpr != 0 )
+		ret << "}";
+}
+
+void CxxTabCodeGen::RET( ostream &ret, bool inFinish )
+{
+	ret << "{" << vCS() << " = " << STACK() << "[--" << TOP() << "]; ";
+
+	if ( postPopExpr != 0 ) {
+		ret << "{";
+		INLINE_LIST( ret, postPopExpr, 0, false, false );
+		ret << "} ";
+	}
+
+	JUMP( ret, inFinish );
+	ret << "}";
+}
+
+void CxxTabCodeGen::BREAK( ostream &ret, int targState, bool csForced )
+{
+	ret << "{" << P() << "++; return RlExecBreak; }";
+}
+
+/* The engine finds the conditions of a space by its id. For each id there is
+ * the base of its wide keys and the range of its conditions, given as action
+ * ids. */
+void CxxTabCodeGen::COND_SPACE_TABLES()
+{
+	int numSpaces = redFsm->maxCondSpaceId + 1;
+	GenCondSpace **spaces = new GenCondSpace*[numSpaces];
+	memset( spaces, 0, sizeof(GenCondSpace*) * numSpaces );
+	for ( CondSpaceList::Iter csi = condSpaceList; csi.lte(); csi++ )
+		spaces[csi->condSpaceId] = csi;
+
+	OPEN_ARRAY( WIDE_ALPH_TYPE(), "cond_space_base" );
+	out << '\t';
+	for ( int id = 0; id < numSpaces; id++ ) {
+		if ( spaces[id] != 0 )
+			out << KEY( spaces[id]->baseKey );
+		else
+			out << 0;
+		out << ", ";
+		if ( ( id + 1 ) % IALL == 0 )
+			out << "\n\t";
+	}
+	out << 0 << "\n";
+	CLOSE_ARRAY() <<
+	"\n";
+
+	OPEN_ARRAY( "int", "cond_space_offsets" );
+	out << '\t';
+	int offset = 0;
+	for ( int id = 0; id < numSpaces; id++ ) {
+		out << offset << ", ";
+		if ( spaces[id] != 0 )
+			offset += spaces[id]->condSet.length();
+		if ( ( id + 1 ) % IALL == 0 )
+			out << "\n\t";
+	}
+	out << offset << "\n";
+	CLOSE_ARRAY() <<
+	"\n";
+
+	OPEN_ARRAY( ARRAY_TYPE(actionList.length()), "cond_space_conds" );
+	out << '\t';
+	int totalConds = 0;
+	for ( int id = 0; id < numSpaces; id++ ) {
+		if ( spaces[id] == 0 )
+			continue;
+		for ( GenCondSet::Iter csi = spaces[id]->condSet; csi.lte(); csi++ ) {
+			out << (*csi)->actionId << ", ";
+			if ( ++totalConds % IALL == 0 )
+				out << "\n\t";
+		}
+	}
+	out << 0 << "\n";
+	CLOSE_ARRAY() <<
+	"\n";
+
+	delete[] spaces;
+}
+
+void CxxTabCodeGen::writeData()
+{
+	out <<
+		"struct " << MACHINE() << "\n"
+		"{\n"
+		"typedef " << ALPH_TYPE() << " key_type;\n"
+		"typedef " << WIDE_ALPH_TYPE() << " wide_key_type;\n"
+		"\n";
+
+	STATIC_VAR( "bool", "has_actions" ) << " = " <<
+			( redFsm->anyRegActions() ? "true" : "false" ) << ";\n";
+	STATIC_VAR( "bool", "has_to_state_actions" ) << " = " <<
+			( redFsm->anyToStateActions() ? "true" : "false" ) << ";\n";
+	STATIC_VAR( "bool", "has_from_state_actions" ) << " = " <<
+			( redFsm->anyFromStateActions() ? "true" : "false" ) << ";\n";
+	STATIC_VAR( "bool", "has_eof_actions" ) << " = " <<
+			( redFsm->anyEofActions() ? "true" : "false" ) << ";\n";
+	STATIC_VAR( "bool", "has_eof_trans" ) << " = " <<
+			( redFsm->anyEofTrans() ? "true" : "false" ) << ";\n";
+	STATIC_VAR( "bool", "has_conds" ) << " = " <<
+			( redFsm->anyConditions() ? "true" : "false" ) << ";\n";
+	STATIC_VAR( "bool", "has_indicies" ) << " = " <<
+			( useIndicies ? "true" : "false" ) << ";\n";
+	STATIC_VAR( "bool", "has_error" ) << " = " <<
+			( redFsm->errState != 0 ? "true" : "false" ) << ";\n";
+	out << "\n";
+
+	STATIC_VAR( "key_type", "min_key" ) << " = " << KEY(keyOps->minKey) << ";\n";
+	STATIC_VAR( "long long", "alph_size" ) << " = " << keyOps->alphSize() << ";\n";
+	STATIC_VAR( "int", "start" ) << " = " << START_STATE_ID() << ";\n";
+	STATIC_VAR( "int", "first_final" ) << " = " << FIRST_FINAL_STATE() << ";\n";
+	STATIC_VAR( "int", "error" ) << " = " << ERROR_STATE() << ";\n";
+	out << "\n";
+
+	if ( redFsm->anyActions() ) {
+		OPEN_ARRAY( ARRAY_TYPE(redFsm->maxActArrItem), "actions" );
+		ACTIONS_ARRAY();
+		CLOSE_ARRAY() <<
+		"\n";
+	}
+
+	if ( redFsm->anyConditions() ) {
+		OPEN_ARRAY( ARRAY_TYPE(redFsm->maxCondOffset), "cond_offsets" );
+		COND_OFFSETS();
+		CLOSE_ARRAY() <<
+		"\n";
+
+		OPEN_ARRAY( ARRAY_TYPE(redFsm->maxCondLen), "cond_lengths" );
+		COND_LENS();
+		CLOSE_ARRAY() <<
+		"\n";
+
+		OPEN_ARRAY( WIDE_ALPH_TYPE(), "cond_keys" );
+		COND_KEYS();
+		CLOSE_ARRAY() <<
+		"\n";
+
+		OPEN_ARRAY( ARRAY_TYPE(redFsm->maxCondSpaceId), "cond_spaces" );
+		COND_SPACES();
+		CLOSE_ARRAY() <<
+		"\n";
+
+		COND_SPACE_TABLES();
+	}
+
+	OPEN_ARRAY( ARRAY_TYPE(redFsm->maxKeyOffset), "key_offsets" );
+	KEY_OFFSETS();
+	CLOSE_ARRAY() <<
+	"\n";
+
+	OPEN_ARRAY( WIDE_ALPH_TYPE(), "trans_keys" );
+	KEYS();
+	CLOSE_ARRAY() <<
+	"\n";
+
+	OPEN_ARRAY( ARRAY_TYPE(redFsm->maxSingleLen), "single_lengths" );
+	SINGLE_LENS();
+	CLOSE_ARRAY() <<
+	"\n";
+
+	OPEN_ARRAY( ARRAY_TYPE(redFsm->maxRangeLen), "range_lengths" );
+	RANGE_LENS();
+	CLOSE_ARRAY() <<
+	"\n";
+
+	OPEN_ARRAY( ARRAY_TYPE(redFsm->maxIndexOffset), "index_offsets" );
+	INDEX_OFFSETS();
+	CLOSE_ARRAY() <<
+	"\n";
+
+	if ( useIndicies ) {
+		OPEN_ARRAY( ARRAY_TYPE(redFsm->maxIndex), "indicies" );
+		INDICIES();
+		CLOSE_ARRAY() <<
+		"\n";
+
+		OPEN_ARRAY( ARRAY_TYPE(redFsm->maxState), "trans_targs" );
+		TRANS_TARGS_WI();
+		CLOSE_ARRAY() <<
+		"\n";
+
+		if ( redFsm->anyActions() ) {
+			OPEN_ARRAY( ARRAY_TYPE(redFsm->maxActionLoc), "trans_actions" );
+			TRANS_ACTIONS_WI();
+			CLOSE_ARRAY() <<
+			"\n";
+		}
+	}
+	else {
+		OPEN_ARRAY( ARRAY_TYPE(redFsm->maxState), "trans_targs" );
+		TRANS_TARGS();
+		CLOSE_ARRAY() <<
+		"\n";
+
+		if ( redFsm->anyActions() ) {
+			OPEN_ARRAY( ARRAY_TYPE(redFsm->maxActionLoc), "trans_actions" );
+			TRANS_ACTIONS();
+			CLOSE_ARRAY() <<
+			"\n";
+		}
+	}
+
+	if ( redFsm->anyToStateActions() ) {
+		OPEN_ARRAY( ARRAY_TYPE(redFsm->maxActionLoc), "to_state_actions" );
+		TO_STATE_ACTIONS();
+		CLOSE_ARRAY() <<
+		"\n";
+	}
+
+	if ( redFsm->anyFromStateActions() ) {
+		OPEN_ARRAY( ARRAY_TYPE(redFsm->maxActionLoc), "from_state_actions" );
+		FROM_STATE_ACTIONS();
+		CLOSE_ARRAY() <<
+		"\n";
+	}
+
+	if ( redFsm->anyEofActions() ) {
+		OPEN_ARRAY( ARRAY_TYPE(redFsm->maxActionLoc), "eof_actions" );
+		EOF_ACTIONS();
+		CLOSE_ARRAY() <<
+		"\n";
+	}
+
+	if ( redFsm->anyEofTrans() ) {
+		OPEN_ARRAY( ARRAY_TYPE(redFsm->maxIndexOffset+1), "eof_trans" );
+		EOF_TRANS();
+		CLOSE_ARRAY() <<
+		"\n";
+	}
+
+	out << "};\n\n";
+
+	/* The state ids are also written outside the struct under their usual
+	 * names, for the code around the machine. */
+	STATE_IDS();
+}
+
+void CxxTabCodeGen::writeExec()
+{
+	/* The action code uses the names of the C code, so it is written into
+	 * lambdas taking the names the engine does not keep in the variables of
+	 * the program. */
+	out <<
+		"	{\n"
+		"	auto _key = [&]() -> " << MACHINE() << "::key_type { return " <<
+				GET_KEY() << "; };\n"
+		"	auto _act = [&]( int _a, int _ps ) -> int {\n"
+		"		(void)_ps;\n"
+		"		switch ( _a ) {\n";
+
+	for ( GenActionList::Iter act = actionList; act.lte(); act++ ) {
+		if ( act->numTransRefs > 0 || act->numToStateRefs > 0 ||
+				act->numFromStateRefs > 0 )
+		{
+			out << "\tcase " << act->actionId << ":\n";
+			ACTION( out, act, 0, false, false );
+			out << "\tbreak;\n";
+		}
+	}
+	genLineDirective( out );
+
+	out <<
+		"		}\n"
+		"		return RlExecNone;\n"
+		"	};\n"
+		"	auto _eof_act = [&]( int _a, int _ps ) -> int {\n"
+		"		(void)_ps;\n"
+		"		switch ( _a ) {\n";
+
+	EOF_ACTION_SWITCH();
+
+	out <<
+		"		}\n"
+		"		return RlExecNone;\n"
+		"	};\n"
+		"	auto _cond = [&]( int _c ) -> bool {\n"
+		"		switch ( _c ) {\n";
+
+	/* Each condition is written once, however many spaces it is in. */
+	bool *written = new bool[actionList.length()];
+	memset( written, 0, sizeof(bool) * actionList.length() );
+	for ( CondSpaceList::Iter csi = condSpaceList; csi.lte(); csi++ ) {
+		for ( GenCondSet::Iter cond = csi->condSet; cond.lte(); cond++ ) {
+			if ( !written[(*cond)->actionId] ) {
+				written[(*cond)->actionId] = true;
+				out << "\tcase " << (*cond)->actionId << ": return ( ";
+				CONDITION( out, *cond );
+				out << " );\n";
+			}
+		}
+	}
+	delete[] written;
+	genLineDirective( out );
+
+	out <<
+		"		}\n"
+		"		return false;\n"
+		"	};\n"
+		"	rlExec<" << MACHINE() << ( noEnd ? ", true" : "" ) << ">( " <<
+				vCS() << ", " << P() << ", " << ( noEnd ? "nullptr" : PE() ) << ", " <<
+				( redFsm->anyEofTrans() || redFsm->anyEofActions() ? vEOF() : "nullptr" ) <<
+				", _key, _act, _eof_act, _cond );\n"
+		"	}\n";
+}
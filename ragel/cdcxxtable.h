@@ -0,0 +1,61 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _CDCXXTABLE_H
+#define _CDCXXTABLE_H
+
+#include <iostream>
+#include "cdtable.h"
+
+/*
+ * CxxTabCodeGen
+ *
+ * Writes the -T0 tables as constexpr members of a struct named after the
+ * machine, for -T0 --constexpr. Write exec passes the action code to the
+ * template engine in runtime/rlexec.h as lambdas, which return to the engine
+ * where the C code would jump.
+ */
+class CxxTabCodeGen
+	: public TabCodeGen, public CCodeGen
+{
+public:
+	CxxTabCodeGen( ostream &out ) :
+		FsmCodeGen(out), TabCodeGen(out), CCodeGen(out) {}
+
+	virtual void writeData();
+	virtual void writeExec();
+	virtual void writeExports();
+
+protected:
+	string MACHINE() { return DATA_PREFIX() + "machine"; }
+
+	virtual ostream &OPEN_ARRAY( string type, string name );
+	virtual ostream &STATIC_VAR( string type, string name );
+
+	void COND_SPACE_TABLES();
+	void JUMP( ostream &ret, bool inFinish );
+
+	void GOTO( ostream &ret, int gotoDest, bool inFinish );
+	void CALL( ostream &ret, int callDest, int targState, bool inFinish );
+	void GOTO_EXPR( ostream &ret, GenInlineItem *ilItem, bool inFinish );
+	void CALL_EXPR( ostream &ret, GenInlineItem *ilItem, int targState, bool inFinish );
+	void CURS( ostream &ret, bool inFinish );
+	void RET( ostream &ret, bool inFinish );
+	void BREAK( ostream &ret, int targState, bool csForced );
+};
+
+#endif
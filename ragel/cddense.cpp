@@ -0,0 +1,155 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ * 
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA 
+ */
+
+#include "ragel.h"
+#include "cddense.h"
+#include "redfsm.h"
+#include "gendata.h"
+
+using std::endl;
+
+void DenseFlatCodeGen::finishRagelDef()
+{
+	FsmCodeGen::finishRagelDef();
+	if ( gblErrorCount > 0 )
+		return;
+
+	if ( keyOps->alphType->size != 1 ) {
+		warning( sectionLoc ) << "-F3 needs a one byte alphabet, "
+				"writing -F1 tables for " << fsmName << endl;
+		return;
+	}
+
+	if ( redFsm->anyConditions() ) {
+		warning( sectionLoc ) << "-F3 does not support conditions, "
+				"writing -F1 tables for " << fsmName << endl;
+		return;
+	}
+
+	unsigned long long span = keyOps->span( keyOps->minKey, keyOps->maxKey );
+	HostType *indexType = keyOps->typeSubsumes( redFsm->transSet.length() );
+	unsigned long long size = redFsm->nextStateId * span * indexType->size;
+	if ( size > (unsigned long long)denseLimit ) {
+		warning( sectionLoc ) << "dense table for " << fsmName << 
+				" needs " << size << " bytes, over the limit of " << 
+				denseLimit << ", writing -F1 tables" << endl;
+		return;
+	}
+
+	redFsm->makeDense();
+}
+
+std::ostream &DenseFlatCodeGen::DENSE_TRANS()
+{
+	out << '\t';
+	unsigned long long length = redFsm->nextStateId * redFsm->denseSpan;
+	for ( unsigned long long pos = 0; pos < length; pos++ ) {
+		RedTransAp *trans = redFsm->denseTrans[pos];
+		out << ( trans != 0 ? trans->id : 0 );
+		if ( pos < length-1 ) {
+			out << ", ";
+			if ( (pos+1) % IALL == 0 )
+				out << "\n\t";
+		}
+	}
+	out << "\n";
+	return out;
+}
+
+void DenseFlatCodeGen::LOCATE_VARS()
+{
+	if ( redFsm->denseTrans == 0 ) {
+		FFlatCodeGen::LOCATE_VARS();
+		return;
+	}
+
+	out << "	int _trans";
+
+	if ( redFsm->anyRegCurStateRef() )
+		out << ", _ps";
+
+	out << ";\n";
+}
+
+void DenseFlatCodeGen::LOCATE_TRANS()
+{
+	if ( redFsm->denseTrans == 0 ) {
+		FFlatCodeGen::LOCATE_TRANS();
+		return;
+	}
+
+	out <<
+		"	_trans = " << DT() << "[(" << vCS() << "<<8) + (" << 
+				GET_KEY() << " - " << KEY(keyOps->minKey) << ")];\n"
+		"\n";
+}
+
+void DenseFlatCodeGen::writeData()
+{
+	if ( redFsm->denseTrans == 0 ) {
+		FFlatCodeGen::writeData();
+		return;
+	}
+
+	OPEN_ARRAY( ARRAY_TYPE(redFsm->maxIndex), DT() );
+	DENSE_TRANS();
+	CLOSE_ARRAY() <<
+	"\n";
+
+	OPEN_ARRAY( ARRAY_TYPE(redFsm->maxState), TT() );
+	TRANS_TARGS();
+	CLOSE_ARRAY() <<
+	"\n";
+
+	if ( redFsm->anyActions() ) {
+		OPEN_ARRAY( ARRAY_TYPE(redFsm->maxActListId), TA() );
+		TRANS_ACTIONS();
+		CLOSE_ARRAY() <<
+		"\n";
+	}
+
+	if ( redFsm->anyToStateActions() ) {
+		OPEN_ARRAY( ARRAY_TYPE(redFsm->maxActionLoc),  TSA() );
+		TO_STATE_ACTIONS();
+		CLOSE_ARRAY() <<
+		"\n";
+	}
+
+	if ( redFsm->anyFromStateActions() ) {
+		OPEN_ARRAY( ARRAY_TYPE(redFsm->maxActionLoc), FSA() );
+		FROM_STATE_ACTIONS();
+		CLOSE_ARRAY() <<
+		"\n";
+	}
+
+	if ( redFsm->anyEofActions() ) {
+		OPEN_ARRAY( ARRAY_TYPE(redFsm->maxActListId), EA() );
+		EOF_ACTIONS();
+		CLOSE_ARRAY() <<
+		"\n";
+	}
+
+	if ( redFsm->anyEofTrans() ) {
+		OPEN_ARRAY( ARRAY_TYPE(redFsm->maxIndexOffset+1), ET() );
+		EOF_TRANS();
+		CLOSE_ARRAY() <<
+		"\n";
+	}
+
+	STATE_IDS();
+	INSTRUMENT_DATA();
+}
@@ -0,0 +1,78 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ * 
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA 
+ */
+
+#ifndef _CDDENSE_H
+#define _CDDENSE_H
+
+#include <iostream>
+#include "cdfflat.h"
+
+/* Forwards. */
+struct CodeGenData;
+
+/*
+ * DenseFlatCodeGen
+ *
+ * Fast flat tables expanded to one entry for every state and character, so
+ * that finding the transition is a single load. Only for alphabets of one
+ * byte and machines without conditions. When the table would be larger than
+ * the dense limit the tables are the same as -F1.
+ */
+class DenseFlatCodeGen : public FFlatCodeGen
+{
+protected:
+	DenseFlatCodeGen( ostream &out ) : FsmCodeGen(out), FFlatCodeGen(out) {}
+
+	std::ostream &DENSE_TRANS();
+	virtual void LOCATE_VARS();
+	virtual void LOCATE_TRANS();
+
+	virtual void writeData();
+	virtual void finishRagelDef();
+};
+
+/*
+ * CDenseFlatCodeGen
+ */
+struct CDenseFlatCodeGen
+	: public DenseFlatCodeGen, public CCodeGen
+{
+	CDenseFlatCodeGen( ostream &out ) : 
+		FsmCodeGen(out), DenseFlatCodeGen(out), CCodeGen(out) {}
+};
+
+/*
+ * DDenseFlatCodeGen
+ */
+struct DDenseFlatCodeGen
+	: public DenseFlatCodeGen, public DCodeGen
+{
+	DDenseFlatCodeGen( ostream &out ) : 
+		FsmCodeGen(out), DenseFlatCodeGen(out), DCodeGen(out) {}
+};
+
+/*
+ * D2DenseFlatCodeGen
+ */
+struct D2DenseFlatCodeGen
+	: public DenseFlatCodeGen, public D2CodeGen
+{
+	D2DenseFlatCodeGen( ostream &out ) : 
+		FsmCodeGen(out), DenseFlatCodeGen(out), D2CodeGen(out) {}
+};
+
+#endif
@@ -234,15 +234,12 @@ void FFlatCodeGen::writeData()
 	}
 
 	STATE_IDS();
+	INSTRUMENT_DATA();
 }
 
-void FFlatCodeGen::writeExec()
+void FFlatCodeGen::LOCATE_VARS()
 {
-	testEofUsed = false;
-	outLabelUsed = false;
-
 	out << 
-		"	{\n"
 		"	int _slen";
 
 	if ( redFsm->anyRegCurStateRef() )
@@ -265,6 +262,15 @@ void FFlatCodeGen::writeExec()
 			"	" << PTR_CONST() << ARRAY_TYPE(redFsm->maxCond) << PTR_CONST_END() << POINTER() << "_conds;\n"
 			"	" << WIDE_ALPH_TYPE() << " _widec;\n";
 	}
+}
+
+void FFlatCodeGen::writeExec()
+{
+	testEofUsed = false;
+	outLabelUsed = false;
+
+	out << "	{\n";
+	LOCATE_VARS();
 
 	if ( !noEnd ) {
 		testEofUsed = true;
@@ -282,6 +288,9 @@ void FFlatCodeGen::writeExec()
 
 	out << "_resume:\n";
 
+	if ( instrument )
+		out << INSTRUMENT( vCS() );
+
 	if ( redFsm->anyFromStateActions() ) {
 		out <<
 			"	switch ( " << FSA() << "[" << vCS() << "] ) {\n";
@@ -291,8 +300,11 @@ void FFlatCodeGen::writeExec()
 			"\n";
 	}
 
-	if ( redFsm->anyConditions() )
+	if ( redFsm->anyConditions() ) {
 		COND_TRANSLATE();
+		if ( instrument )
+			out << INSTRUMENT_KEY( vCS(), "_widec" );
+	}
 
 	LOCATE_TRANS();
 
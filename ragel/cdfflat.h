@@ -48,6 +48,9 @@ protected:
 	virtual std::ostream &EOF_ACTION( RedStateAp *state );
 	virtual std::ostream &TRANS_ACTION( RedTransAp *trans );
 
+	/* Declare the locals used to find the transition. */
+	virtual void LOCATE_VARS();
+
 	virtual void writeData();
 	virtual void writeExec();
 };
@@ -173,7 +173,22 @@ void FGotoCodeGen::writeData()
 		"\n";
 	}
 
+	if ( redFsm->rangeBits.length() > 0 ) {
+		OPEN_ARRAY( ARRAY_TYPE(0xff), RB() );
+		RANGE_BITS();
+		CLOSE_ARRAY() <<
+		"\n";
+	}
+
+	if ( redFsm->startState != 0 && redFsm->startState->skipTable ) {
+		OPEN_ARRAY( ARRAY_TYPE(1), PF() );
+		PREFILTER();
+		CLOSE_ARRAY() <<
+		"\n";
+	}
+
 	STATE_IDS();
+	INSTRUMENT_DATA();
 }
 
 void FGotoCodeGen::writeExec()
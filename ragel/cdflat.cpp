@@ -667,6 +667,7 @@ void FlatCodeGen::writeData()
 	}
 
 	STATE_IDS();
+	INSTRUMENT_DATA();
 }
 
 void FlatCodeGen::COND_TRANSLATE()
@@ -766,6 +767,9 @@ void FlatCodeGen::writeExec()
 
 	out << "_resume:\n";
 
+	if ( instrument )
+		out << INSTRUMENT( vCS() );
+
 	if ( redFsm->anyFromStateActions() ) {
 		out <<
 			"	_acts = " << ARR_OFF( A(), FSA() + "[" + vCS() + "]" ) << ";\n"
@@ -779,8 +783,11 @@ void FlatCodeGen::writeExec()
 			"\n";
 	}
 
-	if ( redFsm->anyConditions() )
+	if ( redFsm->anyConditions() ) {
 		COND_TRANSLATE();
+		if ( instrument )
+			out << INSTRUMENT_KEY( vCS(), "_widec" );
+	}
 
 	LOCATE_TRANS();
 
@@ -288,6 +288,7 @@ void FTabCodeGen::writeData()
 	}
 
 	STATE_IDS();
+	INSTRUMENT_DATA();
 }
 
 void FTabCodeGen::writeExec()
@@ -328,6 +329,9 @@ void FTabCodeGen::writeExec()
 
 	out << "_resume:\n";
 
+	if ( instrument )
+		out << INSTRUMENT( vCS() );
+
 	if ( redFsm->anyFromStateActions() ) {
 		out <<
 			"	switch ( " << FSA() << "[" << vCS() << "] ) {\n";
@@ -337,8 +341,11 @@ void FTabCodeGen::writeExec()
 			"\n";
 	}
 
-	if ( redFsm->anyConditions() )
+	if ( redFsm->anyConditions() ) {
 		COND_TRANSLATE();
+		if ( instrument )
+			out << INSTRUMENT_KEY( vCS(), "_widec" );
+	}
 
 	LOCATE_TRANS();
 
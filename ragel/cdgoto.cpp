@@ -106,6 +106,73 @@ void GotoCodeGen::GOTO_HEADER( RedStateAp *state )
 {
 	/* Label the state. */
 	out << "case " << state->id << ":\n";
+
+	if ( instrument )
+		out << INSTRUMENT( state );
+
+	if ( state->skipLoop && !noEnd ) {
+		testEofUsed = true;
+		SKIP_LOOP( state, "_test_eof" );
+	}
+}
+
+/* Move p up to the next exit character of a self looping state, sixteen
+ * characters at a time when SSE2 vectors are available. If the exit is not
+ * found before pe then go to the end label, leaving cs as it is. */
+void GotoCodeGen::SKIP_LOOP( RedStateAp *state, const string &endLabel )
+{
+	out << "	{\n";
+	if ( state->skipTable ) {
+		/* Too many exits to compare against, look them up. */
+		string offset = " - " + KEY( keyOps->minKey ) + "]";
+		out <<
+			"	while ( " << PE() << " - " << P() << " >= 4 && !" << 
+					PF() << "[" << P() << "[0]" << offset << " && !" << 
+					PF() << "[" << P() << "[1]" << offset << " &&\n"
+			"			!" << PF() << "[" << P() << "[2]" << offset << " && !" <<
+					PF() << "[" << P() << "[3]" << offset << " )\n"
+			"		" << P() << " += 4;\n"
+			"	while ( " << P() << " != " << PE() << " && !" << 
+					PF() << "[" << GET_KEY() << offset << " )\n"
+			"		" << P() << " += 1;\n";
+	}
+	else if ( state->numSkipExits == 0 )
+		out << "	" << P() << " = " << PE() << ";\n";
+	else {
+		out <<
+			"#if defined(__SSE2__) && defined(__GNUC__)\n"
+			"	typedef char _skipv __attribute__((vector_size(16), aligned(1), may_alias));\n"
+			"	while ( " << PE() << " - " << P() << " >= 16 ) {\n"
+			"		_skipv _c = *(const _skipv*)" << P() << ";\n"
+			"		int _m = __builtin_ia32_pmovmskb128( (_skipv)( ";
+
+		for ( int e = 0; e < state->numSkipExits; e++ ) {
+			if ( e > 0 )
+				out << " | ";
+			out << "(_c == (char)" << KEY( state->skipExits[e] ) << ")";
+		}
+
+		out << " ) );\n"
+			"		if ( _m != 0 ) {\n"
+			"			" << P() << " += __builtin_ctz( _m );\n"
+			"			break;\n"
+			"		}\n"
+			"		" << P() << " += 16;\n"
+			"	}\n"
+			"#endif\n"
+			"	while ( " << P() << " != " << PE();
+
+		for ( int e = 0; e < state->numSkipExits; e++ )
+			out << " && " << GET_KEY() << " != " << KEY( state->skipExits[e] );
+
+		out << " )\n"
+			"		" << P() << " += 1;\n";
+	}
+
+	out << 
+		"	if ( " << P() << " == " << PE() << " )\n"
+		"		goto " << endLabel << ";\n"
+		"	}\n";
 }
 
 
@@ -141,10 +208,153 @@ void GotoCodeGen::emitSingleSwitch( RedStateAp *state )
 	}
 }
 
-void GotoCodeGen::emitRangeBSearch( RedStateAp *state, int level, int low, int high )
+string GotoCodeGen::KEY_BOUNDS( Key lowKey, Key highKey )
+{
+	return keyBoundsTest( lowKey, highKey, GET_KEY(), KEY(lowKey), KEY(highKey) );
+}
+
+void GotoCodeGen::emitRangeBitmap( RedStateAp *state, int level )
+{
+	string bounds = KEY_BOUNDS( state->lowKey, state->highKey );
+	string offset = "(" + GET_KEY() + " - " + KEY(state->lowKey) + ")";
+
+	if ( bounds.size() > 0 ) {
+		out << TABS(level) << "if ( " << bounds << " ) {\n";
+		level += 1;
+	}
+
+	for ( int t = 0; t < state->rangeTargs.length(); t++ ) {
+		out << TABS(level) << "if ( " << RB() << "[" << 
+				redFsm->rangeBitmapStart( state, t ) << " + (" << offset << 
+				" >> 3)] & (1 << (" << offset << " & 7)) )\n";
+		TRANS_GOTO( state->rangeTargs[t], level+1 ) << "\n";
+	}
+
+	if ( bounds.size() > 0 )
+		out << TABS(level-1) << "}\n";
+}
+
+std::ostream &GotoCodeGen::RANGE_BITS()
+{
+	out << '\t';
+	for ( int pos = 0; pos < redFsm->rangeBits.length(); pos++ ) {
+		out << (unsigned int)redFsm->rangeBits[pos];
+		if ( pos < redFsm->rangeBits.length()-1 ) {
+			out << ", ";
+			if ( (pos+1) % IALL == 0 )
+				out << "\n\t";
+		}
+	}
+	out << "\n";
+	return out;
+}
+
+/* Cases are grouped by target so that each target is jumped to once. */
+void GotoCodeGen::emitKeySwitch( RedStateAp *state, int level )
+{
+	out << TABS(level) << "switch( " << GET_KEY() << " ) {\n";
+
+	for ( int t = 0; t < state->rangeTargs.length(); t++ ) {
+		int numCases = 0;
+		for ( RedTransList::Iter rtel = state->outRange; rtel.lte(); rtel++ ) {
+			if ( rtel->value != state->rangeTargs[t] )
+				continue;
+
+			Key key = rtel->lowKey;
+			while ( true ) {
+				if ( numCases % IALL == 0 )
+					out << ( numCases > 0 ? "\n" : "" ) << TABS(level+1);
+				else
+					out << " ";
+				out << "case " << KEY(key) << ":";
+				numCases += 1;
+
+				if ( key == rtel->highKey )
+					break;
+				key.increment();
+			}
+		}
+		out << "\n";
+		TRANS_GOTO( state->rangeTargs[t], level+2 ) << "\n";
+	}
+
+	SWITCH_DEFAULT() << TABS(level) << "}\n";
+}
+
+unsigned long long GotoCodeGen::rangeHits( RedStateAp *state, int low, int high )
+{
+	unsigned long long hits = 0;
+	for ( int r = low; r <= high; r++ )
+		hits += state->outRange[r].hits;
+	return hits;
+}
+
+int GotoCodeGen::rangeSplit( RedStateAp *state, int low, int high )
 {
-	/* Get the mid position, staying on the lower end of the range. */
 	int mid = (low + high) >> 1;
+	unsigned long long total = rangeHits( state, low, high );
+	if ( !redFsm->profiled || total == 0 )
+		return mid;
+
+	/* Pick the range leaving the fewest hits on its heavier side, the one
+	 * nearest the middle on a tie. */
+	int best = mid, bestDist = 0;
+	unsigned long long bestCost = total + 1, before = 0;
+	for ( int r = low; r <= high; r++ ) {
+		unsigned long long hits = state->outRange[r].hits;
+		unsigned long long after = total - before - hits;
+		unsigned long long cost = before > after ? before : after;
+		int dist = r < mid ? mid - r : r - mid;
+		if ( cost < bestCost || ( cost == bestCost && dist < bestDist ) ) {
+			best = r;
+			bestDist = dist;
+			bestCost = cost;
+		}
+		before += hits;
+	}
+	return best;
+}
+
+string GotoCodeGen::UNLIKELY( const string &test, bool cold )
+{
+	/* The hints need __builtin_expect, so only C gets them. */
+	if ( !cold || hostLang->lang != HostLang::C )
+		return test;
+
+	/* Define the hint before its first use. The directives go on lines of
+	 * their own, ahead of the test that uses it. */
+	if ( !unlikelyDefined ) {
+		out << 
+			"#ifndef RAGEL_UNLIKELY\n"
+			"#if defined(__GNUC__)\n"
+			"#define RAGEL_UNLIKELY(e) __builtin_expect( !!(e), 0 )\n"
+			"#else\n"
+			"#define RAGEL_UNLIKELY(e) (e)\n"
+			"#endif\n"
+			"#endif\n";
+		unlikelyDefined = true;
+	}
+
+	return "RAGEL_UNLIKELY( " + test + " )";
+}
+
+void GotoCodeGen::emitRangeBSearch( RedStateAp *state, int level, int low, int high )
+{
+	/* States with many ranges going to few targets test bitmaps instead. */
+	if ( state->rangeBitmap ) {
+		emitRangeBitmap( state, level );
+		return;
+	}
+
+	/* Dense states switch on the key. */
+	if ( state->keySwitch ) {
+		emitKeySwitch( state, level );
+		return;
+	}
+
+	/* Get the split position, the mid position staying on the lower end of
+	 * the range when there is no profile. */
+	int mid = rangeSplit( state, low, high );
 	RedTransEl *data = state->outRange.data;
 
 	/* Determine if we need to look higher or lower. */
@@ -155,21 +365,32 @@ void GotoCodeGen::emitRangeBSearch( RedStateAp *state, int level, int low, int h
 	bool limitLow = data[mid].lowKey == keyOps->minKey;
 	bool limitHigh = data[mid].highKey == keyOps->maxKey;
 
+	/* Sides of the tree that the profile never saw taken. */
+	bool coldLower = false, coldHigher = false;
+	if ( redFsm->profiled && rangeHits( state, low, high ) > 0 ) {
+		coldLower = anyLower && rangeHits( state, low, mid-1 ) == 0;
+		coldHigher = anyHigher && rangeHits( state, mid+1, high ) == 0;
+	}
+
+	/* Made before writing anything, since marking a test may first write the
+	 * definition of the hint. */
+	string testLower = UNLIKELY( GET_WIDE_KEY(state) + " < " + 
+			WIDE_KEY(state, data[mid].lowKey), coldLower );
+	string testHigher = UNLIKELY( GET_WIDE_KEY(state) + " > " + 
+			WIDE_KEY(state, data[mid].highKey), coldHigher );
+
 	if ( anyLower && anyHigher ) {
 		/* Can go lower and higher than mid. */
-		out << TABS(level) << "if ( " << GET_WIDE_KEY(state) << " < " << 
-				WIDE_KEY(state, data[mid].lowKey) << " ) {\n";
+		out << TABS(level) << "if ( " << testLower << " ) {\n";
 		emitRangeBSearch( state, level+1, low, mid-1 );
-		out << TABS(level) << "} else if ( " << GET_WIDE_KEY(state) << " > " << 
-				WIDE_KEY(state, data[mid].highKey) << " ) {\n";
+		out << TABS(level) << "} else if ( " << testHigher << " ) {\n";
 		emitRangeBSearch( state, level+1, mid+1, high );
 		out << TABS(level) << "} else\n";
 		TRANS_GOTO(data[mid].value, level+1) << "\n";
 	}
 	else if ( anyLower && !anyHigher ) {
 		/* Can go lower than mid but not higher. */
-		out << TABS(level) << "if ( " << GET_WIDE_KEY(state) << " < " << 
-				WIDE_KEY(state, data[mid].lowKey) << " ) {\n";
+		out << TABS(level) << "if ( " << testLower << " ) {\n";
 		emitRangeBSearch( state, level+1, low, mid-1 );
 
 		/* if the higher is the highest in the alphabet then there is no
@@ -186,8 +407,7 @@ void GotoCodeGen::emitRangeBSearch( RedStateAp *state, int level, int low, int h
 	}
 	else if ( !anyLower && anyHigher ) {
 		/* Can go higher than mid but not lower. */
-		out << TABS(level) << "if ( " << GET_WIDE_KEY(state) << " > " << 
-				WIDE_KEY(state, data[mid].highKey) << " ) {\n";
+		out << TABS(level) << "if ( " << testHigher << " ) {\n";
 		emitRangeBSearch( state, level+1, mid+1, high );
 
 		/* If the lower end is the lowest in the alphabet then there is no
@@ -347,6 +567,16 @@ void GotoCodeGen::emitCondBSearch( RedStateAp *state, int level, int low, int hi
 	}
 }
 
+/* Find the wide key of a state with conditions. */
+void GotoCodeGen::emitCondWidec( RedStateAp *state )
+{
+	out << "	_widec = " << GET_KEY() << ";\n";
+	emitCondBSearch( state, 1, 0, state->stateCondVect.length() - 1 );
+
+	if ( instrument )
+		out << INSTRUMENT_KEY( state->id, "_widec" );
+}
+
 std::ostream &GotoCodeGen::STATE_GOTOS()
 {
 	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ ) {
@@ -356,10 +586,8 @@ std::ostream &GotoCodeGen::STATE_GOTOS()
 			/* Writing code above state gotos. */
 			GOTO_HEADER( st );
 
-			if ( st->stateCondVect.length() > 0 ) {
-				out << "	_widec = " << GET_KEY() << ";\n";
-				emitCondBSearch( st, 1, 0, st->stateCondVect.length() - 1 );
-			}
+			if ( st->stateCondVect.length() > 0 )
+				emitCondWidec( st );
 
 			/* Try singles. */
 			if ( st->outSingle.length() > 0 )
@@ -662,6 +890,30 @@ void GotoCodeGen::BREAK( ostream &ret, int targState, bool csForced )
 	ret << "{" << P() << "++; " << CTRL_FLOW() << "goto _out; }";
 }
 
+/* One entry for each character, non-zero where the start state leaves its
+ * self loop. */
+std::ostream &GotoCodeGen::PREFILTER()
+{
+	bool self[256];
+	redFsm->findSkipSelf( redFsm->startState, self );
+
+	out << "\t";
+	int totalKey = 0;
+	Key key = keyOps->minKey;
+	while ( true ) {
+		out << ( self[totalKey] ? 0 : 1 );
+		if ( key == keyOps->maxKey )
+			break;
+
+		out << ", ";
+		if ( ++totalKey % IALL == 0 )
+			out << "\n\t";
+		key.increment();
+	}
+	out << "\n";
+	return out;
+}
+
 void GotoCodeGen::writeData()
 {
 	if ( redFsm->anyActions() ) {
@@ -692,7 +944,22 @@ void GotoCodeGen::writeData()
 		"\n";
 	}
 
+	if ( redFsm->rangeBits.length() > 0 ) {
+		OPEN_ARRAY( ARRAY_TYPE(0xff), RB() );
+		RANGE_BITS();
+		CLOSE_ARRAY() <<
+		"\n";
+	}
+
+	if ( redFsm->startState != 0 && redFsm->startState->skipTable ) {
+		OPEN_ARRAY( ARRAY_TYPE(1), PF() );
+		PREFILTER();
+		CLOSE_ARRAY() <<
+		"\n";
+	}
+
 	STATE_IDS();
+	INSTRUMENT_DATA();
 }
 
 void GotoCodeGen::writeExec()
@@ -40,12 +40,12 @@ struct GenStateCond;
 class GotoCodeGen : virtual public FsmCodeGen
 {
 public:
-	GotoCodeGen( ostream &out ) : FsmCodeGen(out) {}
+	GotoCodeGen( ostream &out ) : FsmCodeGen(out), unlikelyDefined(false) {}
 	std::ostream &TO_STATE_ACTION_SWITCH();
 	std::ostream &FROM_STATE_ACTION_SWITCH();
 	std::ostream &EOF_ACTION_SWITCH();
 	std::ostream &ACTION_SWITCH();
-	std::ostream &STATE_GOTOS();
+	virtual std::ostream &STATE_GOTOS();
 	std::ostream &TRANSITIONS();
 	std::ostream &EXEC_FUNCS();
 	std::ostream &FINISH_CASES();
@@ -71,6 +71,7 @@ public:
 
 	void COND_TRANSLATE( GenStateCond *stateCond, int level );
 	void emitCondBSearch( RedStateAp *state, int level, int low, int high );
+	void emitCondWidec( RedStateAp *state );
 	void STATE_CONDS( RedStateAp *state, bool genDefault ); 
 
 	virtual std::ostream &TRANS_GOTO( RedTransAp *trans, int level );
@@ -78,6 +79,26 @@ public:
 	void emitSingleSwitch( RedStateAp *state );
 	void emitRangeBSearch( RedStateAp *state, int level, int low, int high );
 
+	/* Ordering compare trees by the profile. The range tested first is the
+	 * one that best balances the hits on either side, and tests leading only
+	 * to ranges never taken are marked unlikely. */
+	unsigned long long rangeHits( RedStateAp *state, int low, int high );
+	int rangeSplit( RedStateAp *state, int low, int high );
+	string UNLIKELY( const string &test, bool cold );
+	bool unlikelyDefined;
+
+	/* Test the range bitmaps of a state. */
+	string KEY_BOUNDS( Key lowKey, Key highKey );
+	void emitRangeBitmap( RedStateAp *state, int level );
+
+	/* Switch on every key covered by the ranges of a state. */
+	void emitKeySwitch( RedStateAp *state, int level );
+	std::ostream &RANGE_BITS();
+
+	/* Scan ahead through a state that loops on itself. */
+	void SKIP_LOOP( RedStateAp *state, const string &endLabel );
+	std::ostream &PREFILTER();
+
 	/* Called from STATE_GOTOS just before writing the gotos */
 	virtual void GOTO_HEADER( RedStateAp *state );
 	virtual void STATE_GOTO_ERROR();
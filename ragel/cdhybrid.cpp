@@ -0,0 +1,129 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ * 
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA 
+ */
+
+#include "ragel.h"
+#include "cdhybrid.h"
+#include "redfsm.h"
+#include "gendata.h"
+
+std::ostream &HybridCodeGen::HYBRID_INDEX()
+{
+	out << '\t';
+	for ( int pos = 0; pos < redFsm->hybridIndex.length(); pos++ ) {
+		out << redFsm->hybridIndex[pos];
+		if ( pos < redFsm->hybridIndex.length()-1 ) {
+			out << ", ";
+			if ( (pos+1) % IALL == 0 )
+				out << "\n\t";
+		}
+	}
+	out << "\n";
+	return out;
+}
+
+void HybridCodeGen::emitLinear( RedStateAp *state )
+{
+	for ( RedTransList::Iter rtel = state->outSingle; rtel.lte(); rtel++ ) {
+		out << "	if ( " << GET_KEY() << " == " << KEY(rtel->lowKey) << " )\n";
+		TRANS_GOTO( rtel->value, 2 ) << "\n";
+	}
+
+	for ( RedTransList::Iter rtel = state->outRange; rtel.lte(); rtel++ ) {
+		string bounds = KEY_BOUNDS( rtel->lowKey, rtel->highKey );
+		if ( bounds.size() > 0 ) {
+			out << "	if ( " << bounds << " )\n";
+			TRANS_GOTO( rtel->value, 2 ) << "\n";
+		}
+		else {
+			TRANS_GOTO( rtel->value, 1 ) << "\n";
+		}
+	}
+}
+
+void HybridCodeGen::emitFlatRow( RedStateAp *state )
+{
+	string bounds = KEY_BOUNDS( state->lowKey, state->highKey );
+
+	int level = 1;
+	if ( bounds.size() > 0 ) {
+		out << "	if ( " << bounds << " ) {\n";
+		level = 2;
+	}
+
+	out << TABS(level) << "switch ( " << HI() << "[" << state->hybridOffset << 
+			" + (" << GET_KEY() << " - " << KEY(state->lowKey) << ")] ) {\n";
+
+	for ( int t = 0; t < state->rangeTargs.length(); t++ ) {
+		out << TABS(level) << "\tcase " << t+1 << ": ";
+		TRANS_GOTO( state->rangeTargs[t], 0 ) << "\n";
+	}
+
+	SWITCH_DEFAULT() << TABS(level) << "}\n";
+
+	if ( bounds.size() > 0 )
+		out << "	}\n";
+}
+
+std::ostream &HybridCodeGen::STATE_GOTOS()
+{
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ ) {
+		if ( st == redFsm->errState )
+			STATE_GOTO_ERROR();
+		else {
+			/* Writing code above state gotos. */
+			GOTO_HEADER( st );
+
+			switch ( st->hybridLookup ) {
+			case HybridSearch:
+				if ( st->stateCondVect.length() > 0 )
+					emitCondWidec( st );
+
+				if ( st->outSingle.length() > 0 )
+					emitSingleSwitch( st );
+
+				if ( st->outRange.length() > 0 )
+					emitRangeBSearch( st, 1, 0, st->outRange.length() - 1 );
+				break;
+			case HybridLinear:
+				emitLinear( st );
+				break;
+			case HybridBitmap:
+				emitRangeBitmap( st, 1 );
+				break;
+			case HybridFlat:
+				emitFlatRow( st );
+				break;
+			}
+
+			/* Write the default transition. */
+			TRANS_GOTO( st->defTrans, 1 ) << "\n";
+		}
+	}
+	return out;
+}
+
+void HybridCodeGen::writeData()
+{
+	if ( redFsm->hybridIndex.length() > 0 ) {
+		OPEN_ARRAY( ARRAY_TYPE(redFsm->maxHybridIndex), HI() );
+		HYBRID_INDEX();
+		CLOSE_ARRAY() <<
+		"\n";
+	}
+
+	IpGotoCodeGen::writeData();
+}
@@ -0,0 +1,59 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ * 
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA 
+ */
+
+#ifndef _CDHYBRID_H
+#define _CDHYBRID_H
+
+#include <iostream>
+#include "cdipgoto.h"
+
+/* Forwards. */
+struct CodeGenData;
+
+/*
+ * HybridCodeGen
+ *
+ * Really fast goto-driven code where each state locates its transition in
+ * the way that is estimated to be cheapest for it: the -G2 compare trees, a
+ * short run of tests, a bitmap test when only one target differs from the
+ * default, or a switch on an index from a flat row over the key span.
+ */
+class HybridCodeGen : public IpGotoCodeGen
+{
+public:
+	HybridCodeGen( ostream &out ) : FsmCodeGen(out), IpGotoCodeGen(out) {}
+
+	std::ostream &HYBRID_INDEX();
+	std::ostream &STATE_GOTOS();
+
+	void emitLinear( RedStateAp *state );
+	void emitFlatRow( RedStateAp *state );
+
+	virtual void writeData();
+};
+
+/*
+ * class CHybridCodeGen
+ */
+struct CHybridCodeGen
+	: public HybridCodeGen, public CCodeGen
+{
+	CHybridCodeGen( ostream &out ) : 
+		FsmCodeGen(out), HybridCodeGen(out), CCodeGen(out) {}
+};
+
+#endif
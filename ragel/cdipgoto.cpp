@@ -26,6 +26,9 @@
 #include "redfsm.h"
 #include "gendata.h"
 #include "bstmap.h"
+#include <sstream>
+
+using std::ostringstream;
 
 bool IpGotoCodeGen::useAgainLabel()
 {
@@ -232,9 +235,10 @@ void IpGotoCodeGen::GOTO_HEADER( RedStateAp *state )
 		}
 	}
 
-	/* Give the state a switch case. */
-	out << "	/* fall through */\n";
-	out << "case " << state->id << ":\n";
+	STATE_CASE( state );
+
+	if ( instrument )
+		out << INSTRUMENT( state );
 
 	if ( state->fromStateAction != 0 ) {
 		/* Remember that we wrote an action. Write every action in the list. */
@@ -251,6 +255,20 @@ void IpGotoCodeGen::GOTO_HEADER( RedStateAp *state )
 	/* Record the prev state if necessary. */
 	if ( state->anyRegCurStateRef() )
 		out << "	_ps = " << state->id << ";\n";
+
+	/* The self loop makes the state's label and eof label needed. */
+	if ( state->skipLoop && !noEnd ) {
+		ostringstream endLabel;
+		endLabel << "_test_eof" << state->id;
+		SKIP_LOOP( state, endLabel.str() );
+	}
+}
+
+void IpGotoCodeGen::STATE_CASE( RedStateAp *state )
+{
+	/* Give the state a switch case. */
+	out << "	/* fall through */\n";
+	out << "case " << state->id << ":\n";
 }
 
 void IpGotoCodeGen::STATE_GOTO_ERROR()
@@ -414,7 +432,22 @@ void IpGotoCodeGen::setLabelsNeeded()
 
 void IpGotoCodeGen::writeData()
 {
+	if ( redFsm->rangeBits.length() > 0 ) {
+		OPEN_ARRAY( ARRAY_TYPE(0xff), RB() );
+		RANGE_BITS();
+		CLOSE_ARRAY() <<
+		"\n";
+	}
+
+	if ( redFsm->startState != 0 && redFsm->startState->skipTable ) {
+		OPEN_ARRAY( ARRAY_TYPE(1), PF() );
+		PREFILTER();
+		CLOSE_ARRAY() <<
+		"\n";
+	}
+
 	STATE_IDS();
+	INSTRUMENT_DATA();
 }
 
 void IpGotoCodeGen::writeExec()
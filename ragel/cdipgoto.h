@@ -68,6 +68,9 @@ protected:
 	void GOTO_HEADER( RedStateAp *state );
 	void STATE_GOTO_ERROR();
 
+	/* Where a state is entered from the state switch. */
+	virtual void STATE_CASE( RedStateAp *state );
+
 	/* Set up labelNeeded flag for each state. */
 	void setLabelsNeeded( GenInlineList *inlineList );
 	void setLabelsNeeded();
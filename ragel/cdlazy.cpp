@@ -0,0 +1,406 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <string.h>
+#include <sstream>
+#include "ragel.h"
+#include "cdlazy.h"
+#include "cdcodegen.h"
+#include "nfagraph.h"
+
+using std::ostringstream;
+using std::endl;
+
+string CLazyCodeGen::DATA_PREFIX()
+{
+	if ( !noPrefix )
+		return string(fsmName) + "_";
+	return "";
+}
+
+string CLazyCodeGen::ALPH_TYPE()
+{
+	string ret = keyOps->alphType->data1;
+	if ( keyOps->alphType->data2 != 0 ) {
+		ret += " ";
+		ret += keyOps->alphType->data2;
+	}
+	return ret;
+}
+
+string CLazyCodeGen::ARRAY_TYPE( unsigned long maxVal )
+{
+	long long maxValLL = (long long) maxVal;
+	HostType *arrayType = keyOps->typeSubsumes( maxValLL );
+	assert( arrayType != 0 );
+
+	string ret = arrayType->data1;
+	if ( arrayType->data2 != 0 ) {
+		ret += " ";
+		ret += arrayType->data2;
+	}
+	return ret;
+}
+
+ostream &CLazyCodeGen::OPEN_ARRAY( string type, string name )
+{
+	out << "static const " << type << " " << name << "[] = {\n";
+	return out;
+}
+
+ostream &CLazyCodeGen::CLOSE_ARRAY()
+{
+	return out << "};\n";
+}
+
+void CLazyCodeGen::ARRAY_ITEMS( int *vals, int length )
+{
+	out << "\t";
+	for ( int i = 0; i < length; i++ ) {
+		out << vals[i];
+		if ( i < length - 1 ) {
+			out << ", ";
+			if ( (i+1) % IALL == 0 )
+				out << "\n\t";
+		}
+	}
+	out << "\n";
+}
+
+bool CLazyCodeGen::writeStatement( InputLoc &loc, int nargs, char **args )
+{
+	bool followLineDirective = false;
+
+	if ( strcmp( args[0], "lazy" ) == 0 ) {
+		for ( int i = 1; i < nargs; i++ )
+			write_option_error( loc, args[i] );
+
+		if ( keyOps->alphSize() > 256 ) {
+			source_error(loc) << "write lazy needs an alphabet of at most "
+					"256 keys" << endl;
+		}
+		else {
+			out << '\n';
+			genLineDirective( out );
+			followLineDirective = true;
+			writeLazy();
+		}
+	}
+	else {
+		source_error(loc) << "only write lazy is available with --lazy" << endl;
+	}
+	return followLineDirective;
+}
+
+/* Writes the C API for a machine made with --lazy. A deterministic state is
+ * a set of positions: the start state and the targets of key transitions.
+ * Each position stands for its epsilon closure, so stepping a set is the
+ * union of the targets of its positions, which are tabled by position and
+ * key class. The sets reached are kept in a hashed cache with the
+ * transitions found between them. */
+void CLazyCodeGen::writeLazy()
+{
+	int numOrig = nfa->states.length();
+	int span = keyOps->alphSize();
+	long long minKey = keyOps->minKey.getLongLong();
+
+	/* Find the positions, laying out the closure of each in order. */
+	int *posOf = new int[numOrig];
+	int *mark = new int[numOrig];
+	int *stack = new int[numOrig];
+	for ( int s = 0; s < numOrig; s++ ) {
+		posOf[s] = -1;
+		mark[s] = -1;
+	}
+
+	Vector<int> positions, closureStart, closures;
+	posOf[nfa->startState] = 0;
+	positions.append( nfa->startState );
+	for ( int i = 0; i < positions.length(); i++ ) {
+		closureStart.append( closures.length() );
+
+		int top = 0;
+		stack[top++] = positions[i];
+		mark[positions[i]] = i;
+		while ( top > 0 ) {
+			NfaState *state = nfa->states[stack[--top]];
+			closures.append( stack[top] );
+
+			for ( int e = 0; e < state->epsList.length(); e++ ) {
+				int targ = state->epsList[e];
+				if ( mark[targ] != i ) {
+					mark[targ] = i;
+					stack[top++] = targ;
+				}
+			}
+
+			for ( int t = 0; t < state->outList.length(); t++ ) {
+				int targ = state->outList[t].targ;
+				if ( posOf[targ] < 0 ) {
+					posOf[targ] = positions.length();
+					positions.append( targ );
+				}
+			}
+		}
+	}
+	closureStart.append( closures.length() );
+	int numPos = positions.length();
+
+	/* Split the keys into classes that are in the same ranges. */
+	int *cls = new int[span];
+	int *remap = new int[span * 2];
+	int numClasses = 1;
+	for ( int k = 0; k < span; k++ )
+		cls[k] = 0;
+
+	for ( int s = 0; s < numOrig; s++ ) {
+		NfaState *state = nfa->states[s];
+		for ( int t = 0; t < state->outList.length(); t++ ) {
+			long long low = state->outList[t].lowKey - minKey;
+			long long high = state->outList[t].highKey - minKey;
+			if ( low == 0 && high == span - 1 )
+				continue;
+
+			for ( int c = 0; c < numClasses * 2; c++ )
+				remap[c] = -1;
+
+			int nextClass = 0;
+			for ( int k = 0; k < span; k++ ) {
+				int r = cls[k] * 2 + ( k >= low && k <= high ? 1 : 0 );
+				if ( remap[r] < 0 )
+					remap[r] = nextClass++;
+				cls[k] = remap[r];
+			}
+			numClasses = nextClass;
+		}
+	}
+
+	/* Classes are numbered in key order, so the first key of each is the
+	 * first one found. */
+	int *classKey = new int[numClasses];
+	for ( int k = span - 1; k >= 0; k-- )
+		classKey[cls[k]] = k;
+
+	/* Targets of each position and class, and which positions are final. */
+	int *index = new int[numPos * numClasses + 1];
+	int *final = new int[numPos];
+	int *seen = new int[numPos];
+	Vector<int> targs;
+	for ( int i = 0; i < numPos; i++ ) {
+		seen[i] = -1;
+		final[i] = 0;
+		for ( int j = closureStart[i]; j < closureStart[i+1]; j++ ) {
+			if ( closures[j] == nfa->finalState )
+				final[i] = 1;
+		}
+	}
+
+	for ( int i = 0; i < numPos; i++ ) {
+		for ( int c = 0; c < numClasses; c++ ) {
+			int stamp = i * numClasses + c;
+			index[stamp] = targs.length();
+			for ( int j = closureStart[i]; j < closureStart[i+1]; j++ ) {
+				NfaState *state = nfa->states[closures[j]];
+				for ( int t = 0; t < state->outList.length(); t++ ) {
+					NfaTrans &trans = state->outList[t];
+					if ( trans.lowKey - minKey <= classKey[c] &&
+							classKey[c] <= trans.highKey - minKey )
+					{
+						int targ = posOf[trans.targ];
+						if ( seen[targ] != stamp ) {
+							seen[targ] = stamp;
+							targs.append( targ );
+						}
+					}
+				}
+			}
+		}
+	}
+	int numTargs = targs.length();
+	index[numPos * numClasses] = numTargs;
+	if ( numTargs == 0 )
+		targs.append( 0 );
+
+	int words = ( numPos + 31 ) / 32;
+	long slots = lazyStates;
+	string alphType = ALPH_TYPE();
+	string prefix = DATA_PREFIX();
+	ostringstream classOf;
+	classOf << "(int)(*p)";
+	if ( minKey < 0 )
+		classOf << " + " << -minKey;
+	else if ( minKey > 0 )
+		classOf << " - " << minKey;
+
+	out <<
+		"#include <string.h>\n"
+		"\n";
+
+	OPEN_ARRAY( ARRAY_TYPE( numClasses - 1 ), LC() );
+	ARRAY_ITEMS( cls, span );
+	CLOSE_ARRAY() << "\n";
+
+	OPEN_ARRAY( ARRAY_TYPE( numTargs ), LI() );
+	ARRAY_ITEMS( index, numPos * numClasses + 1 );
+	CLOSE_ARRAY() << "\n";
+
+	OPEN_ARRAY( ARRAY_TYPE( numPos - 1 ), LT() );
+	ARRAY_ITEMS( targs.data, targs.length() );
+	CLOSE_ARRAY() << "\n";
+
+	OPEN_ARRAY( ARRAY_TYPE( 1 ), LF() );
+	ARRAY_ITEMS( final, numPos );
+	CLOSE_ARRAY() << "\n";
+
+	out <<
+		"struct " << prefix << "lazy\n"
+		"{\n"
+		"	int cs;\n"
+		"	int nslots;\n"
+		"	unsigned int flushes;\n"
+		"	unsigned int work[" << words << "];\n"
+		"	unsigned int sets[" << slots << "][" << words << "];\n"
+		"	int next[" << slots << "][" << numClasses << "];\n"
+		"	unsigned char final[" << slots << "];\n"
+		"	int hash[" << slots * 2 << "];\n"
+		"};\n"
+		"\n"
+		"static int " << prefix << "lazy_slot( struct " << prefix << "lazy *m )\n"
+		"{\n"
+		"	unsigned int h = 2166136261u, bits;\n"
+		"	int i, w, b, slot;\n"
+		"\n"
+		"	for ( w = 0; w < " << words << "; w++ )\n"
+		"		h = ( h ^ m->work[w] ) * 16777619u;\n"
+		"\n"
+		"	i = h % " << slots * 2 << ";\n"
+		"	while ( m->hash[i] != 0 ) {\n"
+		"		slot = m->hash[i] - 1;\n"
+		"		if ( memcmp( m->sets[slot], m->work, sizeof(m->work) ) == 0 )\n"
+		"			return slot;\n"
+		"		i = ( i + 1 ) % " << slots * 2 << ";\n"
+		"	}\n"
+		"\n"
+		"	/* A full cache starts again. */\n"
+		"	if ( m->nslots == " << slots << " ) {\n"
+		"		m->nslots = 0;\n"
+		"		m->flushes += 1;\n"
+		"		memset( m->hash, 0, sizeof(m->hash) );\n"
+		"		i = h % " << slots * 2 << ";\n"
+		"	}\n"
+		"\n"
+		"	slot = m->nslots++;\n"
+		"	memcpy( m->sets[slot], m->work, sizeof(m->work) );\n"
+		"	memset( m->next[slot], 0xff, sizeof(m->next[slot]) );\n"
+		"	m->final[slot] = 0;\n"
+		"	for ( w = 0; w < " << words << "; w++ ) {\n"
+		"		for ( bits = m->work[w], b = 0; bits != 0; bits >>= 1, b++ ) {\n"
+		"			if ( ( bits & 1 ) && " << LF() << "[w * 32 + b] )\n"
+		"				m->final[slot] = 1;\n"
+		"		}\n"
+		"	}\n"
+		"	m->hash[i] = slot + 1;\n"
+		"	return slot;\n"
+		"}\n"
+		"\n"
+		"static int " << prefix << "lazy_step( struct " << prefix <<
+				"lazy *m, int cs, int c )\n"
+		"{\n"
+		"	unsigned int flushes = m->flushes, bits;\n"
+		"	int w, b, i, j, t, any = 0;\n"
+		"\n"
+		"	memset( m->work, 0, sizeof(m->work) );\n"
+		"	for ( w = 0; w < " << words << "; w++ ) {\n"
+		"		for ( bits = m->sets[cs][w], b = 0; bits != 0; bits >>= 1, b++ ) {\n"
+		"			if ( bits & 1 ) {\n"
+		"				i = ( w * 32 + b ) * " << numClasses << " + c;\n"
+		"				for ( j = " << LI() << "[i]; j < " << LI() << "[i+1]; j++ ) {\n"
+		"					t = " << LT() << "[j];\n"
+		"					m->work[t / 32] |= 1u << ( t % 32 );\n"
+		"					any = 1;\n"
+		"				}\n"
+		"			}\n"
+		"		}\n"
+		"	}\n"
+		"\n"
+		"	if ( !any ) {\n"
+		"		m->next[cs][c] = -2;\n"
+		"		return -2;\n"
+		"	}\n"
+		"\n"
+		"	/* The transition is kept only if the cache still has cs. */\n"
+		"	t = " << prefix << "lazy_slot( m );\n"
+		"	if ( m->flushes == flushes )\n"
+		"		m->next[cs][c] = t;\n"
+		"	return t;\n"
+		"}\n"
+		"\n"
+		"static void " << prefix << "lazy_start( struct " << prefix << "lazy *m )\n"
+		"{\n"
+		"	memset( m->work, 0, sizeof(m->work) );\n"
+		"	m->work[0] = 1;\n"
+		"	m->cs = " << prefix << "lazy_slot( m );\n"
+		"}\n"
+		"\n"
+		"static void " << prefix << "lazy_init( struct " << prefix << "lazy *m )\n"
+		"{\n"
+		"	m->nslots = 0;\n"
+		"	m->flushes = 0;\n"
+		"	memset( m->hash, 0, sizeof(m->hash) );\n"
+		"	" << prefix << "lazy_start( m );\n"
+		"}\n"
+		"\n"
+		"static const " << alphType << " *" << prefix << "lazy_exec( struct " <<
+				prefix << "lazy *m, const " << alphType << " *p, const " <<
+				alphType << " *pe )\n"
+		"{\n"
+		"	int cs = m->cs, c, t;\n"
+		"\n"
+		"	if ( cs < 0 )\n"
+		"		return p;\n"
+		"\n"
+		"	for ( ; p < pe; p++ ) {\n"
+		"		c = " << LC() << "[" << classOf.str() << "];\n"
+		"		t = m->next[cs][c];\n"
+		"		if ( t == -1 )\n"
+		"			t = " << prefix << "lazy_step( m, cs, c );\n"
+		"		if ( t < 0 ) {\n"
+		"			m->cs = -1;\n"
+		"			return p;\n"
+		"		}\n"
+		"		cs = t;\n"
+		"	}\n"
+		"	m->cs = cs;\n"
+		"	return p;\n"
+		"}\n"
+		"\n"
+		"static int " << prefix << "lazy_final( struct " << prefix << "lazy *m )\n"
+		"{\n"
+		"	return m->cs >= 0 && m->final[m->cs];\n"
+		"}\n"
+		"\n";
+
+	delete[] posOf;
+	delete[] mark;
+	delete[] stack;
+	delete[] cls;
+	delete[] remap;
+	delete[] classKey;
+	delete[] index;
+	delete[] final;
+	delete[] seen;
+}
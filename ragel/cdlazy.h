@@ -0,0 +1,64 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _CDLAZY_H
+#define _CDLAZY_H
+
+#include <iostream>
+#include <string>
+#include "gendata.h"
+
+using std::string;
+
+/* Forwards. */
+struct NfaGraph;
+
+/*
+ * CLazyCodeGen
+ *
+ * Writes a machine made with --lazy. The graph is written without epsilon
+ * transitions, over classes of keys, and is run by a C API that makes the
+ * deterministic states as they are reached and keeps them in a cache of
+ * lazyStates states. A full cache is emptied and filled again.
+ */
+class CLazyCodeGen : public CodeGenData
+{
+public:
+	CLazyCodeGen( ostream &out, NfaGraph *nfa ) :
+		CodeGenData(out), nfa(nfa) {}
+
+	virtual bool writeStatement( InputLoc &loc, int nargs, char **args );
+
+protected:
+	string DATA_PREFIX();
+	string ALPH_TYPE();
+	string ARRAY_TYPE( unsigned long maxVal );
+	ostream &OPEN_ARRAY( string type, string name );
+	ostream &CLOSE_ARRAY();
+	void ARRAY_ITEMS( int *vals, int length );
+
+	string LC() { return "_" + DATA_PREFIX() + "lazy_class"; }
+	string LI() { return "_" + DATA_PREFIX() + "lazy_index"; }
+	string LT() { return "_" + DATA_PREFIX() + "lazy_targs"; }
+	string LF() { return "_" + DATA_PREFIX() + "lazy_final"; }
+
+	void writeLazy();
+
+	NfaGraph *nfa;
+};
+
+#endif
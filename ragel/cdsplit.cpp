@@ -91,6 +91,9 @@ void SplitCodeGen::GOTO_HEADER( RedStateAp *state, bool stateInPartition )
 	out << "	/* fall through */ \n";
 	out << "case " << state->id << ":\n";
 
+	if ( instrument )
+		out << INSTRUMENT( state );
+
 	if ( state->fromStateAction != 0 ) {
 		/* Remember that we wrote an action. Write every action in the list. */
 		anyWritten = true;
@@ -123,10 +126,8 @@ std::ostream &SplitCodeGen::STATE_GOTOS( int partition )
 				/* Writing code above state gotos. */
 				GOTO_HEADER( st, st->partition == partition );
 
-				if ( st->stateCondVect.length() > 0 ) {
-					out << "	_widec = " << GET_KEY() << ";\n";
-					emitCondBSearch( st, 1, 0, st->stateCondVect.length() - 1 );
-				}
+				if ( st->stateCondVect.length() > 0 )
+					emitCondWidec( st );
 
 				/* Try singles. */
 				if ( st->outSingle.length() > 0 )
@@ -177,6 +178,14 @@ std::ostream &SplitCodeGen::PART_TRANS( int partition )
 				"	pst" << st->id << ":\n" 
 				"	" << vCS() << " = " << st->id << ";\n";
 
+			/* The error state stops the machine on the current character,
+			 * the same as it does in the partition holding it. */
+			if ( st == redFsm->errState ) {
+				outLabelUsed = true;
+				out << "	goto _out; \n";
+				continue;
+			}
+
 			if ( st->toStateAction != 0 ) {
 				/* Remember that we wrote an action. Write every action in the list. */
 				for ( GenActionTable::Iter item = st->toStateAction->key; item.lte(); item++ ) {
@@ -322,8 +331,10 @@ void SplitCodeGen::writeData()
 			"\n";
 	}
 
+	INSTRUMENT_DATA();
+
 
-	OPEN_ARRAY( ARRAY_TYPE(numSplitPartitions), PM() );
+	OPEN_ARRAY( ARRAY_TYPE(redFsm->nParts), PM() );
 	PART_MAP();
 	CLOSE_ARRAY() <<
 	"\n";
@@ -903,6 +903,7 @@ void TabCodeGen::writeData()
 	}
 
 	STATE_IDS();
+	INSTRUMENT_DATA();
 }
 
 void TabCodeGen::COND_TRANSLATE()
@@ -1006,6 +1007,9 @@ void TabCodeGen::writeExec()
 
 	out << "_resume:\n";
 
+	if ( instrument )
+		out << INSTRUMENT( vCS() );
+
 	if ( redFsm->anyFromStateActions() ) {
 		out <<
 			"	_acts = " << ARR_OFF( A(),  FSA() + "[" + vCS() + "]" ) << ";\n"
@@ -1019,8 +1023,11 @@ void TabCodeGen::writeExec()
 			"\n";
 	}
 
-	if ( redFsm->anyConditions() )
+	if ( redFsm->anyConditions() ) {
 		COND_TRANSLATE();
+		if ( instrument )
+			out << INSTRUMENT_KEY( vCS(), "_widec" );
+	}
 
 	LOCATE_TRANS();
 
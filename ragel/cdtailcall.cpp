@@ -0,0 +1,590 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ * 
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA 
+ */
+
+#include "ragel.h"
+#include "cdtailcall.h"
+#include "redfsm.h"
+#include "gendata.h"
+#include <sstream>
+
+using std::ostringstream;
+
+/* Does the action code go to another state? */
+static bool anyStateChange( GenInlineList *inlineList )
+{
+	for ( GenInlineList::Iter item = *inlineList; item.lte(); item++ ) {
+		switch ( item->type ) {
+		case GenInlineItem::Goto: case GenInlineItem::Call:
+		case GenInlineItem::GotoExpr: case GenInlineItem::CallExpr:
+		case GenInlineItem::Ret:
+			return true;
+		default: break;
+		}
+
+		if ( item->children != 0 && anyStateChange( item->children ) )
+			return true;
+	}
+	return false;
+}
+
+string TailCallCodeGen::FUNC( const char *kind, int id )
+{
+	ostringstream ret;
+	ret << "_" << DATA_PREFIX() << kind << id;
+	return ret.str();
+}
+
+string TailCallCodeGen::FUNC( const char *kind )
+{
+	return "_" + DATA_PREFIX() + kind;
+}
+
+string TailCallCodeGen::PARAMS()
+{
+	string ret = ALPH_TYPE() + " *p, " + ALPH_TYPE() + " *pe, struct " + 
+			FSM_NAME() + " *fsm, struct " + FUNC( "run" ) + " *_r";
+	if ( redFsm->anyRegCurStateRef() )
+		ret += ", int _ps";
+	return ret;
+}
+
+string TailCallCodeGen::ARGS()
+{
+	if ( inStateFuncs ) {
+		string ret = "p, pe, fsm, _r";
+		if ( redFsm->anyRegCurStateRef() )
+			ret += ", _ps";
+		return ret;
+	}
+
+	string ret = "&" + P() + ", " + ( noEnd ? string("0") : PE() ) + ", fsm";
+	if ( redFsm->anyRegCurStateRef() )
+		ret += ", _ps";
+	return ret;
+}
+
+string TailCallCodeGen::TAIL_CALL( const string &func )
+{
+	return FUNC( "TAIL" ) + "( " + func + " );";
+}
+
+/* Enter the functions from the exec block, running the trampoline if the
+ * functions bounce back. */
+string TailCallCodeGen::EXEC_CALL( const string &func )
+{
+	return FUNC( "call" ) + "( " + func + ", " + ARGS() + " )";
+}
+
+void TailCallCodeGen::AGAIN( ostream &ret, bool inFinish )
+{
+	if ( inStateFuncs )
+		ret << TAIL_CALL( FUNC( "again" ) );
+	else {
+		if ( inFinish && !noEnd )
+			FsmCodeGen::EOF_CHECK( ret );
+		againUsed = true;
+		ret << CTRL_FLOW() << "goto _again;";
+	}
+}
+
+void TailCallCodeGen::GOTO( ostream &ret, int gotoDest, bool inFinish )
+{
+	if ( inStateFuncs )
+		ret << "{" << TAIL_CALL( FUNC( "st", gotoDest ) ) << "}";
+	else {
+		ret << "{" << vCS() << " = " << gotoDest << ";";
+		AGAIN( ret, inFinish );
+		ret << "}";
+	}
+}
+
+void TailCallCodeGen::CALL( ostream &ret, int callDest, int targState, bool inFinish )
+{
+	if ( prePushExpr != 0 ) {
+		ret << "{";
+		INLINE_LIST( ret, prePushExpr, 0, false, false );
+	}
+
+	ret << "{" << STACK() << "[" << TOP() << "++] = " << targState << ";";
+
+	if ( inStateFuncs )
+		ret << TAIL_CALL( FUNC( "st", callDest ) );
+	else {
+		ret << vCS() << " = " << callDest << ";";
+		AGAIN( ret, inFinish );
+	}
+
+	ret << "}";
+
+	if ( prePushExpr != 0 )
+		ret << "}";
+}
+
+void TailCallCodeGen::CALL_EXPR( ostream &ret, GenInlineItem *ilItem, int targState, bool inFinish )
+{
+	if ( prePushExpr != 0 ) {
+		ret << "{";
+		INLINE_LIST( ret, prePushExpr, 0, false, false );
+	}
+
+	ret << "{" << STACK() << "[" << TOP() << "++] = " << targState << "; " << vCS() << " = (";
+	INLINE_LIST( ret, ilItem->children, 0, inFinish, false );
+	ret << ");";
+
+	AGAIN( ret, inFinish );
+
+	ret << "}";
+
+	if ( prePushExpr != 0 )
+		ret << "}";
+}
+
+void TailCallCodeGen::RET( ostream &ret, bool inFinish )
+{
+	ret << "{" << vCS() << " = " << STACK() << "[--" << TOP() << "];";
+
+	if ( postPopExpr != 0 ) {
+		ret << "{";
+		INLINE_LIST( ret, postPopExpr, 0, false, false );
+		ret << "}";
+	}
+
+	AGAIN( ret, inFinish );
+
+	ret << "}";
+}
+
+void TailCallCodeGen::GOTO_EXPR( ostream &ret, GenInlineItem *ilItem, bool inFinish )
+{
+	ret << "{" << vCS() << " = (";
+	INLINE_LIST( ret, ilItem->children, 0, inFinish, false );
+	ret << ");";
+
+	AGAIN( ret, inFinish );
+
+	ret << "}";
+}
+
+void TailCallCodeGen::NEXT( ostream &ret, int nextDest, bool inFinish )
+{
+	ret << vCS() << " = " << nextDest << ";";
+}
+
+void TailCallCodeGen::NEXT_EXPR( ostream &ret, GenInlineItem *ilItem, bool inFinish )
+{
+	ret << vCS() << " = (";
+	INLINE_LIST( ret, ilItem->children, 0, inFinish, false );
+	ret << ");";
+}
+
+void TailCallCodeGen::CURS( ostream &ret, bool inFinish )
+{
+	ret << "(_ps)";
+}
+
+void TailCallCodeGen::TARGS( ostream &ret, bool inFinish, int targState )
+{
+	ret << targState;
+}
+
+void TailCallCodeGen::BREAK( ostream &ret, int targState, bool csForced )
+{
+	ret << "{" << P() << "++; ";
+	if ( !csForced ) 
+		ret << vCS() << " = " << targState << "; ";
+
+	if ( inStateFuncs )
+		ret << "_r->p = p; return 1;}";
+	else {
+		outLabelUsed = true;
+		ret << CTRL_FLOW() << "goto _out;}";
+	}
+}
+
+/* Emit the call to make for a given transition. */
+std::ostream &TailCallCodeGen::TRANS_GOTO( RedTransAp *trans, int level )
+{
+	if ( trans->action != 0 )
+		out << TABS(level) << TAIL_CALL( FUNC( "tr", trans->id ) );
+	else
+		out << TABS(level) << TAIL_CALL( FUNC( "st", trans->targ->id ) );
+	return out;
+}
+
+/* Without musttail a plain call may not be turned into a jump and the stack
+ * would grow with the input. The functions then return 2 with the next
+ * function in the run struct and the call function loops on it. */
+std::ostream &TailCallCodeGen::TAIL_DEFINES()
+{
+	string ps = redFsm->anyRegCurStateRef() ? ", _ps" : "";
+	string psSave = redFsm->anyRegCurStateRef() ? " _r->ps = _ps;" : "";
+	string psArg = redFsm->anyRegCurStateRef() ? ", _r.ps" : "";
+
+	out <<
+		"#ifndef RAGEL_MUSTTAIL\n"
+		"#if defined(__has_attribute)\n"
+		"#if __has_attribute(musttail)\n"
+		"#define RAGEL_MUSTTAIL __attribute__((musttail))\n"
+		"#endif\n"
+		"#endif\n"
+		"#endif\n"
+		"\n"
+		"struct " << FUNC( "run" ) << ";\n"
+		"typedef int (*" << FUNC( "func" ) << ")( " << PARAMS() << " );\n"
+		"struct " << FUNC( "run" ) << "\n"
+		"{\n"
+		"	" << ALPH_TYPE() << " *p;\n"
+		"	" << FUNC( "func" ) << " fn;\n"
+		"	int ps;\n"
+		"};\n"
+		"\n"
+		"#ifdef RAGEL_MUSTTAIL\n"
+		"#define " << FUNC( "TAIL" ) << "( f ) RAGEL_MUSTTAIL return f( p, pe, fsm, _r" << ps << " )\n"
+		"#else\n"
+		"#define " << FUNC( "TAIL" ) << "( f ) do { _r->p = p; _r->fn = f;" << psSave << " return 2; } while ( 0 )\n"
+		"#endif\n"
+		"\n"
+		"static int " << FUNC( "call" ) << "( " << FUNC( "func" ) << " _fn, " << 
+				ALPH_TYPE() << " **_pp, " << ALPH_TYPE() << " *pe, struct " << 
+				FSM_NAME() << " *fsm" << ( redFsm->anyRegCurStateRef() ? ", int _ps" : "" ) << " )\n"
+		"{\n"
+		"	struct " << FUNC( "run" ) << " _r;\n"
+		"	int _stat = _fn( *_pp, pe, fsm, &_r" << ps << " );\n"
+		"	while ( _stat == 2 )\n"
+		"		_stat = _r.fn( _r.p, pe, fsm, &_r" << psArg << " );\n"
+		"	*_pp = _r.p;\n"
+		"	return _stat;\n"
+		"}\n"
+		"\n";
+	return out;
+}
+
+std::ostream &TailCallCodeGen::PROTOTYPES()
+{
+	for ( TransApSet::Iter trans = redFsm->transSet; trans.lte(); trans++ ) {
+		if ( trans->action != 0 )
+			out << "static int " << FUNC( "tr", trans->id ) << "( " << PARAMS() << " );\n";
+	}
+
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ ) {
+		out << 
+			"static int " << FUNC( "st", st->id ) << "( " << PARAMS() << " );\n"
+			"static int " << FUNC( "ent", st->id ) << "( " << PARAMS() << " );\n";
+	}
+
+	out << 
+		"static int " << FUNC( "again" ) << "( " << PARAMS() << " );\n"
+		"static int " << FUNC( "resume" ) << "( " << PARAMS() << " );\n"
+		"\n";
+	return out;
+}
+
+/* A function for each transition with actions. It runs the actions then
+ * calls the target state. */
+std::ostream &TailCallCodeGen::TRANS_FUNCS()
+{
+	for ( TransApSet::Iter trans = redFsm->transSet; trans.lte(); trans++ ) {
+		if ( trans->action == 0 )
+			continue;
+
+		out << 
+			"static int " << FUNC( "tr", trans->id ) << "( " << PARAMS() << " )\n"
+			"{\n";
+
+		/* If the action contains a next, then we must preload the current
+		 * state since the action may or may not set it. */
+		if ( trans->action->anyNextStmt() )
+			out << "	" << vCS() << " = " << trans->targ->id << ";\n";
+
+		for ( GenActionTable::Iter item = trans->action->key; item.lte(); item++ ) {
+			ACTION( out, item->value, trans->targ->id, false, 
+					trans->action->anyNextStmt() );
+		}
+		genLineDirective( out );
+
+		/* If the action contains a next then we need to reload, otherwise
+		 * go directly to the target state. */
+		if ( trans->action->anyNextStmt() )
+			out << "	" << TAIL_CALL( FUNC( "again" ) ) << "\n";
+		else
+			out << "	" << TAIL_CALL( FUNC( "st", trans->targ->id ) ) << "\n";
+
+		out << "}\n\n";
+	}
+	return out;
+}
+
+/* Each state has two functions. The st function is called when a transition
+ * goes to the state. It runs the to-state actions and moves to the next key.
+ * The ent function, which is also where the machine resumes, picks the
+ * transition for the current key. */
+std::ostream &TailCallCodeGen::STATE_FUNCS()
+{
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ ) {
+		out << 
+			"static int " << FUNC( "st", st->id ) << "( " << PARAMS() << " )\n"
+			"{\n";
+
+		if ( st == redFsm->errState ) {
+			out << 
+				"	" << vCS() << " = " << st->id << ";\n"
+				"	_r->p = p;\n"
+				"	return 1;\n"
+				"}\n"
+				"\n"
+				"static int " << FUNC( "ent", st->id ) << "( " << PARAMS() << " )\n"
+				"{\n"
+				"	" << TAIL_CALL( FUNC( "st", st->id ) ) << "\n"
+				"}\n"
+				"\n";
+			continue;
+		}
+
+		if ( st->toStateAction != 0 ) {
+			for ( GenActionTable::Iter item = st->toStateAction->key; item.lte(); item++ ) {
+				ACTION( out, item->value, st->id, false, 
+						st->toStateAction->anyNextStmt() );
+			}
+			genLineDirective( out );
+		}
+
+		if ( !noEnd ) {
+			out <<
+				"	if ( ++p == pe ) {\n"
+				"		" << vCS() << " = " << st->id << ";\n"
+				"		_r->p = p;\n"
+				"		return 0;\n"
+				"	}\n";
+		}
+		else {
+			out << 
+				"	p += 1;\n";
+		}
+
+		out << 
+			"	" << TAIL_CALL( FUNC( "ent", st->id ) ) << "\n"
+			"}\n"
+			"\n"
+			"static int " << FUNC( "ent", st->id ) << "( " << PARAMS() << " )\n"
+			"{\n";
+
+		if ( st->stateCondVect.length() > 0 )
+			out << "	" << WIDE_ALPH_TYPE() << " _widec;\n";
+
+		if ( instrument )
+			out << INSTRUMENT( st );
+
+		if ( st->fromStateAction != 0 ) {
+			for ( GenActionTable::Iter item = st->fromStateAction->key; item.lte(); item++ ) {
+				ACTION( out, item->value, st->id, false,
+						st->fromStateAction->anyNextStmt() );
+			}
+			genLineDirective( out );
+		}
+
+		/* Record the prev state if necessary. */
+		if ( st->anyRegCurStateRef() )
+			out << "	_ps = " << st->id << ";\n";
+
+		if ( st->stateCondVect.length() > 0 )
+			emitCondWidec( st );
+
+		/* Try singles. */
+		if ( st->outSingle.length() > 0 )
+			emitSingleSwitch( st );
+
+		/* Default case is to binary search for the ranges, if that fails then */
+		if ( st->outRange.length() > 0 )
+			emitRangeBSearch( st, 1, 0, st->outRange.length() - 1 );
+
+		/* Write the default transition. */
+		TRANS_GOTO( st->defTrans, 1 ) << "\n";
+
+		out << 
+			"}\n"
+			"\n";
+	}
+	return out;
+}
+
+/* Switches on the current state. The again function goes through the st
+ * functions and the resume function through the ent functions. */
+std::ostream &TailCallCodeGen::DISPATCH_FUNCS()
+{
+	out << 
+		"static int " << FUNC( "again" ) << "( " << PARAMS() << " )\n"
+		"{\n"
+		"	switch ( " << vCS() << " ) {\n";
+
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ ) {
+		out << "	case " << st->id << ": " << 
+				TAIL_CALL( FUNC( "st", st->id ) ) << "\n";
+	}
+
+	out << 
+		"	}\n"
+		"	_r->p = p;\n"
+		"	return 1;\n"
+		"}\n"
+		"\n"
+		"static int " << FUNC( "resume" ) << "( " << PARAMS() << " )\n"
+		"{\n"
+		"	switch ( " << vCS() << " ) {\n";
+
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ ) {
+		out << "	case " << st->id << ": " << 
+				TAIL_CALL( FUNC( "ent", st->id ) ) << "\n";
+	}
+
+	out << 
+		"	}\n"
+		"	_r->p = p;\n"
+		"	return 1;\n"
+		"}\n"
+		"\n";
+	return out;
+}
+
+std::ostream &TailCallCodeGen::FINISH_CASES()
+{
+	bool anyWritten = false;
+
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ ) {
+		if ( st->eofAction != 0 ) {
+			if ( st->eofAction->eofRefs == 0 )
+				st->eofAction->eofRefs = new IntSet;
+			st->eofAction->eofRefs->insert( st->id );
+		}
+	}
+
+	for ( RedStateList::Iter st = redFsm->stateList; st.lte(); st++ ) {
+		if ( st->eofTrans != 0 ) {
+			outLabelUsed = true;
+			testEofUsed = true;
+			out << 
+				"	case " << st->id << ":\n"
+				"		_stat = " << EXEC_CALL( FUNC( "tr", st->eofTrans->id ) ) << ";\n"
+				"		if ( _stat != 0 )\n"
+				"			goto _out;\n"
+				"		goto _test_eof;\n";
+		}
+	}
+
+	for ( GenActionTableMap::Iter act = redFsm->actionMap; act.lte(); act++ ) {
+		if ( act->eofRefs != 0 ) {
+			for ( IntSet::Iter pst = *act->eofRefs; pst.lte(); pst++ )
+				out << "	case " << *pst << ": \n";
+
+			/* Remember that we wrote a trans so we know to write the
+			 * line directive for going back to the output. */
+			anyWritten = true;
+
+			/* Write each action in the eof action list. */
+			for ( GenActionTable::Iter item = act->key; item.lte(); item++ )
+				ACTION( out, item->value, STATE_ERR_STATE, true, true );
+			out << "\tbreak;\n";
+		}
+	}
+
+	if ( anyWritten )
+		genLineDirective( out );
+	return out;
+}
+
+void TailCallCodeGen::writeData()
+{
+	STATE_IDS();
+	INSTRUMENT_DATA();
+
+	inStateFuncs = true;
+	TAIL_DEFINES();
+	PROTOTYPES();
+	TRANS_FUNCS();
+	STATE_FUNCS();
+	DISPATCH_FUNCS();
+	inStateFuncs = false;
+}
+
+void TailCallCodeGen::writeExec()
+{
+	testEofUsed = false;
+	outLabelUsed = true;
+
+	/* Eof actions that go to another state continue through _again. */
+	againUsed = false;
+	for ( GenActionTableMap::Iter act = redFsm->actionMap; act.lte(); act++ ) {
+		if ( act->numEofRefs > 0 ) {
+			for ( GenActionTable::Iter item = act->key; item.lte(); item++ ) {
+				if ( anyStateChange( item->value->inlineList ) )
+					againUsed = true;
+			}
+		}
+	}
+
+	out << 
+		"	{\n"
+		"	int _stat;\n";
+
+	if ( redFsm->anyRegCurStateRef() )
+		out << "	int _ps = 0;\n";
+
+	if ( !noEnd ) {
+		testEofUsed = true;
+		out << 
+			"	if ( " << P() << " == " << PE() << " )\n"
+			"		goto _test_eof;\n";
+	}
+
+	out << 
+		"	_stat = " << EXEC_CALL( FUNC( "resume" ) ) << ";\n"
+		"	if ( _stat != 0 )\n"
+		"		goto _out;\n";
+
+	if ( redFsm->anyEofTrans() )
+		testEofUsed = true;
+
+	if ( testEofUsed ) 
+		out << "	_test_eof: {}\n";
+
+	if ( redFsm->anyEofTrans() || redFsm->anyEofActions() ) {
+		out <<
+			"	if ( " << P() << " == " << vEOF() << " )\n"
+			"	{\n"
+			"	switch ( " << vCS() << " ) {\n";
+			FINISH_CASES();
+			SWITCH_DEFAULT() <<
+			"	}\n"
+			"	}\n"
+			"\n";
+	}
+
+	if ( againUsed ) {
+		out <<
+			"	goto _out;\n"
+			"_again:\n"
+			"	_stat = " << EXEC_CALL( FUNC( "again" ) ) << ";\n"
+			"	if ( _stat != 0 )\n"
+			"		goto _out;\n";
+
+		if ( !noEnd )
+			out << "	goto _test_eof;\n";
+	}
+
+	out << 
+		"	_out: {}\n"
+		"	}\n";
+}
@@ -0,0 +1,99 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ * 
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA 
+ */
+
+#ifndef _CDTAILCALL_H
+#define _CDTAILCALL_H
+
+#include <iostream>
+#include "cdgoto.h"
+
+/* Forwards. */
+struct CodeGenData;
+
+/*
+ * TailCallCodeGen
+ *
+ * Goto-driven code where every state, and every transition with actions, is
+ * a small function. Moving between them is a tail call that carries p and pe
+ * in registers. The calls must be marked musttail, which needs a compiler
+ * with the attribute (clang, GCC 15), for the stack to stay flat. Without it
+ * the functions return the next one and the exec loops on it instead, a
+ * trampoline that costs a return and a call per step.
+ * The functions are written with the data and, as with -P, reach the machine
+ * through the struct named after the machine, passed as fsm. The data must
+ * come after the struct is complete and actions may not use locals of the
+ * function that contains the exec.
+ */
+class TailCallCodeGen : public GotoCodeGen
+{
+public:
+	TailCallCodeGen( ostream &out ) : 
+		FsmCodeGen(out), GotoCodeGen(out), inStateFuncs(false), againUsed(false) {}
+
+	string FUNC( const char *kind, int id );
+	string FUNC( const char *kind );
+	string PARAMS();
+	string ARGS();
+	string TAIL_CALL( const string &func );
+	string EXEC_CALL( const string &func );
+
+	std::ostream &TRANS_GOTO( RedTransAp *trans, int level );
+	std::ostream &TAIL_DEFINES();
+	std::ostream &PROTOTYPES();
+	std::ostream &TRANS_FUNCS();
+	std::ostream &STATE_FUNCS();
+	std::ostream &DISPATCH_FUNCS();
+	std::ostream &FINISH_CASES();
+
+	void GOTO( ostream &ret, int gotoDest, bool inFinish );
+	void CALL( ostream &ret, int callDest, int targState, bool inFinish );
+	void NEXT( ostream &ret, int nextDest, bool inFinish );
+	void GOTO_EXPR( ostream &ret, GenInlineItem *ilItem, bool inFinish );
+	void NEXT_EXPR( ostream &ret, GenInlineItem *ilItem, bool inFinish );
+	void CALL_EXPR( ostream &ret, GenInlineItem *ilItem, int targState, bool inFinish );
+	void RET( ostream &ret, bool inFinish );
+	void CURS( ostream &ret, bool inFinish );
+	void TARGS( ostream &ret, bool inFinish, int targState );
+	void BREAK( ostream &ret, int targState, bool csForced );
+
+	virtual void writeData();
+	virtual void writeExec();
+
+protected:
+	/* Go to the state in cs, from a state function or from the eof
+	 * actions. */
+	void AGAIN( ostream &ret, bool inFinish );
+
+	/* Set while the state functions are being written, as opposed to the
+	 * exec block. */
+	bool inStateFuncs;
+
+	/* The exec block needs its _again label. */
+	bool againUsed;
+};
+
+/*
+ * class CTailCallCodeGen
+ */
+struct CTailCallCodeGen
+	: public TailCallCodeGen, public CCodeGen
+{
+	CTailCallCodeGen( ostream &out ) : 
+		FsmCodeGen(out), TailCallCodeGen(out), CCodeGen(out) {}
+};
+
+#endif
@@ -716,7 +716,7 @@ void CrystalCodeGen::finishRagelDef()
 		return;
 	
 	if ( codeStyle == GenSplit )
-		redFsm->partitionFsm( numSplitPartitions );
+		redFsm->partitionFsm( numSplitPartitions, partitionSize );
 
 	if ( codeStyle == GenIpGoto || codeStyle == GenSplit )
 		redFsm->setInTrans();
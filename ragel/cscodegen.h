@@ -122,6 +122,7 @@ protected:
 	string EA() { return "_" + DATA_PREFIX() + "eof_actions"; }
 	string ET() { return "_" + DATA_PREFIX() + "eof_trans"; }
 	string SP() { return "_" + DATA_PREFIX() + "key_spans"; }
+	string RB() { return "_" + DATA_PREFIX() + "range_bits"; }
 	string CSP() { return "_" + DATA_PREFIX() + "cond_key_spans"; }
 	string START() { return DATA_PREFIX() + "start"; }
 	string ERROR() { return DATA_PREFIX() + "error"; }
@@ -173,6 +173,13 @@ void CSharpFGotoCodeGen::writeData()
 		"\n";
 	}
 
+	if ( redFsm->rangeBits.length() > 0 ) {
+		OPEN_ARRAY( ARRAY_TYPE(0xff), RB() );
+		RANGE_BITS();
+		CLOSE_ARRAY() <<
+		"\n";
+	}
+
 	STATE_IDS();
 }
 
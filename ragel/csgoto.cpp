@@ -141,8 +141,55 @@ void CSharpGotoCodeGen::emitSingleSwitch( RedStateAp *state )
 	}
 }
 
+string CSharpGotoCodeGen::KEY_BOUNDS( Key lowKey, Key highKey )
+{
+	return keyBoundsTest( lowKey, highKey, GET_KEY(), KEY(lowKey), KEY(highKey) );
+}
+
+void CSharpGotoCodeGen::emitRangeBitmap( RedStateAp *state, int level )
+{
+	string bounds = KEY_BOUNDS( state->lowKey, state->highKey );
+	string offset = "(int)(" + GET_KEY() + " - " + KEY(state->lowKey) + ")";
+
+	if ( bounds.size() > 0 ) {
+		out << TABS(level) << "if ( " << bounds << " ) {\n";
+		level += 1;
+	}
+
+	for ( int t = 0; t < state->rangeTargs.length(); t++ ) {
+		out << TABS(level) << "if ( (" << RB() << "[" << 
+				redFsm->rangeBitmapStart( state, t ) << " + (" << offset << 
+				" >> 3)] & (1 << (" << offset << " & 7))) != 0 )\n";
+		TRANS_GOTO( state->rangeTargs[t], level+1 ) << "\n";
+	}
+
+	if ( bounds.size() > 0 )
+		out << TABS(level-1) << "}\n";
+}
+
+std::ostream &CSharpGotoCodeGen::RANGE_BITS()
+{
+	out << '\t';
+	for ( int pos = 0; pos < redFsm->rangeBits.length(); pos++ ) {
+		out << (unsigned int)redFsm->rangeBits[pos];
+		if ( pos < redFsm->rangeBits.length()-1 ) {
+			out << ", ";
+			if ( (pos+1) % IALL == 0 )
+				out << "\n\t";
+		}
+	}
+	out << "\n";
+	return out;
+}
+
 void CSharpGotoCodeGen::emitRangeBSearch( RedStateAp *state, int level, int low, int high )
 {
+	/* States with many ranges going to few targets test bitmaps instead. */
+	if ( state->rangeBitmap ) {
+		emitRangeBitmap( state, level );
+		return;
+	}
+
 	/* Get the mid position, staying on the lower end of the range. */
 	int mid = (low + high) >> 1;
 	RedTransEl *data = state->outRange.data;
@@ -654,6 +701,13 @@ void CSharpGotoCodeGen::writeData()
 		"\n";
 	}
 
+	if ( redFsm->rangeBits.length() > 0 ) {
+		OPEN_ARRAY( ARRAY_TYPE(0xff), RB() );
+		RANGE_BITS();
+		CLOSE_ARRAY() <<
+		"\n";
+	}
+
 	STATE_IDS();
 }
 
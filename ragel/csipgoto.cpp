@@ -356,6 +356,13 @@ void CSharpIpGotoCodeGen::setLabelsNeeded()
 
 void CSharpIpGotoCodeGen::writeData()
 {
+	if ( redFsm->rangeBits.length() > 0 ) {
+		OPEN_ARRAY( ARRAY_TYPE(0xff), RB() );
+		RANGE_BITS();
+		CLOSE_ARRAY() <<
+		"\n";
+	}
+
 	STATE_IDS();
 }
 
@@ -170,6 +170,14 @@ std::ostream &CSharpSplitCodeGen::PART_TRANS( int partition )
 				"	pst" << st->id << ":\n" 
 				"	" << vCS() << " = " << st->id << ";\n";
 
+			/* The error state stops the machine on the current character,
+			 * the same as it does in the partition holding it. */
+			if ( st == redFsm->errState ) {
+				outLabelUsed = true;
+				out << "	goto _out; \n";
+				continue;
+			}
+
 			if ( st->toStateAction != 0 ) {
 				/* Remember that we wrote an action. Write every action in the list. */
 				for ( GenActionTable::Iter item = st->toStateAction->key; item.lte(); item++ )
@@ -314,7 +322,7 @@ void CSharpSplitCodeGen::writeData()
 	}
 
 
-	OPEN_ARRAY( ARRAY_TYPE(numSplitPartitions), PM() );
+	OPEN_ARRAY( ARRAY_TYPE(redFsm->nParts), PM() );
 	PART_MAP();
 	CLOSE_ARRAY() <<
 	"\n";
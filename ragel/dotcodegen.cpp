@@ -129,10 +129,10 @@ std::ostream &GraphvizDotGen::ACTION( RedAction *action )
 	return out;
 }
 
-std::ostream &GraphvizDotGen::ONCHAR( Key lowKey, Key highKey )
+std::ostream &GraphvizDotGen::ONCHAR( RedStateAp *state, Key lowKey, Key highKey )
 {
 	GenCondSpace *condSpace;
-	if ( lowKey > keyOps->maxKey && (condSpace=findCondSpace(lowKey, highKey) ) ) {
+	if ( lowKey > keyOps->maxKey && (condSpace=findCondSpace(state, lowKey, highKey) ) ) {
 		Key values = ( lowKey - condSpace->baseKey ) / keyOps->alphSize();
 
 		lowKey = keyOps->minKey + 
@@ -185,13 +185,13 @@ void GraphvizDotGen::writeTransList( RedStateAp *state )
 
 			/* Begin the label. */
 			out << " [ label = \""; 
-			ONCHAR( tel->lowKey, tel->highKey );
+			ONCHAR( state, tel->lowKey, tel->highKey );
 
 			/* Walk the transition list, finding the same. */
 			for ( RedTransList::Iter mtel = tel.next(); mtel.lte(); mtel++ ) {
 				if ( mtel->value == tel->value ) {
 					out << ", ";
-					ONCHAR( mtel->lowKey, mtel->highKey );
+					ONCHAR( state, mtel->lowKey, mtel->highKey );
 				}
 			}
 
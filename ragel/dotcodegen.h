@@ -39,7 +39,7 @@ public:
 
 private:
 	/* Writing labels and actions. */
-	std::ostream &ONCHAR( Key lowKey, Key highKey );
+	std::ostream &ONCHAR( RedStateAp *state, Key lowKey, Key highKey );
 	std::ostream &TRANS_ACTION( RedStateAp *fromState, RedTransAp *trans );
 	std::ostream &ACTION( RedAction *action );
 	std::ostream &KEY( Key key );
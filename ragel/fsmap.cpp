@@ -20,6 +20,7 @@
  */
 
 #include "fsmgraph.h"
+#include "parallel.h"
 #include <iostream>
 using std::cerr;
 using std::endl;
@@ -832,17 +833,55 @@ void logCondSpace( CondSpace *condSpace );
 
 CondSpace *FsmAp::addCondSpace( const CondSet &condSet )
 {
+	if ( parallelFill != 0 )
+		parallelFill->condLock.lock();
+
 	CondSpace *condSpace = condData->condSpaceMap.find( condSet );
 	if ( condSpace == 0 ) {
 		/* Do we have enough keyspace left? */
 		Size availableSpace = condData->lastCondKey.availableSpace();
 		Size neededSpace = (1 << condSet.length() ) * keyOps->alphSize();
-		if ( neededSpace > availableSpace )
-			throw FsmConstructFail( FsmConstructFail::CondNoKeySpace );
 
-		Key baseKey = condData->lastCondKey;
-		baseKey.increment();
-		condData->lastCondKey += (1 << condSet.length() ) * keyOps->alphSize();
+		Key baseKey;
+		if ( condGuards && condData->guardSpace > 0 && 
+				neededSpace <= condData->guardSpace )
+		{
+			/* Fits in the shared range. */
+			baseKey = condData->guardBaseKey;
+		}
+		else if ( condGuards && condData->guardSpace > 0 && 
+				condData->guardBaseKey + ( condData->guardSpace - 1 ) == 
+				condData->lastCondKey )
+		{
+			/* The shared range is at the top, grow it. */
+			if ( neededSpace - condData->guardSpace > availableSpace ) {
+				if ( parallelFill != 0 )
+					parallelFill->condLock.unlock();
+				throw FsmConstructFail( FsmConstructFail::CondNoKeySpace );
+			}
+
+			baseKey = condData->guardBaseKey;
+			condData->lastCondKey += neededSpace - condData->guardSpace;
+			condData->guardSpace = neededSpace;
+		}
+		else {
+			if ( neededSpace > availableSpace ) {
+				if ( parallelFill != 0 )
+					parallelFill->condLock.unlock();
+				throw FsmConstructFail( FsmConstructFail::CondNoKeySpace );
+			}
+
+			baseKey = condData->lastCondKey;
+			baseKey.increment();
+			condData->lastCondKey += neededSpace;
+
+			/* Start a new shared range. Anything allocated after it, such as
+			 * length keys, stops it from growing. */
+			if ( condGuards ) {
+				condData->guardBaseKey = baseKey;
+				condData->guardSpace = neededSpace;
+			}
+		}
 
 		condSpace = new CondSpace( condSet );
 		condSpace->baseKey = baseKey;
@@ -856,6 +895,10 @@ CondSpace *FsmAp::addCondSpace( const CondSet &condSet )
 		cerr << "  baseKey: " << baseKey.getVal() << endl;
 		#endif
 	}
+
+	if ( parallelFill != 0 )
+		parallelFill->condLock.unlock();
+
 	return condSpace;
 }
 
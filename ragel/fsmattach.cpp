@@ -22,6 +22,7 @@
 #include <string.h>
 #include <assert.h>
 #include "fsmgraph.h"
+#include "parallel.h"
 
 #include <iostream>
 using namespace std;
@@ -30,6 +31,12 @@ using namespace std;
 void FsmAp::attachToInList( StateAp *from, StateAp *to, 
 		TransAp *&head, TransAp *trans )
 {
+	ParallelLock *inListLock = 0;
+	if ( parallelFill != 0 ) {
+		inListLock = &parallelFill->inListLock[parallelFill->inListShard( to )];
+		inListLock->lock();
+	}
+
 	trans->ilnext = head;
 	trans->ilprev = 0;
 
@@ -45,18 +52,32 @@ void FsmAp::attachToInList( StateAp *from, StateAp *to,
 		if ( misfitAccounting ) {
 			/* If the number of foreign in transitions is about to go up to 1 then
 			 * move it from the misfit list to the main list. */
-			if ( to->foreignInTrans == 0 )
+			if ( to->foreignInTrans == 0 ) {
+				if ( parallelFill != 0 )
+					parallelFill->listLock.lock();
 				stateList.append( misfitList.detach( to ) );
+				if ( parallelFill != 0 )
+					parallelFill->listLock.unlock();
+			}
 		}
 		
 		to->foreignInTrans += 1;
 	}
+
+	if ( inListLock != 0 )
+		inListLock->unlock();
 };
 
 /* Detach a transition from an inlist. The head of the inlist must be supplied. */
 void FsmAp::detachFromInList( StateAp *from, StateAp *to, 
 		TransAp *&head, TransAp *trans )
 {
+	ParallelLock *inListLock = 0;
+	if ( parallelFill != 0 ) {
+		inListLock = &parallelFill->inListLock[parallelFill->inListShard( to )];
+		inListLock->lock();
+	}
+
 	/* Detach in the inTransList. */
 	if ( trans->ilprev == 0 ) 
 		head = trans->ilnext; 
@@ -73,10 +94,18 @@ void FsmAp::detachFromInList( StateAp *from, StateAp *to,
 		if ( misfitAccounting ) {
 			/* If the number of foreign in transitions goes down to 0 then move it
 			 * from the main list to the misfit list. */
-			if ( to->foreignInTrans == 0 )
+			if ( to->foreignInTrans == 0 ) {
+				if ( parallelFill != 0 )
+					parallelFill->listLock.lock();
 				misfitList.append( stateList.detach( to ) );
+				if ( parallelFill != 0 )
+					parallelFill->listLock.unlock();
+			}
 		}
 	}
+
+	if ( inListLock != 0 )
+		inListLock->unlock();
 }
 
 /* Attach states on the default transition, range list or on out/in list key.
@@ -241,9 +270,20 @@ TransAp *FsmAp::fsmAttachStates( MergeData &md, StateAp *from,
 		else
 			stateSet.insert( toState->stateDictEl->stateSet );
 
-		/* Look for the state. If it is not there already, make it. */
+		/* Look for the state. If it is not there already, make it. When
+		 * filling in parallel, look in the set's shard of the dict. */
+		StateDict *stateDict = &md.stateDict;
+		ParallelLock *dictLock = 0;
+		if ( md.parallelFill != 0 ) {
+			int shard = md.parallelFill->dictShard( stateSet );
+			stateDict = &md.parallelFill->stateDict[shard];
+			dictLock = &md.parallelFill->dictLock[shard];
+			dictLock->lock();
+		}
+
 		StateDictEl *lastFound;
-		if ( md.stateDict.insert( stateSet, &lastFound ) ) {
+		bool created = stateDict->insert( stateSet, &lastFound ) != 0;
+		if ( created ) {
 			/* Make a new state representing the combination of states in
 			 * stateSet. It gets added to the fill list.  This means that we
 			 * need to fill in it's transitions sometime in the future.  We
@@ -255,12 +295,31 @@ TransAp *FsmAp::fsmAttachStates( MergeData &md, StateAp *from,
 			combinState->stateDictEl = lastFound;
 
 			/* Add to the fill list. */
+			if ( md.parallelFill != 0 )
+				md.parallelFill->listLock.lock();
 			md.fillListAppend( combinState );
+			if ( md.parallelFill != 0 )
+				md.parallelFill->listLock.unlock();
 		}
 
 		/* Get the state insertted/deleted. */
 		StateAp *targ = lastFound->targState;
 
+		if ( dictLock != 0 ) {
+			/* Keep the first lookup that found the set. Only the thread
+			 * filling from makes lookups for it. */
+			StateDictEl *fromEl = from->stateDictEl;
+			long pos = fromEl->fillPos, lookup = fromEl->lookups++;
+			if ( created || pos < lastFound->firstPos || 
+					( pos == lastFound->firstPos && lookup < lastFound->firstLookup ) )
+			{
+				lastFound->firstPos = pos;
+				lastFound->firstLookup = lookup;
+			}
+
+			dictLock->unlock();
+		}
+
 		/* Detach the state from existing state. */
 		detachTrans( from, existingState, destTrans );
 
@@ -22,6 +22,7 @@
 #include <string.h>
 #include <assert.h>
 #include "fsmgraph.h"
+#include "parallel.h"
 
 /* Simple singly linked list append routine for the fill list. The new state
  * goes to the end of the list. */
@@ -51,7 +52,10 @@ FsmAp::FsmAp()
 	/* Misfit accounting is a switch, turned on only at specific times. It
 	 * controls what happens when states have no way in from the outside
 	 * world.. */
-	misfitAccounting(false)
+	misfitAccounting(false),
+
+	/* Only set while filling in states in parallel. */
+	parallelFill(0)
 {
 }
 
@@ -72,7 +76,10 @@ FsmAp::FsmAp( const FsmAp &graph )
 	finStateSet(),
 	
 	/* Misfit accounting is only on during merging. */
-	misfitAccounting(false)
+	misfitAccounting(false),
+
+	/* Only set while filling in states in parallel. */
+	parallelFill(0)
 {
 	/* Create the states and record their map in the original state. */
 	StateList::Iter origState = graph.stateList;
@@ -148,7 +155,14 @@ void FsmAp::setFinState( StateAp *state )
 		return;
 	
 	state->stateBits |= STB_ISFINAL;
+
+	if ( parallelFill != 0 )
+		parallelFill->finLock.lock();
+
 	finStateSet.insert( state );
+
+	if ( parallelFill != 0 )
+		parallelFill->finLock.unlock();
 }
 
 /* Set a state non-final. The has its isFinState flag set false and the state
@@ -434,6 +448,38 @@ void FsmAp::setFinBits( int finStateBits )
 		finStateSet.data[s]->stateBits |= finStateBits;
 }
 
+/* Walks in transitions backwards from the final states. Uses an explicit
+ * stack rather than recursion because the operands can be large. */
+void FsmAp::setCoReachBits( int coReachBit )
+{
+	Vector<StateAp*> stack;
+	for ( int s = 0; s < finStateSet.length(); s++ ) {
+		finStateSet.data[s]->stateBits |= coReachBit;
+		stack.append( finStateSet.data[s] );
+	}
+
+	while ( stack.length() > 0 ) {
+		StateAp *state = stack[stack.length()-1];
+		stack.remove( stack.length()-1 );
+
+		for ( TransInList::Iter trans = state->inList; trans.lte(); trans++ ) {
+			StateAp *fromState = trans->fromState;
+			if ( ! ( fromState->stateBits & coReachBit ) ) {
+				fromState->stateBits |= coReachBit;
+				stack.append( fromState );
+			}
+		}
+	}
+}
+
+void FsmAp::clearStateBits( int stateBits )
+{
+	for ( StateList::Iter state = stateList; state.lte(); state++ )
+		state->stateBits &= ~stateBits;
+	for ( StateList::Iter state = misfitList; state.lte(); state++ )
+		state->stateBits &= ~stateBits;
+}
+
 
 /* Tests the integrity of the transition lists and the fromStates. */
 void FsmAp::verifyIntegrity()
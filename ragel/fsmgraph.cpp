@@ -25,6 +25,7 @@
 #include "fsmgraph.h"
 #include "mergesort.h"
 #include "parsedata.h"
+#include "parallel.h"
 
 using std::cerr;
 using std::endl;
@@ -36,6 +37,9 @@ StateAp *FsmAp::addState()
 	/* Make the new state to return. */
 	StateAp *state = new StateAp();
 
+	if ( parallelFill != 0 )
+		parallelFill->listLock.lock();
+
 	if ( misfitAccounting ) {
 		/* Create the new state on the misfit list. All states are created
 		 * with no foreign in transitions. */
@@ -46,6 +50,9 @@ StateAp *FsmAp::addState()
 		stateList.append( state );
 	}
 
+	if ( parallelFill != 0 )
+		parallelFill->listLock.unlock();
+
 	return state;
 }
 
@@ -391,10 +398,11 @@ void FsmAp::concatOp( FsmAp *other )
 }
 
 
-void FsmAp::doOr( FsmAp *other )
+void FsmAp::doOr( FsmAp *other, int liveBits )
 {
 	/* For the merging process. */
 	MergeData md;
+	md.liveBits = liveBits;
 
 	/* Build a state set consisting of both start states */
 	StateSet startStateSet;
@@ -458,8 +466,12 @@ void FsmAp::intersectOp( FsmAp *other )
 	setFinBits( STB_GRAPH1 );
 	other->setFinBits( STB_GRAPH2 );
 
+	/* A pair can only lead to a final state if both sides can. */
+	setCoReachBits( STB_COREACH1 );
+	other->setCoReachBits( STB_COREACH2 );
+
 	/* Call worker Or routine. */
-	doOr( other );
+	doOr( other, STB_COREACH1 | STB_COREACH2 );
 
 	/* Unset any final states that are no longer to 
 	 * be final due to final bits. */
@@ -471,6 +483,7 @@ void FsmAp::intersectOp( FsmAp *other )
 
 	/* Remove states that have no path to a final state. */
 	removeDeadEndStates();
+	clearStateBits( STB_COREACH1 | STB_COREACH2 );
 }
 
 /* Set subtracts other machine from this machine. Other is deleted. */
@@ -483,8 +496,11 @@ void FsmAp::subtractOp( FsmAp *other )
 	/* Set the fin bits of other to be killers. */
 	other->setFinBits( STB_GRAPH1 );
 
+	/* Only this machine can make a final state. */
+	setCoReachBits( STB_COREACH1 );
+
 	/* Call worker Or routine. */
-	doOr( other );
+	doOr( other, STB_COREACH1 );
 
 	/* Unset any final states that are no longer to 
 	 * be final due to final bits. */
@@ -496,50 +512,209 @@ void FsmAp::subtractOp( FsmAp *other )
 
 	/* Remove states that have no path to a final state. */
 	removeDeadEndStates();
+	clearStateBits( STB_COREACH1 );
 }
 
-bool FsmAp::inEptVect( EptVect *eptVect, StateAp *state )
+/* Combine the owning graphs of two pieces of an epsilon path. A path is
+ * represented by a state of the graph that owns all the states on it, or by
+ * null if the path crosses graphs. */
+static StateAp *eptPathOwner( StateAp *path1, StateAp *path2 )
 {
-	if ( eptVect != 0 ) {
-		/* Vect is there, walk it looking for state. */
-		for ( int i = 0; i < eptVect->length(); i++ ) {
-			if ( eptVect->data[i].targ == state )
-				return true;
-		}
-	}
-	return false;
+	if ( path1 == 0 || path2 == 0 || path1->owningGraph != path2->owningGraph )
+		return 0;
+	return path1;
 }
 
-/* Fill epsilon vectors in a root state from a given starting point. Epmploys
- * a depth first search through the graph of epsilon transitions. */
-void FsmAp::epsilonFillEptVectFrom( StateAp *root, StateAp *from, bool parentLeaving )
+/* Frame of the explicit stacks used in filling the epsilon vectors. */
+struct EptFrame
+{
+	int state;
+	int edge;
+	StateAp *pathOwner;
+};
+
+/* Fill the epsilon vectors of all states. The vector of a state lists the
+ * states reachable from it by epsilon transitions, in depth first order. A
+ * target is leaving if the path first found to it goes through a state of a
+ * graph other than the root's.
+ *
+ * Strongly connected components of the epsilon graph are found first. Then,
+ * component by component with the components that are reached from it done
+ * first, each state's vector is found with a depth first search that stays
+ * inside the component. On reaching a state in a different component, the
+ * vector of that state is copied in instead of searching it again. */
+void FsmAp::fillEptVects()
 {
-	/* Walk the epsilon transitions out of the state. */
-	for ( EpsilonTrans::Iter ep = from->epsilonTrans; ep.lte(); ep++ ) {
-		/* Find the entry point, if the it does not resove, ignore it. */
-		EntryMapEl *enLow, *enHigh;
-		if ( entryPoints.findMulti( *ep, enLow, enHigh ) ) {
-			/* Loop the targets. */
-			for ( EntryMapEl *en = enLow; en <= enHigh; en++ ) {
-				/* Do not add the root or states already in eptVect. */
-				StateAp *targ = en->value;
-				if ( targ != from && !inEptVect(root->eptVect, targ) ) {
-					/* Maybe need to create the eptVect. */
-					if ( root->eptVect == 0 )
-						root->eptVect = new EptVect();
-
-					/* If moving to a different graph or if any parent is
-					 * leaving then we are leaving. */
-					bool leaving = parentLeaving || 
-							root->owningGraph != targ->owningGraph;
-
-					/* All ok, add the target epsilon and recurse. */
-					root->eptVect->append( EptVectEl(targ, leaving) );
-					epsilonFillEptVectFrom( root, targ, leaving );
+	/* Give the states ids by sorting them. The id is the position. */
+	int numStates = stateList.length() + misfitList.length();
+	StateAp **states = new StateAp*[numStates];
+	int n = 0;
+	for ( StateList::Iter st = stateList; st.lte(); st++ )
+		states[n++] = st;
+	for ( StateList::Iter st = misfitList; st.lte(); st++ )
+		states[n++] = st;
+
+	MergeSort<StateAp*, CmpOrd<StateAp*> > idSort;
+	idSort.sort( states, numStates );
+
+	StateSet idSet;
+	idSet.setAs( states, numStates );
+
+	/* Epsilon successors of each state. */
+	Vector<int> succ;
+	int *succStart = new int[numStates+1];
+	for ( int s = 0; s < numStates; s++ ) {
+		succStart[s] = succ.length();
+		for ( EpsilonTrans::Iter ep = states[s]->epsilonTrans; ep.lte(); ep++ ) {
+			/* Find the entry point, if it does not resolve, ignore it. */
+			EntryMapEl *enLow, *enHigh;
+			if ( entryPoints.findMulti( *ep, enLow, enHigh ) ) {
+				for ( EntryMapEl *en = enLow; en <= enHigh; en++ ) {
+					/* Skip transitions back into the same state. */
+					if ( en->value != states[s] )
+						succ.append( idSet.find( en->value ) - idSet.data );
 				}
 			}
 		}
 	}
+	succStart[numStates] = succ.length();
+
+	/* Per state search data. */
+	int *index = new int[numStates];
+	int *low = new int[numStates];
+	int *comp = new int[numStates];
+	int *stamp = new int[numStates];
+	bool *onStack = new bool[numStates];
+	Vector<int> *targIds = new Vector<int>[numStates];
+	Vector<StateAp*> *targOwners = new Vector<StateAp*>[numStates];
+	for ( int s = 0; s < numStates; s++ ) {
+		index[s] = -1;
+		stamp[s] = -1;
+		onStack[s] = false;
+	}
+
+	Vector<EptFrame> callStack, search;
+	Vector<int> compStack;
+	int nextIndex = 0, numComps = 0;
+
+	for ( int root = 0; root < numStates; root++ ) {
+		if ( index[root] >= 0 )
+			continue;
+
+		/* Iterative Tarjan. */
+		EptFrame rootFrame = { root, succStart[root], 0 };
+		callStack.append( rootFrame );
+		index[root] = low[root] = nextIndex++;
+		compStack.append( root );
+		onStack[root] = true;
+
+		while ( callStack.length() > 0 ) {
+			int top = callStack.length() - 1;
+			int v = callStack[top].state;
+			if ( callStack[top].edge < succStart[v+1] ) {
+				int w = succ[callStack[top].edge++];
+				if ( index[w] < 0 ) {
+					EptFrame frame = { w, succStart[w], 0 };
+					callStack.append( frame );
+					index[w] = low[w] = nextIndex++;
+					compStack.append( w );
+					onStack[w] = true;
+				}
+				else if ( onStack[w] && index[w] < low[v] )
+					low[v] = index[w];
+				continue;
+			}
+
+			callStack.remove( top );
+			if ( top > 0 && low[v] < low[callStack[top-1].state] )
+				low[callStack[top-1].state] = low[v];
+
+			if ( low[v] != index[v] )
+				continue;
+
+			/* V is the root of a component. Pop it off. */
+			int first = compStack.length() - 1;
+			while ( compStack[first] != v )
+				first -= 1;
+			for ( int c = first; c < compStack.length(); c++ ) {
+				comp[compStack[c]] = numComps;
+				onStack[compStack[c]] = false;
+			}
+
+			/* Fill the vectors of the states in the component. */
+			for ( int c = first; c < compStack.length(); c++ ) {
+				int r = compStack[c];
+				EptFrame frame = { r, succStart[r], 0 };
+				search.append( frame );
+
+				while ( search.length() > 0 ) {
+					int ftop = search.length() - 1;
+					int from = search[ftop].state;
+					if ( search[ftop].edge == succStart[from+1] ) {
+						search.remove( ftop );
+						continue;
+					}
+
+					int t = succ[search[ftop].edge++];
+					if ( stamp[t] == r )
+						continue;
+
+					/* First time seeing the target from this root. Leaving is
+					 * decided by the path that found it. */
+					StateAp *pathOwner = ftop == 0 ? states[t] :
+							eptPathOwner( search[ftop].pathOwner, states[t] );
+					stamp[t] = r;
+					targIds[r].append( t );
+					targOwners[r].append( pathOwner );
+
+					if ( comp[t] == numComps ) {
+						/* Same component, keep searching. */
+						EptFrame next = { t, succStart[t], pathOwner };
+						search.append( next );
+					}
+					else {
+						/* The target's vector is complete, bring it in. */
+						for ( int i = 0; i < targIds[t].length(); i++ ) {
+							int y = targIds[t][i];
+							if ( stamp[y] != r ) {
+								stamp[y] = r;
+								targIds[r].append( y );
+								targOwners[r].append(
+										eptPathOwner( pathOwner, targOwners[t][i] ) );
+							}
+						}
+					}
+				}
+			}
+
+			compStack.remove( first, compStack.length() - first );
+			numComps += 1;
+		}
+	}
+
+	/* Transfer into the states' epsilon vectors. */
+	for ( int s = 0; s < numStates; s++ ) {
+		if ( targIds[s].length() > 0 ) {
+			StateAp *root = states[s];
+			root->eptVect = new EptVect();
+			for ( int i = 0; i < targIds[s].length(); i++ ) {
+				StateAp *pathOwner = targOwners[s][i];
+				bool leaving = pathOwner == 0 || 
+						pathOwner->owningGraph != root->owningGraph;
+				root->eptVect->append( EptVectEl( states[targIds[s][i]], leaving ) );
+			}
+		}
+	}
+
+	delete[] states;
+	delete[] succStart;
+	delete[] index;
+	delete[] low;
+	delete[] comp;
+	delete[] stamp;
+	delete[] onStack;
+	delete[] targIds;
+	delete[] targOwners;
 }
 
 void FsmAp::shadowReadWriteStates( MergeData &md )
@@ -579,9 +754,8 @@ void FsmAp::shadowReadWriteStates( MergeData &md )
 
 void FsmAp::resolveEpsilonTrans( MergeData &md )
 {
-	/* Walk the state list and invoke recursive worker on each state. */
-	for ( StateList::Iter st = stateList; st.lte(); st++ )
-		epsilonFillEptVectFrom( st, st, false );
+	/* Find the states each state draws in. */
+	fillEptVects();
 
 	/* Prevent reading from and writing to of the same state. */
 	shadowReadWriteStates( md );
@@ -1099,21 +1273,27 @@ void FsmAp::doExpand( MergeData &md, StateAp *destState, ExpansionList &expList1
 }
 
 
+/* Set up the keys that an expansion moves transitions out of. */
+static void setRemovalKeys( Removal &removal, Expansion *exp )
+{
+	if ( exp->fromCondSpace == 0 ) {
+		removal.lowKey = exp->lowKey;
+		removal.highKey = exp->highKey;
+	}
+	else {
+		removal.lowKey = exp->fromCondSpace->baseKey + 
+			exp->fromVals * keyOps->alphSize() + (exp->lowKey - keyOps->minKey);
+		removal.highKey = exp->fromCondSpace->baseKey + 
+			exp->fromVals * keyOps->alphSize() + (exp->highKey - keyOps->minKey);
+	}
+	removal.next = 0;
+}
+
 void FsmAp::doRemove( MergeData &md, StateAp *destState, ExpansionList &expList1 )
 {
 	for ( ExpansionList::Iter exp = expList1; exp.lte(); exp++ ) {
 		Removal removal;
-		if ( exp->fromCondSpace == 0 ) {
-			removal.lowKey = exp->lowKey;
-			removal.highKey = exp->highKey;
-		}
-		else {
-			removal.lowKey = exp->fromCondSpace->baseKey + 
-				exp->fromVals * keyOps->alphSize() + (exp->lowKey - keyOps->minKey);
-			removal.highKey = exp->fromCondSpace->baseKey + 
-				exp->fromVals * keyOps->alphSize() + (exp->highKey - keyOps->minKey);
-		}
-		removal.next = 0;
+		setRemovalKeys( removal, exp );
 
 		TransList destList;
 		PairIter<TransAp, Removal> pairIter( destState->outList.head, &removal );
@@ -1147,6 +1327,50 @@ void FsmAp::doRemove( MergeData &md, StateAp *destState, ExpansionList &expList1
 	}
 }
 
+/* Make detached copies of the transitions of srcState, leaving out the keys
+ * that the expansions move out. */
+void FsmAp::copyUnexpanded( TransList &destList, StateAp *srcState, 
+		ExpansionList &expList )
+{
+	for ( TransList::Iter trans = srcState->outList; trans.lte(); trans++ ) {
+		TransAp *copy = new TransAp( *trans );
+		copy->toState = trans->toState;
+		destList.append( copy );
+	}
+
+	for ( ExpansionList::Iter exp = expList; exp.lte(); exp++ ) {
+		Removal removal;
+		setRemovalKeys( removal, exp );
+
+		TransList keptList;
+		PairIter<TransAp, Removal> pairIter( destList.head, &removal );
+		for ( ; !pairIter.end(); pairIter++ ) {
+			switch ( pairIter.userState ) {
+			case RangeInS1: {
+				TransAp *trans = pairIter.s1Tel.trans;
+				trans->lowKey = pairIter.s1Tel.lowKey;
+				trans->highKey = pairIter.s1Tel.highKey;
+				keptList.append( trans );
+				break;
+			}
+			case RangeOverlap:
+				delete pairIter.s1Tel.trans;
+				break;
+			case BreakS1: {
+				TransAp *copy = new TransAp( *pairIter.s1Tel.trans );
+				copy->toState = pairIter.s1Tel.trans->toState;
+				pairIter.s1Tel.trans = copy;
+				break;
+			}
+			case RangeInS2: case BreakS2:
+				break;
+			}
+		}
+		destList.abandon();
+		destList.transfer( keptList );
+	}
+}
+
 void FsmAp::mergeStateConds( StateAp *destState, StateAp *srcState )
 {
 	StateCondList destList;
@@ -1230,17 +1454,34 @@ void FsmAp::mergeStates( MergeData &md, StateAp *destState, StateAp *srcState )
 	findCondExpansions( expList2, srcState, destState );
 
 	mergeStateConds( destState, srcState );
-	
-	outTransCopy( md, destState, srcState->outList.head );
 
-	pruneExpansions( expList1 );
-	pruneExpansions( expList2 );
+	if ( condGuards && ( expList1.length() > 0 || expList2.length() > 0 ) ) {
+		/* Condition spaces may share keys, so the keys being expanded must
+		 * be taken out before they can meet the keys of another space. */
+		pruneExpansions( expList1 );
+		pruneExpansions( expList2 );
 
-	doExpand( md, destState, expList1 );
-	doExpand( md, destState, expList2 );
+		doRemove( md, destState, expList1 );
 
-	doRemove( md, destState, expList1 );
-	doRemove( md, destState, expList2 );
+		TransList srcList;
+		copyUnexpanded( srcList, srcState, expList2 );
+		outTransCopy( md, destState, srcList.head );
+
+		doExpand( md, destState, expList1 );
+		doExpand( md, destState, expList2 );
+	}
+	else {
+		outTransCopy( md, destState, srcState->outList.head );
+
+		pruneExpansions( expList1 );
+		pruneExpansions( expList2 );
+
+		doExpand( md, destState, expList1 );
+		doExpand( md, destState, expList2 );
+
+		doRemove( md, destState, expList1 );
+		doRemove( md, destState, expList2 );
+	}
 
 	expList1.empty();
 	expList2.empty();
@@ -1282,19 +1523,226 @@ void FsmAp::mergeStates( MergeData &md, StateAp *destState, StateAp *srcState )
 	}
 }
 
-void FsmAp::fillInStates( MergeData &md )
+/* Decides if a state made from a set of states needs to be filled in. When
+ * intersecting or subtracting, a set that does not have a state that can reach
+ * a final state of each operand that needs one can never become final or lead
+ * to a final state. It is left without transitions and the removal of dead end
+ * states takes it. */
+static bool fillWanted( MergeData &md, StateSet *stateSet )
 {
-	/* Merge any states that are awaiting merging. This will likey cause
-	 * other states to be added to the stfil list. */
-	StateAp *state = md.stfillHead;
-	while ( state != 0 ) {
+	if ( md.liveBits == 0 )
+		return true;
+
+	int bits = 0;
+	for ( int s = 0; s < stateSet->length(); s++ )
+		bits |= stateSet->data[s]->stateBits;
+	return ( bits & md.liveBits ) == md.liveBits;
+}
+
+/* Waves of states to fill that are smaller than this are merged by the
+ * calling thread. */
+#define _FILL_PARALLEL_WAVE 64
+
+int ParallelFill::dictShard( const StateSet &stateSet )
+{
+	unsigned long hash = 0;
+	for ( int s = 0; s < stateSet.length(); s++ )
+		hash = hash * 31 + ( (unsigned long)stateSet.data[s] >> 4 );
+	return hash % FILL_SHARDS;
+}
+
+int ParallelFill::inListShard( StateAp *state )
+{
+	return ( (unsigned long)state >> 4 ) % FILL_SHARDS;
+}
+
+/* Orders the states a wave made by the first lookup that found them. */
+struct CmpFirstLookup
+{
+	static int compare( StateAp *state1, StateAp *state2 )
+	{
+		StateDictEl *el1 = state1->stateDictEl, *el2 = state2->stateDictEl;
+		if ( el1->firstPos < el2->firstPos )
+			return -1;
+		else if ( el1->firstPos > el2->firstPos )
+			return 1;
+		else if ( el1->firstLookup < el2->firstLookup )
+			return -1;
+		else if ( el1->firstLookup > el2->firstLookup )
+			return 1;
+		return 0;
+	}
+};
+
+/* A wave of states being filled in by the worker threads. */
+struct FillWave
+{
+	FsmAp *fsm;
+	MergeData *md;
+	StateAp **states;
+
+	/* First failure in any of the threads, rethrown when the wave is done. */
+	ParallelLock failLock;
+	FsmConstructFail *failure;
+};
+
+static void fillWaveWork( void *arg, long begin, long end )
+{
+	FillWave *fw = (FillWave*)arg;
+	for ( long s = begin; s < end; s++ ) {
+		StateAp *state = fw->states[s];
 		StateSet *stateSet = &state->stateDictEl->stateSet;
-		mergeStates( md, state, stateSet->data, stateSet->length() );
-		state = state->alg.next;
+		if ( !fillWanted( *fw->md, stateSet ) )
+			continue;
+
+		try {
+			fw->fsm->mergeStates( *fw->md, state, stateSet->data, stateSet->length() );
+		}
+		catch ( const FsmConstructFail &fail ) {
+			fw->failLock.lock();
+			if ( fw->failure == 0 )
+				fw->failure = new FsmConstructFail( fail );
+			fw->failLock.unlock();
+		}
+	}
+}
+
+void FsmAp::fillInStatesParallel( MergeData &md )
+{
+	ParallelFill parallel;
+	Vector<StateAp*> wave, added, prevOrder;
+	bool anyParallel = false;
+	StateAp *lastExisting = 0;
+
+	StateAp *waveHead = md.stfillHead;
+	while ( waveHead != 0 ) {
+		wave.empty();
+		for ( StateAp *state = waveHead; state != 0; state = state->alg.next )
+			wave.append( state );
+		StateAp *waveTail = md.stfillTail;
+
+		if ( wave.length() < _FILL_PARALLEL_WAVE ) {
+			/* Not worth the threads. This is the same as the serial fill. */
+			for ( int s = 0; s < wave.length(); s++ ) {
+				StateSet *stateSet = &wave[s]->stateDictEl->stateSet;
+				if ( fillWanted( md, stateSet ) )
+					mergeStates( md, wave[s], stateSet->data, stateSet->length() );
+			}
+		}
+		else {
+			if ( !anyParallel ) {
+				/* Remember the order of the states that exist now. The lists
+				 * are rebuilt from it when the fill is done. */
+				anyParallel = true;
+				lastExisting = waveTail;
+				for ( StateList::Iter st = stateList; st.lte(); st++ )
+					prevOrder.append( st );
+				for ( StateList::Iter st = misfitList; st.lte(); st++ )
+					prevOrder.append( st );
+
+				/* Move the dict into the shards. It stays there for the rest
+				 * of the fill, the elements are deleted with the fill list. */
+				Vector<StateDictEl*> dictEls;
+				for ( StateDict::Iter el = md.stateDict; el.lte(); el++ )
+					dictEls.append( el );
+				md.stateDict.abandon();
+				for ( int e = 0; e < dictEls.length(); e++ ) {
+					int shard = parallel.dictShard( dictEls[e]->stateSet );
+					parallel.stateDict[shard].insert( dictEls[e] );
+				}
+
+				md.parallelFill = &parallel;
+				parallelFill = &parallel;
+			}
+
+			for ( int s = 0; s < wave.length(); s++ ) {
+				wave[s]->stateDictEl->fillPos = s;
+				wave[s]->stateDictEl->lookups = 0;
+			}
+
+			FillWave fw;
+			fw.fsm = this;
+			fw.md = &md;
+			fw.states = wave.data;
+			fw.failure = 0;
+
+			parallelFor( wave.length(), 1, &fillWaveWork, &fw );
+
+			if ( fw.failure != 0 ) {
+				FsmConstructFail fail = *fw.failure;
+				delete fw.failure;
+				md.parallelFill = 0;
+				parallelFill = 0;
+				throw fail;
+			}
+
+			/* The states the wave made are on the fill list in the order the
+			 * threads happened to make them. Put them in the order the serial
+			 * fill would have. */
+			added.empty();
+			for ( StateAp *state = waveTail->alg.next; state != 0; state = state->alg.next )
+				added.append( state );
+
+			if ( added.length() > 0 ) {
+				MergeSort<StateAp*, CmpFirstLookup> mergeSort;
+				mergeSort.sort( added.data, added.length() );
+
+				StateAp *last = waveTail;
+				for ( int s = 0; s < added.length(); s++ ) {
+					last->alg.next = added[s];
+					last = added[s];
+				}
+				last->alg.next = 0;
+				md.stfillTail = last;
+			}
+		}
+
+		waveHead = waveTail->alg.next;
+	}
+
+	if ( anyParallel ) {
+		md.parallelFill = 0;
+		parallelFill = 0;
+
+		/* Rebuild the state lists, the states that existed before first,
+		 * then the new ones in fill order. The list a state is on does not
+		 * change, misfits are marked to tell them apart. */
+		for ( StateList::Iter st = misfitList; st.lte(); st++ )
+			st->stateBits |= STB_ISMARKED;
+
+		for ( StateAp *state = lastExisting->alg.next; state != 0; state = state->alg.next )
+			prevOrder.append( state );
+
+		for ( int s = 0; s < prevOrder.length(); s++ ) {
+			StateList &list = ( prevOrder[s]->stateBits & STB_ISMARKED ) ? 
+					misfitList : stateList;
+			list.detach( prevOrder[s] );
+			list.append( prevOrder[s] );
+		}
+
+		for ( StateList::Iter st = misfitList; st.lte(); st++ )
+			st->stateBits &= ~STB_ISMARKED;
+	}
+}
+
+void FsmAp::fillInStates( MergeData &md )
+{
+	if ( determinizeParallel && workerThreads() > 1 )
+		fillInStatesParallel( md );
+	else {
+		/* Merge any states that are awaiting merging. This will likey cause
+		 * other states to be added to the stfil list. */
+		StateAp *state = md.stfillHead;
+		while ( state != 0 ) {
+			StateSet *stateSet = &state->stateDictEl->stateSet;
+			if ( fillWanted( md, stateSet ) )
+				mergeStates( md, state, stateSet->data, stateSet->length() );
+			state = state->alg.next;
+		}
 	}
 
 	/* Delete the state sets of all states that are on the fill list. */
-	state = md.stfillHead;
+	StateAp *state = md.stfillHead;
 	while ( state != 0 ) {
 		/* Delete and reset the state set. */
 		delete state->stateDictEl;
@@ -1421,8 +1869,15 @@ void FsmAp::embedCondition( MergeData &md, StateAp *state, Action *condAction, b
 
 	pruneExpansions( expList );
 
-	doExpand( md, state, expList );
-	doRemove( md, state, expList );
+	if ( condGuards ) {
+		/* The new space may share keys with the old. */
+		doRemove( md, state, expList );
+		doExpand( md, state, expList );
+	}
+	else {
+		doExpand( md, state, expList );
+		doRemove( md, state, expList );
+	}
 	expList.empty();
 }
 
@@ -39,6 +39,7 @@
 #include "avlset.h"
 #include "avlmap.h"
 #include "ragel.h"
+#include "parallel.h"
 
 //#define LOG_CONDS
 
@@ -49,6 +50,8 @@
 #define STB_ISFINAL    0x04
 #define STB_ISMARKED   0x08
 #define STB_ONLIST     0x10
+#define STB_COREACH1   0x20
+#define STB_COREACH2   0x40
 
 using std::ostream;
 
@@ -453,27 +456,71 @@ struct StateDictEl
 	public AvlTreeEl<StateDictEl>
 {
 	StateDictEl(const StateSet &stateSet) 
-		: stateSet(stateSet) { }
+		: stateSet(stateSet), fillPos(0), lookups(0),
+		firstPos(0), firstLookup(0) { }
 
 	const StateSet &getKey() { return stateSet; }
 	StateSet stateSet;
 	StateAp *targState;
+
+	/* While a wave of states is filled in by several threads, the position
+	 * in the wave of the state and the count of lookups its fill has made. */
+	long fillPos, lookups;
+
+	/* The first lookup that found the set, by the position of the state
+	 * being filled and its lookup count. The states a wave makes are sorted
+	 * on it, which gives the order the serial fill makes them in. */
+	long firstPos, firstLookup;
 };
 
 /* Dictionary mapping a set of states to a target state. */
 typedef AvlTree< StateDictEl, StateSet, CmpTable<StateAp*> > StateDict;
 
+/* Number of parts the state dict and the in list locks are split into while
+ * states are filled in by several threads. */
+#define FILL_SHARDS 64
+
+/* Shared by the threads filling in states. The dict is split into shards by a
+ * hash of the state set and an in list is guarded by a lock picked by its
+ * state, so threads only wait for each other when they touch the same part. */
+struct ParallelFill
+{
+	StateDict stateDict[FILL_SHARDS];
+	ParallelLock dictLock[FILL_SHARDS];
+	ParallelLock inListLock[FILL_SHARDS];
+
+	/* The state lists and the fill list. */
+	ParallelLock listLock;
+
+	/* The final state set. */
+	ParallelLock finLock;
+
+	/* The condition spaces. */
+	ParallelLock condLock;
+
+	int dictShard( const StateSet &stateSet );
+	int inListShard( StateAp *state );
+};
+
 /* Data needed for a merge operation. */
 struct MergeData
 {
 	MergeData() 
-		: stfillHead(0), stfillTail(0) { }
+		: stfillHead(0), stfillTail(0), parallelFill(0), liveBits(0) { }
 
 	StateDict stateDict;
 
 	StateAp *stfillHead;
 	StateAp *stfillTail;
 
+	/* Set while states are being filled in by several threads. The dict is
+	 * then kept in its shards. */
+	ParallelFill *parallelFill;
+
+	/* If set, states made from sets lacking any of these bits are left
+	 * unfilled. Used by intersection and subtraction. */
+	int liveBits;
+
 	void fillListAppend( StateAp *state );
 };
 
@@ -641,11 +688,15 @@ struct Removal
 
 struct CondData
 {
-	CondData() : lastCondKey(0) {}
+	CondData() : lastCondKey(0), guardSpace(0) {}
 
 	/* Condition info. */
 	Key lastCondKey;
 
+	/* Key range shared by condition spaces when they are guarded. */
+	Key guardBaseKey;
+	Size guardSpace;
+
 	CondSpaceMap condSpaceMap;
 };
 
@@ -1118,6 +1169,11 @@ struct FsmAp
 	/* Misfit Accounting. Are misfits put on a separate list. */
 	bool misfitAccounting;
 
+	/* Set while states are being filled in by several threads. Holds the
+	 * locks for the state lists, in lists, final state set and condition
+	 * spaces. */
+	ParallelFill *parallelFill;
+
 	/*
 	 * Transition actions and priorities.
 	 */
@@ -1281,6 +1337,8 @@ struct FsmAp
 	void pruneExpansions( ExpansionList &expList );
 	void doExpand( MergeData &md, StateAp *destState, ExpansionList &expList1 );
 	void doRemove( MergeData &md, StateAp *destState, ExpansionList &expList1 );
+	void copyUnexpanded( TransList &destList, StateAp *srcState, 
+			ExpansionList &expList );
 	void findCondExpInTrans( ExpansionList &expansionList, StateAp *state, 
 			Key lowKey, Key highKey, CondSpace *fromCondSpace, CondSpace *toCondSpace,
 			long destVals, LongVect &toValsList );
@@ -1301,6 +1359,12 @@ struct FsmAp
 	 * empty out stateDict and stFil. */
 	void fillInStates( MergeData &md );
 
+	/* Fill in the states a wave at a time, merging the states of a wave
+	 * concurrently. Afterwards the new states are put in the order of the
+	 * transitions that lead to them, so the result does not depend on the
+	 * thread timing. */
+	void fillInStatesParallel( MergeData &md );
+
 	/*
 	 * Transition Comparison.
 	 */
@@ -1385,13 +1449,12 @@ struct FsmAp
 	void isolateStartState();
 
 	/* Workers for resolving epsilon transitions. */
-	bool inEptVect( EptVect *eptVect, StateAp *targ );
-	void epsilonFillEptVectFrom( StateAp *root, StateAp *from, bool parentLeaving );
+	void fillEptVects();
 	void resolveEpsilonTrans( MergeData &md );
 
 	/* Workers for concatenation and union. */
 	void doConcat( FsmAp *other, StateSet *fromStates, bool optional );
-	void doOr( FsmAp *other );
+	void doOr( FsmAp *other, int liveBits = 0 );
 
 	/*
 	 * Final states
@@ -1420,6 +1483,12 @@ struct FsmAp
 	/* Set the bits of final states and clear the bits of non final states. */
 	void setFinBits( int finStateBits );
 
+	/* Set a bit in all states that have a path to a final state. */
+	void setCoReachBits( int coReachBit );
+
+	/* Clear bits in all states. */
+	void clearStateBits( int stateBits );
+
 	/*
 	 * Self-consistency checks.
 	 */
@@ -1466,6 +1535,10 @@ struct FsmAp
 	void minimizePartition1();
 	void minimizePartition2();
 
+	/* Same result as minimizePartition2, with the partition splitting spread
+	 * over worker threads. */
+	void minimizePartitionParallel();
+
 	/* Minimize the final state Machine. The result is the minimal fsm. Slow
 	 * but stable, correct minimization. Uses n^2 space (lookout) and average
 	 * n^2 time. Worst case n^3 time, but a that is a very rare case. */
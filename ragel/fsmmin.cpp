@@ -21,6 +21,9 @@
 
 #include "fsmgraph.h"
 #include "mergesort.h"
+#include "parallel.h"
+
+#include <string.h>
 
 int FsmAp::partitionRound( StateAp **statePtrs, MinPartition *parts, int numParts )
 {
@@ -340,6 +343,394 @@ void FsmAp::minimizePartition2()
 	delete[] parts;
 }
 
+/* Flattened copy of the machine used by the parallel partition refinement.
+ * States are referred to by their position in the state list, which is kept
+ * in alg.stateNum. */
+struct ParMinData
+{
+	int numStates;
+	StateAp **states;
+
+	/* Out transitions of each state. Target is -1 if the transition does not
+	 * go to a state. */
+	int *transStart;
+	Key *transLow, *transHigh;
+	int *transTarget;
+	int *eofTarget;
+
+	/* States that have a transition or an eof target into each state. */
+	int *predStart, *preds;
+
+	/* Current partitioning. The states in a block are contiguous in elems. */
+	int numBlocks;
+	int *block;
+	int *elems;
+	int *blockStart, *blockLen;
+
+	/* Signature of each state in the blocks being split: the out transitions
+	 * coalesced into runs of keys going to the same block, then the eof
+	 * target block. Stored in the space of the state's transitions. */
+	Key *sigLow, *sigHigh;
+	int *sigBlock, *sigLen, *sigEof;
+
+	/* Set for each position in elems that starts a new group. */
+	char *newGroup;
+
+	/* Blocks to try to split in the current round. */
+	int *cand;
+	int numCand;
+};
+
+/* Orders states by their signature. */
+struct SigCompare
+{
+	SigCompare() : pm(0) { }
+	SigCompare( ParMinData *pm ) : pm(pm) { }
+
+	int compare( int s1, int s2 ) const
+	{
+		if ( pm->sigEof[s1] < pm->sigEof[s2] )
+			return -1;
+		else if ( pm->sigEof[s1] > pm->sigEof[s2] )
+			return 1;
+
+		if ( pm->sigLen[s1] < pm->sigLen[s2] )
+			return -1;
+		else if ( pm->sigLen[s1] > pm->sigLen[s2] )
+			return 1;
+
+		int r1 = pm->transStart[s1], r2 = pm->transStart[s2];
+		for ( int i = 0; i < pm->sigLen[s1]; i++, r1++, r2++ ) {
+			if ( pm->sigBlock[r1] < pm->sigBlock[r2] )
+				return -1;
+			else if ( pm->sigBlock[r1] > pm->sigBlock[r2] )
+				return 1;
+
+			if ( pm->sigLow[r1] < pm->sigLow[r2] )
+				return -1;
+			else if ( pm->sigLow[r1] > pm->sigLow[r2] )
+				return 1;
+
+			if ( pm->sigHigh[r1] < pm->sigHigh[r2] )
+				return -1;
+			else if ( pm->sigHigh[r1] > pm->sigHigh[r2] )
+				return 1;
+		}
+		return 0;
+	}
+
+	ParMinData *pm;
+};
+
+/* Blocks at least this big are split using all threads. Smaller ones are
+ * handed out to the threads whole. */
+#define _PM_BIG_BLOCK 4096
+
+static void computeSigs( ParMinData *pm, int begin, int end )
+{
+	for ( int e = begin; e < end; e++ ) {
+		int s = pm->elems[e];
+		int base = pm->transStart[s], len = 0;
+		for ( int t = base; t < pm->transStart[s+1]; t++ ) {
+			int target = pm->transTarget[t] < 0 ? -1 : pm->block[pm->transTarget[t]];
+			if ( len > 0 && pm->sigBlock[base+len-1] == target ) {
+				/* Extend the last run if the keys carry on from it. */
+				Key next = pm->sigHigh[base+len-1];
+				next.increment();
+				if ( next == pm->transLow[t] ) {
+					pm->sigHigh[base+len-1] = pm->transHigh[t];
+					continue;
+				}
+			}
+			pm->sigLow[base+len] = pm->transLow[t];
+			pm->sigHigh[base+len] = pm->transHigh[t];
+			pm->sigBlock[base+len] = target;
+			len += 1;
+		}
+		pm->sigLen[s] = len;
+		pm->sigEof[s] = pm->eofTarget[s] < 0 ? -1 : pm->block[pm->eofTarget[s]];
+	}
+}
+
+/* Mark the positions in elems where a new group of equal signatures starts.
+ * The block is sorted and starts at blockStart. */
+static void markGroups( ParMinData *pm, int blockStart, int begin, int end )
+{
+	SigCompare sigCompare( pm );
+	for ( int e = begin; e < end; e++ ) {
+		pm->newGroup[e] = e > blockStart && 
+				sigCompare.compare( pm->elems[e-1], pm->elems[e] ) != 0;
+	}
+}
+
+/* Split each of a range of small candidate blocks on its own. */
+static void splitSmallBlocks( void *arg, long begin, long end )
+{
+	ParMinData *pm = (ParMinData*)arg;
+	MergeSort<int, SigCompare> mergeSort;
+	mergeSort.pm = pm;
+
+	for ( long c = begin; c < end; c++ ) {
+		int b = pm->cand[c];
+		int start = pm->blockStart[b], len = pm->blockLen[b];
+		if ( len >= _PM_BIG_BLOCK )
+			continue;
+
+		computeSigs( pm, start, start + len );
+		mergeSort.sort( pm->elems + start, len );
+		markGroups( pm, start, start, start + len );
+	}
+}
+
+/* A big block being split. Work items are offsets into the block. */
+struct ParMinBlock
+{
+	ParMinData *pm;
+	int start;
+};
+
+static void bigBlockSigs( void *arg, long begin, long end )
+{
+	ParMinBlock *bb = (ParMinBlock*)arg;
+	computeSigs( bb->pm, bb->start + begin, bb->start + end );
+}
+
+static void bigBlockGroups( void *arg, long begin, long end )
+{
+	ParMinBlock *bb = (ParMinBlock*)arg;
+	markGroups( bb->pm, bb->start, bb->start + begin, bb->start + end );
+}
+
+/* Split a big candidate block with all the threads working on it. */
+static void splitBigBlock( ParMinData *pm, int b )
+{
+	ParMinBlock bb;
+	bb.pm = pm;
+	bb.start = pm->blockStart[b];
+	int len = pm->blockLen[b];
+
+	parallelFor( len, 256, &bigBlockSigs, &bb );
+
+	SigCompare sigCompare( pm );
+	ParallelSort<int, SigCompare> parallelSort( sigCompare );
+	parallelSort.sort( pm->elems + bb.start, len );
+
+	parallelFor( len, 256, &bigBlockGroups, &bb );
+}
+
+/**
+ * \brief Minimize by partitioning, using several threads.
+ *
+ * Gives the same machine as minimizePartition2. The states are first
+ * partitioned with the initial partition compare, then the partitions are
+ * refined in rounds. In each round every partition that may need splitting
+ * is split according to the partitions its states go to at the start of the
+ * round. The partitions are independent within a round, so they are split in
+ * parallel. New partitions are numbered in a fixed order after each round,
+ * which makes the result independent of the number of threads.
+ */
+void FsmAp::minimizePartitionParallel()
+{
+	/* Nothing to do if there are no states. */
+	if ( stateList.length() == 0 )
+		return;
+
+	ParMinData pm;
+	int numStates = pm.numStates = stateList.length();
+	pm.states = new StateAp*[numStates];
+
+	/* Number the states and count the transitions. */
+	int numTrans = 0, s = 0;
+	for ( StateList::Iter state = stateList; state.lte(); state++, s++ ) {
+		pm.states[s] = state;
+		state->alg.stateNum = s;
+		numTrans += state->outList.length();
+	}
+
+	/* Flatten out the transitions. */
+	pm.transStart = new int[numStates+1];
+	pm.transLow = new Key[numTrans];
+	pm.transHigh = new Key[numTrans];
+	pm.transTarget = new int[numTrans];
+	pm.eofTarget = new int[numStates];
+	pm.predStart = new int[numStates+1];
+	memset( pm.predStart, 0, sizeof(int) * (numStates+1) );
+
+	int t = 0, numPreds = 0;
+	for ( s = 0; s < numStates; s++ ) {
+		StateAp *state = pm.states[s];
+		pm.transStart[s] = t;
+		for ( TransList::Iter trans = state->outList; trans.lte(); trans++, t++ ) {
+			pm.transLow[t] = trans->lowKey;
+			pm.transHigh[t] = trans->highKey;
+			pm.transTarget[t] = -1;
+			if ( trans->toState != 0 ) {
+				pm.transTarget[t] = trans->toState->alg.stateNum;
+				pm.predStart[pm.transTarget[t]+1] += 1;
+				numPreds += 1;
+			}
+		}
+
+		pm.eofTarget[s] = -1;
+		if ( state->eofTarget != 0 ) {
+			pm.eofTarget[s] = state->eofTarget->alg.stateNum;
+			pm.predStart[pm.eofTarget[s]+1] += 1;
+			numPreds += 1;
+		}
+	}
+	pm.transStart[numStates] = t;
+
+	/* Fill in the predecessors. The counts become offsets. */
+	for ( s = 0; s < numStates; s++ )
+		pm.predStart[s+1] += pm.predStart[s];
+	pm.preds = new int[numPreds];
+	int *predFill = new int[numStates];
+	memcpy( predFill, pm.predStart, sizeof(int) * numStates );
+	for ( s = 0; s < numStates; s++ ) {
+		for ( t = pm.transStart[s]; t < pm.transStart[s+1]; t++ ) {
+			if ( pm.transTarget[t] >= 0 )
+				pm.preds[predFill[pm.transTarget[t]]++] = s;
+		}
+		if ( pm.eofTarget[s] >= 0 )
+			pm.preds[predFill[pm.eofTarget[s]]++] = s;
+	}
+	delete[] predFill;
+
+	/* 
+	 * Initial partitioning by final state status and transition functions.
+	 */
+	StateAp **statePtrs = new StateAp*[numStates];
+	memcpy( statePtrs, pm.states, sizeof(StateAp*) * numStates );
+
+	InitPartitionCompare initPartCompare;
+	ParallelSort<StateAp*, InitPartitionCompare> initSort( initPartCompare );
+	initSort.sort( statePtrs, numStates );
+
+	pm.block = new int[numStates];
+	pm.elems = new int[numStates];
+	pm.blockStart = new int[numStates];
+	pm.blockLen = new int[numStates];
+	pm.numBlocks = 0;
+	for ( s = 0; s < numStates; s++ ) {
+		if ( s == 0 || initPartCompare.compare( statePtrs[s-1], statePtrs[s] ) < 0 ) {
+			pm.blockStart[pm.numBlocks] = s;
+			pm.blockLen[pm.numBlocks] = 0;
+			pm.numBlocks += 1;
+		}
+
+		int b = pm.numBlocks - 1;
+		pm.elems[s] = statePtrs[s]->alg.stateNum;
+		pm.block[pm.elems[s]] = b;
+		pm.blockLen[b] += 1;
+	}
+	delete[] statePtrs;
+
+	/*
+	 * Refinement.
+	 */
+	pm.sigLow = new Key[numTrans];
+	pm.sigHigh = new Key[numTrans];
+	pm.sigBlock = new int[numTrans];
+	pm.sigLen = new int[numStates];
+	pm.sigEof = new int[numStates];
+	pm.newGroup = new char[numStates];
+	pm.cand = new int[numStates];
+
+	char *candMark = new char[numStates];
+	memset( candMark, 0, numStates );
+	int *moved = new int[numStates];
+
+	/* Every partition with more than one state is a candidate to begin with. */
+	pm.numCand = 0;
+	for ( int b = 0; b < pm.numBlocks; b++ ) {
+		if ( pm.blockLen[b] > 1 )
+			pm.cand[pm.numCand++] = b;
+	}
+
+	MergeSort<int, CmpOrd<int> > candSort;
+	while ( pm.numCand > 0 ) {
+		/* Small blocks are handed out whole, big ones get all the threads. */
+		parallelFor( pm.numCand, 1, &splitSmallBlocks, &pm );
+		for ( int c = 0; c < pm.numCand; c++ ) {
+			if ( pm.blockLen[pm.cand[c]] >= _PM_BIG_BLOCK )
+				splitBigBlock( &pm, pm.cand[c] );
+		}
+
+		/* Give out the new block numbers in candidate order. */
+		int numMoved = 0;
+		for ( int c = 0; c < pm.numCand; c++ ) {
+			int b = pm.cand[c], start = pm.blockStart[b], len = pm.blockLen[b];
+			int dest = b;
+			for ( int e = start + 1; e < start + len; e++ ) {
+				if ( pm.newGroup[e] ) {
+					if ( dest == b )
+						pm.blockLen[b] = e - start;
+					dest = pm.numBlocks++;
+					pm.blockStart[dest] = e;
+					pm.blockLen[dest] = 0;
+				}
+
+				if ( dest != b ) {
+					pm.block[pm.elems[e]] = dest;
+					pm.blockLen[dest] += 1;
+					moved[numMoved++] = pm.elems[e];
+				}
+			}
+		}
+
+		/* States that go to a state that changed blocks may need to be split
+		 * from their block mates. */
+		pm.numCand = 0;
+		for ( int m = 0; m < numMoved; m++ ) {
+			for ( int p = pm.predStart[moved[m]]; p < pm.predStart[moved[m]+1]; p++ ) {
+				int b = pm.block[pm.preds[p]];
+				if ( pm.blockLen[b] > 1 && !candMark[b] ) {
+					candMark[b] = 1;
+					pm.cand[pm.numCand++] = b;
+				}
+			}
+		}
+
+		for ( int c = 0; c < pm.numCand; c++ )
+			candMark[pm.cand[c]] = 0;
+		candSort.sort( pm.cand, pm.numCand );
+	}
+
+	/* Move the states into partitions and fuse. */
+	stateList.abandon();
+	MinPartition *parts = new MinPartition[pm.numBlocks];
+	for ( int b = 0; b < pm.numBlocks; b++ ) {
+		for ( int e = pm.blockStart[b]; e < pm.blockStart[b] + pm.blockLen[b]; e++ )
+			parts[b].list.append( pm.states[pm.elems[e]] );
+	}
+
+	fusePartitions( parts, pm.numBlocks );
+
+	/* Cleanup. */
+	delete[] parts;
+	delete[] moved;
+	delete[] candMark;
+	delete[] pm.states;
+	delete[] pm.transStart;
+	delete[] pm.transLow;
+	delete[] pm.transHigh;
+	delete[] pm.transTarget;
+	delete[] pm.eofTarget;
+	delete[] pm.predStart;
+	delete[] pm.preds;
+	delete[] pm.block;
+	delete[] pm.elems;
+	delete[] pm.blockStart;
+	delete[] pm.blockLen;
+	delete[] pm.sigLow;
+	delete[] pm.sigHigh;
+	delete[] pm.sigBlock;
+	delete[] pm.sigLen;
+	delete[] pm.sigEof;
+	delete[] pm.newGroup;
+	delete[] pm.cand;
+}
+
 void FsmAp::initialMarkRound( MarkIndex &markIndex )
 {
 	/* P and q for walking pairs. */
@@ -37,9 +37,16 @@
 #include "cssplit.h"
 
 #include "cdtable.h"
+#include "cdcxxtable.h"
 #include "cdftable.h"
 #include "cdflat.h"
 #include "cdfflat.h"
+#include "cdclassflat.h"
+#include "cdcomb.h"
+#include "cddense.h"
+#include "cdcgoto.h"
+#include "cdtailcall.h"
+#include "cdhybrid.h"
 #include "cdgoto.h"
 #include "cdfgoto.h"
 #include "cdipgoto.h"
@@ -47,6 +54,8 @@
 
 #include "dotcodegen.h"
 
+#include "blobgen.h"
+
 #include "javacodegen.h"
 
 #include "gocodegen.h"
@@ -109,17 +118,29 @@ CodeGenData *cdMakeCodeGen( const char *sourceFileName, const char *fsmName, ost
 	case HostLang::C:
 		switch ( codeStyle ) {
 		case GenTables:
-			codeGen = new CTabCodeGen(out);
+			if ( constexprTables )
+				codeGen = new CxxTabCodeGen(out);
+			else
+				codeGen = new CTabCodeGen(out);
 			break;
 		case GenFTables:
 			codeGen = new CFTabCodeGen(out);
 			break;
+		case GenCombTables:
+			codeGen = new CCombCodeGen(out);
+			break;
 		case GenFlat:
 			codeGen = new CFlatCodeGen(out);
 			break;
 		case GenFFlat:
 			codeGen = new CFFlatCodeGen(out);
 			break;
+		case GenClassFlat:
+			codeGen = new CClassFlatCodeGen(out);
+			break;
+		case GenDenseFlat:
+			codeGen = new CDenseFlatCodeGen(out);
+			break;
 		case GenGoto:
 			codeGen = new CGotoCodeGen(out);
 			break;
@@ -129,6 +150,15 @@ CodeGenData *cdMakeCodeGen( const char *sourceFileName, const char *fsmName, ost
 		case GenIpGoto:
 			codeGen = new CIpGotoCodeGen(out);
 			break;
+		case GenComputedGoto:
+			codeGen = new CComputedGotoCodeGen(out);
+			break;
+		case GenTailCall:
+			codeGen = new CTailCallCodeGen(out);
+			break;
+		case GenHybrid:
+			codeGen = new CHybridCodeGen(out);
+			break;
 		case GenSplit:
 			codeGen = new CSplitCodeGen(out);
 			break;
@@ -143,12 +173,21 @@ CodeGenData *cdMakeCodeGen( const char *sourceFileName, const char *fsmName, ost
 		case GenFTables:
 			codeGen = new DFTabCodeGen(out);
 			break;
+		case GenCombTables:
+			codeGen = new DCombCodeGen(out);
+			break;
 		case GenFlat:
 			codeGen = new DFlatCodeGen(out);
 			break;
 		case GenFFlat:
 			codeGen = new DFFlatCodeGen(out);
 			break;
+		case GenClassFlat:
+			codeGen = new DClassFlatCodeGen(out);
+			break;
+		case GenDenseFlat:
+			codeGen = new DDenseFlatCodeGen(out);
+			break;
 		case GenGoto:
 			codeGen = new DGotoCodeGen(out);
 			break;
@@ -161,6 +200,9 @@ CodeGenData *cdMakeCodeGen( const char *sourceFileName, const char *fsmName, ost
 		case GenSplit:
 			codeGen = new DSplitCodeGen(out);
 			break;
+		default:
+			cerr << "Invalid output style, -G3 to -G5 are only supported for C.\n";
+			exit(1);
 		}
 		break;
 
@@ -172,12 +214,21 @@ CodeGenData *cdMakeCodeGen( const char *sourceFileName, const char *fsmName, ost
 		case GenFTables:
 			codeGen = new D2FTabCodeGen(out);
 			break;
+		case GenCombTables:
+			codeGen = new D2CombCodeGen(out);
+			break;
 		case GenFlat:
 			codeGen = new D2FlatCodeGen(out);
 			break;
 		case GenFFlat:
 			codeGen = new D2FFlatCodeGen(out);
 			break;
+		case GenClassFlat:
+			codeGen = new D2ClassFlatCodeGen(out);
+			break;
+		case GenDenseFlat:
+			codeGen = new D2DenseFlatCodeGen(out);
+			break;
 		case GenGoto:
 			codeGen = new D2GotoCodeGen(out);
 			break;
@@ -190,6 +241,9 @@ CodeGenData *cdMakeCodeGen( const char *sourceFileName, const char *fsmName, ost
 		case GenSplit:
 			codeGen = new D2SplitCodeGen(out);
 			break;
+		default:
+			cerr << "Invalid output style, -G3 to -G5 are only supported for C.\n";
+			exit(1);
 		}
 		break;
 
@@ -320,6 +374,9 @@ CodeGenData *csharpMakeCodeGen( const char *sourceFileName, const char *fsmName,
 	case GenSplit:
 		codeGen = new CSharpSplitCodeGen(out);
 		break;
+	default:
+		cerr << "Invalid output style, only -T0, -T1, -F0, -F1, -G0, -G1, -G2 and -P<N> are supported for C#.\n";
+		exit(1);
 	}
 
 	codeGen->sourceFileName = sourceFileName;
@@ -394,6 +451,11 @@ CodeGenData *makeCodeGen( const char *sourceFileName, const char *fsmName, ostre
 	CodeGenData *cgd = 0;
 	if ( generateDot )
 		cgd = dotMakeCodeGen( sourceFileName, fsmName, out );
+	else if ( generateBlob ) {
+		cgd = new BlobCodeGen( out );
+		cgd->sourceFileName = sourceFileName;
+		cgd->fsmName = fsmName;
+	}
 	else if ( hostLang == &hostLangC )
 		cgd = cdMakeCodeGen( sourceFileName, fsmName, out );
 	else if ( hostLang == &hostLangD )
@@ -455,6 +517,7 @@ CodeGenData::CodeGenData( ostream &out )
 	sourceFileName(0),
 	fsmName(0), 
 	out(out),
+	sectionLoc(),
 	redFsm(0), 
 	allActions(0),
 	allActionTables(0),
@@ -648,6 +711,7 @@ void CodeGenData::setId( int snum, int id )
 {
 	RedStateAp *curState = allStates + snum;
 	curState->id = id;
+	curState->profileId = id;
 }
 
 void CodeGenData::setFinal( int snum )
@@ -762,14 +826,22 @@ void CodeGenData::addStateCond( int snum, Key lowKey, Key highKey, long condNum
 }
 
 
-GenCondSpace *CodeGenData::findCondSpace( Key lowKey, Key highKey )
+/* Find the condition space of a wide key range in a state. Spaces may share
+ * keys, so the state's condition ranges decide which one it belongs to. */
+GenCondSpace *CodeGenData::findCondSpace( RedStateAp *state, Key lowKey, Key highKey )
 {
-	for ( CondSpaceList::Iter cs = condSpaceList; cs.lte(); cs++ ) {
+	for ( GenStateCondList::Iter sc = state->stateCondList; sc.lte(); sc++ ) {
+		GenCondSpace *cs = sc->condSpace;
 		Key csHighKey = cs->baseKey;
 		csHighKey += keyOps->alphSize() * (1 << cs->condSet.length());
 
-		if ( lowKey >= cs->baseKey && highKey <= csHighKey )
-			return cs;
+		if ( lowKey >= cs->baseKey && highKey <= csHighKey ) {
+			Key values = ( lowKey - cs->baseKey ) / keyOps->alphSize();
+			Key onChar = keyOps->minKey + 
+				(lowKey - cs->baseKey - keyOps->alphSize() * values.getVal());
+			if ( sc->lowKey <= onChar && onChar <= sc->highKey )
+				return cs;
+		}
 	}
 	return 0;
 }
@@ -1158,6 +1230,61 @@ bool CodeGenData::writeStatement( InputLoc &loc, int nargs, char **args )
 			write_option_error( loc, args[i] );
 		writeExports();
 	}
+	else if ( strcmp( args[0], "chunks" ) == 0 ) {
+		for ( int i = 1; i < nargs; i++ )
+			write_option_error( loc, args[i] );
+
+		if ( hostLang != &hostLangC )
+			source_error(loc) << "write chunks is only supported for C" << endl;
+		else if ( redFsm->anyActions() || redFsm->anyConditions() ) {
+			source_error(loc) << "write chunks needs a machine without "
+					"actions or conditions" << endl;
+		}
+		else if ( keyOps->alphSize() > 256 ) {
+			source_error(loc) << "write chunks needs an alphabet of at most "
+					"256 keys" << endl;
+		}
+		else {
+			out << '\n';
+			genLineDirective( out );
+			followLineDirective = true;
+			writeChunks();
+		}
+	}
+	else if ( strcmp( args[0], "streams" ) == 0 ) {
+		for ( int i = 1; i < nargs; i++ )
+			write_option_error( loc, args[i] );
+
+		if ( hostLang != &hostLangC )
+			source_error(loc) << "write streams is only supported for C" << endl;
+		else if ( keyOps->alphSize() > 256 ) {
+			source_error(loc) << "write streams needs an alphabet of at most "
+					"256 keys" << endl;
+		}
+		else {
+			out << '\n';
+			genLineDirective( out );
+			followLineDirective = true;
+			writeStreams();
+		}
+	}
+	else if ( strcmp( args[0], "stride" ) == 0 ) {
+		for ( int i = 1; i < nargs; i++ )
+			write_option_error( loc, args[i] );
+
+		if ( hostLang != &hostLangC )
+			source_error(loc) << "write stride is only supported for C" << endl;
+		else if ( keyOps->alphSize() > 256 ) {
+			source_error(loc) << "write stride needs an alphabet of at most "
+					"256 keys" << endl;
+		}
+		else {
+			out << '\n';
+			genLineDirective( out );
+			followLineDirective = true;
+			writeStride();
+		}
+	}
 	else if ( strcmp( args[0], "start" ) == 0 ) {
 		for ( int i = 1; i < nargs; i++ )
 			write_option_error( loc, args[i] );
@@ -1181,6 +1308,20 @@ bool CodeGenData::writeStatement( InputLoc &loc, int nargs, char **args )
 	return followLineDirective;
 }
 
+string CodeGenData::keyBoundsTest( Key lowKey, Key highKey, const string &key,
+		const string &low, const string &high )
+{
+	string test;
+	if ( lowKey != keyOps->minKey )
+		test = low + " <= " + key;
+	if ( highKey != keyOps->maxKey ) {
+		if ( test.size() > 0 )
+			test += " && ";
+		test += key + " <= " + high;
+	}
+	return test;
+}
+
 ostream &CodeGenData::source_warning( const InputLoc &loc )
 {
 	cerr << sourceFileName << ":" << loc.line << ":" << loc.col << ": warning: ";
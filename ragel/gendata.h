@@ -68,6 +68,9 @@ struct CodeGenData
 	virtual void writeInit() {};
 	virtual void writeExec() {};
 	virtual void writeExports() {};
+	virtual void writeChunks() {};
+	virtual void writeStreams() {};
+	virtual void writeStride() {};
 	virtual void writeStart() {};
 	virtual void writeFirstFinal() {};
 	virtual void writeError() {};
@@ -88,6 +91,10 @@ struct CodeGenData
 	const char *sourceFileName;
 	const char *fsmName;
 	ostream &out;
+
+	/* Where the machine's section starts, for warnings about the machine. */
+	InputLoc sectionLoc;
+
 	RedFsmAp *redFsm;
 	GenAction *allActions;
 	RedAction *allActionTables;
@@ -160,7 +167,7 @@ struct CodeGenData
 	void initStateCondList( int snum, ulong length );
 	void addStateCond( int snum, Key lowKey, Key highKey, long condNum );
 
-	GenCondSpace *findCondSpace( Key lowKey, Key highKey );
+	GenCondSpace *findCondSpace( RedStateAp *state, Key lowKey, Key highKey );
 	Condition *findCondition( Key key );
 
 	bool setAlphType( const char *data );
@@ -178,6 +185,12 @@ struct CodeGenData
 	void setValueLimits();
 	void assignActionIds();
 
+	/* Test that a key is between lowKey and highKey, leaving out the tests
+	 * that the limits of the alphabet make true anyway. Empty if both are.
+	 * The key and the bounds are given as written in the host language. */
+	string keyBoundsTest( Key lowKey, Key highKey, const string &key,
+			const string &low, const string &high );
+
 	ostream &source_warning( const InputLoc &loc );
 	ostream &source_error( const InputLoc &loc );
 	void write_option_error( InputLoc &loc, char *arg );
@@ -686,15 +686,19 @@ void GoCodeGen::finishRagelDef()
 	/* Maybe do flat expand, otherwise choose single. */
 	if ( codeStyle == GenFlat || codeStyle == GenFFlat )
 		redFsm->makeFlat();
-	else
+	else {
+		if ( rangeBitmaps && ( codeStyle == GenGoto || 
+				codeStyle == GenFGoto || codeStyle == GenIpGoto ) )
+			redFsm->chooseRangeBitmaps();
 		redFsm->chooseSingle();
+	}
 
 	/* If any errors have occured in the input file then don't write anything. */
 	if ( gblErrorCount > 0 )
 		return;
 
 	if ( codeStyle == GenSplit )
-		redFsm->partitionFsm( numSplitPartitions );
+		redFsm->partitionFsm( numSplitPartitions, partitionSize );
 
 	if ( codeStyle == GenIpGoto || codeStyle == GenSplit )
 		redFsm->setInTrans();
@@ -169,6 +169,13 @@ void GoFGotoCodeGen::writeData()
 		endl;
 	}
 
+	if ( redFsm->rangeBits.length() > 0 ) {
+		OPEN_ARRAY( ARRAY_TYPE(0xff), RB() );
+		RANGE_BITS();
+		CLOSE_ARRAY() <<
+		endl;
+	}
+
 	STATE_IDS();
 }
 
@@ -141,8 +141,55 @@ void GoGotoCodeGen::emitSingleSwitch( RedStateAp *state, int level )
 	}
 }
 
+string GoGotoCodeGen::KEY_BOUNDS( Key lowKey, Key highKey )
+{
+	return keyBoundsTest( lowKey, highKey, GET_KEY(), KEY(lowKey), KEY(highKey) );
+}
+
+void GoGotoCodeGen::emitRangeBitmap( RedStateAp *state, int level )
+{
+	string bounds = KEY_BOUNDS( state->lowKey, state->highKey );
+	string offset = "(int(" + GET_KEY() + ") - " + KEY(state->lowKey) + ")";
+
+	if ( bounds.size() > 0 ) {
+		out << TABS(level) << "if " << bounds << " {" << endl;
+		level += 1;
+	}
+
+	for ( int t = 0; t < state->rangeTargs.length(); t++ ) {
+		out << TABS(level) << "if " << RB() << "[" << 
+				redFsm->rangeBitmapStart( state, t ) << " + (" << offset << 
+				" >> 3)] & (1 << uint(" << offset << " & 7)) != 0 {" << endl;
+		TRANS_GOTO( state->rangeTargs[t], level+1 ) << endl;
+		out << TABS(level) << "}" << endl;
+	}
+
+	if ( bounds.size() > 0 )
+		out << TABS(level-1) << "}" << endl;
+}
+
+std::ostream &GoGotoCodeGen::RANGE_BITS()
+{
+	out << "	";
+	for ( int pos = 0; pos < redFsm->rangeBits.length(); pos++ ) {
+		out << (unsigned int)redFsm->rangeBits[pos] << ", ";
+		if ( pos < redFsm->rangeBits.length()-1 ) {
+			if ( (pos+1) % IALL == 0 )
+				out << endl << "	";
+		}
+	}
+	out << endl;
+	return out;
+}
+
 void GoGotoCodeGen::emitRangeBSearch( RedStateAp *state, int level, int low, int high )
 {
+	/* States with many ranges going to few targets test bitmaps instead. */
+	if ( state->rangeBitmap ) {
+		emitRangeBitmap( state, level );
+		return;
+	}
+
 	/* Get the mid position, staying on the lower end of the range. */
 	int mid = (low + high) >> 1;
 	RedTransEl *data = state->outRange.data;
@@ -581,6 +628,13 @@ void GoGotoCodeGen::writeData()
 		endl;
 	}
 
+	if ( redFsm->rangeBits.length() > 0 ) {
+		OPEN_ARRAY( ARRAY_TYPE(0xff), RB() );
+		RANGE_BITS();
+		CLOSE_ARRAY() <<
+		endl;
+	}
+
 	STATE_IDS();
 }
 
@@ -72,6 +72,11 @@ protected:
 	void emitSingleSwitch( RedStateAp *state, int level );
 	void emitRangeBSearch( RedStateAp *state, int level, int low, int high );
 
+	/* Test the range bitmaps of a state. */
+	string KEY_BOUNDS( Key lowKey, Key highKey );
+	void emitRangeBitmap( RedStateAp *state, int level );
+	std::ostream &RANGE_BITS();
+
 	/* Called from STATE_GOTOS just before writing the gotos */
 	virtual void GOTO_HEADER( RedStateAp *state, int level );
 	virtual void STATE_GOTO_ERROR( int level );
@@ -437,6 +437,13 @@ void GoIpGotoCodeGen::setLabelsNeeded()
 
 void GoIpGotoCodeGen::writeData()
 {
+	if ( redFsm->rangeBits.length() > 0 ) {
+		OPEN_ARRAY( ARRAY_TYPE(0xff), RB() );
+		RANGE_BITS();
+		CLOSE_ARRAY() <<
+		endl;
+	}
+
 	STATE_IDS();
 }
 
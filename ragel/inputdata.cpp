@@ -26,6 +26,7 @@
 #include "rlparse.h"
 #include <iostream>
 #include "dotcodegen.h"
+#include "blobgen.h"
 
 using std::cout;
 using std::cerr;
@@ -113,9 +114,19 @@ void InputData::crystalDefaultFileName( const char *inputFile )
 		outputFileName = fileNameFromStem( inputFile, ".cr" );
 }
 
+/* Invoked by the parser when the root element is opened. */
+void InputData::blobDefaultFileName( const char *inputFile )
+{
+	/* If no output file name is given, then make a default. */
+	if ( outputFileName == 0 )
+		outputFileName = fileNameFromStem( inputFile, ".rlb" );
+}
+
 void InputData::makeOutputStream()
 {
-	if ( ! generateDot && ! generateXML ) {
+	if ( generateBlob )
+		blobDefaultFileName( inputFileName );
+	else if ( ! generateDot && ! generateXML ) {
 		switch ( hostLang->lang ) {
 			case HostLang::C:
 			case HostLang::D:
@@ -165,7 +176,11 @@ void InputData::makeOutputStream()
 void InputData::openOutput()
 {
 	if ( outFilter != 0 ) {
-		outFilter->open( outputFileName, ios::out|ios::trunc );
+		ios::openmode mode = ios::out|ios::trunc;
+		if ( generateBlob )
+			mode |= ios::binary;
+
+		outFilter->open( outputFileName, mode );
 		if ( !outFilter->is_open() ) {
 			error() << "error opening " << outputFileName << " for writing" << endl;
 			exit(1);
@@ -263,7 +278,13 @@ void InputData::writeOutput()
 		writeXML( *outStream );
 	else if ( generateDot )
 		static_cast<GraphvizDotGen*>(dotGenParser->pd->cgd)->writeDotFile();
+	else if ( generateBlob )
+		writeBlob( *outStream );
 	else {
+		/* The profile writers of --instrument use stdio. */
+		if ( instrument )
+			*outStream << "#include <stdio.h>\n";
+
 		bool hostLineDirective = true;
 		for ( InputItemList::Iter ii = inputItems; ii.lte(); ii++ ) {
 			if ( ii->type == InputItem::Write ) {
@@ -287,3 +308,24 @@ void InputData::writeOutput()
 	}
 }
 
+/* Write every machine into one --blob file. The host sections and the write
+ * statements are left out. */
+void InputData::writeBlob( std::ostream &out )
+{
+	unsigned int numMachines = 0;
+	for ( ParserDict::Iter parser = parserDict; parser.lte(); parser++ ) {
+		if ( parser->value->pd->cgd != 0 )
+			numMachines += 1;
+	}
+
+	BlobWriter writer( numMachines );
+	for ( ParserDict::Iter parser = parserDict; parser.lte(); parser++ ) {
+		CodeGenData *cgd = parser->value->pd->cgd;
+		if ( cgd != 0 ) {
+			::keyOps = &cgd->thisKeyOps;
+			static_cast<BlobCodeGen*>(cgd)->writeMachine( writer );
+		}
+	}
+
+	writer.finish( out );
+}
@@ -99,9 +99,11 @@ struct InputData
 	void csharpDefaultFileName( const char *inputFile );
 	void ocamlDefaultFileName( const char *inputFile );
 	void crystalDefaultFileName( const char *inputFile );
+	void blobDefaultFileName( const char *inputFile );
 
 	void writeLanguage( std::ostream &out );
 	void writeXML( std::ostream &out );
+	void writeBlob( std::ostream &out );
 };
 
 #endif
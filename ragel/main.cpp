@@ -55,6 +55,7 @@
 #include "version.h"
 #include "common.h"
 #include "inputdata.h"
+#include "profile.h"
 
 using std::istream;
 using std::ostream;
@@ -71,6 +72,50 @@ using std::streamsize;
 MinimizeLevel minimizeLevel = MinimizePartition2;
 MinimizeOpt minimizeOpt = MinimizeMostOps;
 
+/* Worker threads for parallel algorithms. Zero means one per processor. */
+int numThreads = 0;
+
+/* Fill in the states made by operations using the worker threads. */
+bool determinizeParallel = false;
+
+/* Overlay condition spaces on one another, guarded by the state's condition
+ * ranges, instead of giving each space its own keys. */
+bool condGuards = false;
+
+/* Largest table, in bytes, that the dense code style will write. */
+long denseLimit = 1048576;
+
+/* Scan ahead through states that loop on themselves. */
+bool skipLoops = false;
+
+/* Scan ahead in the start state for characters that can begin a match. */
+bool prefilter = false;
+
+/* Test the ranges of goto-style states that have many ranges going to a few
+ * targets with bitmaps. */
+bool rangeBitmaps = false;
+
+/* Percentage of a goto-style state's key span that must have transitions
+ * for it to switch on the key. Zero, the default, turns the switches off. */
+int switchDensity = 0;
+
+/* Hit counts used to lay out the generated code. */
+const char *profileUseFile = 0;
+
+/* Count the states entered and the keys taken in them. */
+bool instrument = false;
+
+/* Order of the states in the generated code. */
+StateOrder stateOrder = StateOrderDefault;
+
+/* Write an NFA run by a DFA made on demand, in a cache of lazyStates
+ * states. */
+bool lazyDfa = false;
+long lazyStates = 1024;
+
+/* Largest partition, in transitions, when -P0 chooses the count. */
+long partitionSize = 2000;
+
 /* Graphviz dot file generation. */
 const char *machineSpec = 0, *machineName = 0;
 bool machineSpecFound = false;
@@ -80,6 +125,12 @@ bool printStatistics = false;
 bool generateXML = false;
 bool generateDot = false;
 
+/* Write the machines into a file run by the engine in runtime/. */
+bool generateBlob = false;
+
+/* Write -T0 tables as constexpr C++ run by the engine in runtime/. */
+bool constexprTables = false;
+
 /* Target language and output style. */
 CodeStyle codeStyle = GenTables;
 
@@ -112,12 +163,25 @@ void usage()
 "   -m                   Minimize at the end of the compilation\n"
 "   -l                   Minimize after most operations (default)\n"
 "   -e                   Minimize after every operation\n"
+"   --minimize-parallel  Minimize using several threads\n"
+"   --determinize-parallel\n"
+"                        Make the states of union, concatenation and\n"
+"                        star operations using several threads\n"
+"   --threads=<N>        Use N threads for parallel work (default: one per\n"
+"                        processor)\n"
+"conditions:\n"
+"   --cond-guards        Let condition spaces share keys, using the state's\n"
+"                        condition ranges to tell them apart\n"
 "visualization:\n"
 "   -x                   Run the frontend only: emit XML intermediate format\n"
 "   -V                   Generate a dot file for Graphviz\n"
 "   -p                   Display printable characters on labels\n"
 "   -S <spec>            FSM specification to output (for graphviz output)\n"
 "   -M <machine>         Machine definition/instantiation to output (for graphviz output)\n"
+"machine files:\n"
+"   --blob               Write the machines into a file of tables run by the\n"
+"                        engine in runtime/, in place of the output code\n"
+"                        (default output: file.rlb)\n"
 "host language:\n"
 "   -C                   The host language is C, C++, Obj-C or Obj-C++ (default)\n"
 "   -D                   The host language is D\n"
@@ -135,12 +199,60 @@ void usage()
 "   -T1                  Faster table driven FSM\n"
 "   -F0                  Flat table driven FSM\n"
 "   -F1                  Faster flat table-driven FSM\n"
+"code style: (C/D)\n"
+"   -T2                  Faster table driven FSM with row displaced tables\n"
+"   -F2                  Faster flat table-driven FSM indexed by character\n"
+"                        class\n"
+"   -F3                  Dense table-driven FSM, one entry per state and\n"
+"                        character (8 bit alphabets only)\n"
+"   --dense-limit=<N>    Largest table in bytes that -F3 will write, above\n"
+"                        which it falls back to -F1 (default: 1048576)\n"
 "code style: (C/D/C#/OCaml)\n"
 "   -G0                  Goto-driven FSM\n"
 "   -G1                  Faster goto-driven FSM\n"
 "code style: (C/D)\n"
 "   -G2                  Really fast goto-driven FSM\n"
 "   -P<N>                N-Way Split really fast goto-driven FSM\n"
+"   --partition-size=<N> With -P0, split into parts of at most N transitions\n"
+"                        (default: 2000)\n"
+"   --range-bitmaps      With -G0 to -G2, test states with many ranges going\n"
+"                        to a few targets against bitmaps (also C# and Go);\n"
+"                        -G3 only when the keys are too wide for its class\n"
+"                        jump tables\n"
+"   --switch-density=<N> Switch on the key in goto-driven states whose key\n"
+"                        span is at least N percent covered by transitions,\n"
+"                        0 for never (default: 0)\n"
+"   --profile-use=<file> Order states, pick default transitions and arrange\n"
+"                        goto-driven compare trees by the hit counts in file\n"
+"   --state-order=<ord>  Number and lay out the states depth first (dfs),\n"
+"                        breadth first (bfs) or in chains of the most\n"
+"                        connected states (affinity)\n"
+"code style: (C)\n"
+"   -G3                  Really fast goto-driven FSM dispatching through\n"
+"                        label address tables (GCC and Clang)\n"
+"   -G4                  Goto-driven FSM made of state functions joined by\n"
+"                        tail calls, reaching the machine through fsm as\n"
+"                        with -P; needs musttail (Clang, GCC 15) to be\n"
+"                        fast, otherwise it runs through a trampoline\n"
+"   -G5                  Really fast goto-driven FSM choosing for each state\n"
+"                        between compare trees, bitmaps and flat rows by\n"
+"                        estimated cost\n"
+"   --skip-loops         With -G0 to -G3, -G5 and 8 bit alphabets, scan ahead\n"
+"                        through states that loop on themselves until one of\n"
+"                        a few characters, using SSE2 where available\n"
+"   --prefilter          With -G0 to -G3, -G5 and 8 bit alphabets, scan\n"
+"                        ahead in an unanchored start state for the next\n"
+"                        character that can begin a match\n"
+"   --instrument         Count the times each state is entered and each key\n"
+"                        taken in it, with a function writing the counts in\n"
+"                        the form read by --profile-use\n"
+"   --lazy               Do not determinize the machine. Write it with write\n"
+"                        lazy as an NFA run by a DFA made as it is reached\n"
+"                        (machines without actions only)\n"
+"   --lazy-states=<N>    Keep at most N states of a --lazy DFA (default: 1024)\n"
+"   --constexpr          With -T0 and C++17, write the tables as constexpr\n"
+"                        members of a struct for each machine, run by the\n"
+"                        template engine in runtime/rlexec.h\n"
 	;	
 
 	exit(0);
@@ -373,6 +485,84 @@ void processArgs( int argc, const char **argv, InputData &id )
 				}
 				else if ( strcmp( arg, "rbx" ) == 0 )
 					rubyImpl = Rubinius;
+				else if ( strcmp( arg, "minimize-parallel" ) == 0 )
+					minimizeLevel = MinimizePartitionParallel;
+				else if ( strcmp( arg, "determinize-parallel" ) == 0 )
+					determinizeParallel = true;
+				else if ( strcmp( arg, "cond-guards" ) == 0 )
+					condGuards = true;
+				else if ( strcmp( arg, "dense-limit" ) == 0 ) {
+					if ( eq == 0 )
+						error() << "expecting '=value' for dense-limit" << endl;
+					else if ( atol( eq ) <= 0 )
+						error() << "invalid value for dense-limit" << endl;
+					else
+						denseLimit = atol( eq );
+				}
+				else if ( strcmp( arg, "skip-loops" ) == 0 )
+					skipLoops = true;
+				else if ( strcmp( arg, "prefilter" ) == 0 )
+					prefilter = true;
+				else if ( strcmp( arg, "range-bitmaps" ) == 0 )
+					rangeBitmaps = true;
+				else if ( strcmp( arg, "switch-density" ) == 0 ) {
+					if ( eq == 0 )
+						error() << "expecting '=value' for switch-density" << endl;
+					else if ( atoi( eq ) < 0 || atoi( eq ) > 100 )
+						error() << "invalid value for switch-density" << endl;
+					else
+						switchDensity = atoi( eq );
+				}
+				else if ( strcmp( arg, "instrument" ) == 0 )
+					instrument = true;
+				else if ( strcmp( arg, "profile-use" ) == 0 ) {
+					if ( eq == 0 )
+						error() << "expecting '=value' for profile-use" << endl;
+					else
+						profileUseFile = strdup( eq );
+				}
+				else if ( strcmp( arg, "state-order" ) == 0 ) {
+					if ( eq == 0 )
+						error() << "expecting '=value' for state-order" << endl;
+					else if ( strcmp( eq, "dfs" ) == 0 )
+						stateOrder = StateOrderDfs;
+					else if ( strcmp( eq, "bfs" ) == 0 )
+						stateOrder = StateOrderBfs;
+					else if ( strcmp( eq, "affinity" ) == 0 )
+						stateOrder = StateOrderAffinity;
+					else
+						error() << "invalid value for state-order" << endl;
+				}
+				else if ( strcmp( arg, "lazy" ) == 0 )
+					lazyDfa = true;
+				else if ( strcmp( arg, "blob" ) == 0 )
+					generateBlob = true;
+				else if ( strcmp( arg, "constexpr" ) == 0 )
+					constexprTables = true;
+				else if ( strcmp( arg, "lazy-states" ) == 0 ) {
+					if ( eq == 0 )
+						error() << "expecting '=value' for lazy-states" << endl;
+					else if ( atol( eq ) <= 0 )
+						error() << "invalid value for lazy-states" << endl;
+					else
+						lazyStates = atol( eq );
+				}
+				else if ( strcmp( arg, "partition-size" ) == 0 ) {
+					if ( eq == 0 )
+						error() << "expecting '=value' for partition-size" << endl;
+					else if ( atol( eq ) <= 0 )
+						error() << "invalid value for partition-size" << endl;
+					else
+						partitionSize = atol( eq );
+				}
+				else if ( strcmp( arg, "threads" ) == 0 ) {
+					if ( eq == 0 )
+						error() << "expecting '=value' for threads" << endl;
+					else if ( atoi( eq ) <= 0 )
+						error() << "invalid value for threads" << endl;
+					else
+						numThreads = atoi( eq );
+				}
 				else {
 					error() << "--" << pc.paramArg << 
 							" is an invalid argument" << endl;
@@ -387,6 +577,8 @@ void processArgs( int argc, const char **argv, InputData &id )
 					codeStyle = GenTables;
 				else if ( pc.paramArg[0] == '1' )
 					codeStyle = GenFTables;
+				else if ( pc.paramArg[0] == '2' )
+					codeStyle = GenCombTables;
 				else {
 					error() << "-T" << pc.paramArg[0] << 
 							" is an invalid argument" << endl;
@@ -398,6 +590,10 @@ void processArgs( int argc, const char **argv, InputData &id )
 					codeStyle = GenFlat;
 				else if ( pc.paramArg[0] == '1' )
 					codeStyle = GenFFlat;
+				else if ( pc.paramArg[0] == '2' )
+					codeStyle = GenClassFlat;
+				else if ( pc.paramArg[0] == '3' )
+					codeStyle = GenDenseFlat;
 				else {
 					error() << "-F" << pc.paramArg[0] << 
 							" is an invalid argument" << endl;
@@ -411,6 +607,12 @@ void processArgs( int argc, const char **argv, InputData &id )
 					codeStyle = GenFGoto;
 				else if ( pc.paramArg[0] == '2' )
 					codeStyle = GenIpGoto;
+				else if ( pc.paramArg[0] == '3' )
+					codeStyle = GenComputedGoto;
+				else if ( pc.paramArg[0] == '4' )
+					codeStyle = GenTailCall;
+				else if ( pc.paramArg[0] == '5' )
+					codeStyle = GenHybrid;
 				else {
 					error() << "-G" << pc.paramArg[0] << 
 							" is an invalid argument" << endl;
@@ -555,10 +757,38 @@ int main( int argc, const char **argv )
 	if ( id.inputFileName == 0 )
 		error() << "no input file given" << endl;
 
+	if ( instrument && hostLang->lang != HostLang::C )
+		error() << "--instrument is only supported for C" << endl;
+
+	if ( lazyDfa && hostLang->lang != HostLang::C )
+		error() << "--lazy is only supported for C" << endl;
+	else if ( lazyDfa && ( generateXML || generateDot ) )
+		error() << "--lazy can not be used with -x or -V" << endl;
+
+	if ( generateBlob && ( generateXML || generateDot || lazyDfa ) )
+		error() << "--blob can not be used with -x, -V or --lazy" << endl;
+
+	if ( constexprTables && hostLang->lang != HostLang::C )
+		error() << "--constexpr is only supported for C++" << endl;
+	else if ( constexprTables && codeStyle != GenTables )
+		error() << "--constexpr needs -T0" << endl;
+	else if ( constexprTables && ( generateXML || generateDot ||
+			generateBlob || lazyDfa || instrument ) )
+	{
+		error() << "--constexpr can not be used with -x, -V, --blob, "
+				"--lazy or --instrument" << endl;
+	}
+
 	/* Bail on argument processing errors. */
 	if ( gblErrorCount > 0 )
 		exit(1);
 
+	if ( profileUseFile != 0 ) {
+		readProfile( profileUseFile );
+		if ( gblErrorCount > 0 )
+			exit(1);
+	}
+
 	/* Make sure we are not writing to the same file as the input file. */
 	if ( id.inputFileName != 0 && id.outputFileName != 0 && 
 			strcmp( id.inputFileName, id.outputFileName  ) == 0 )
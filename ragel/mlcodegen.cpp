@@ -714,7 +714,7 @@ void OCamlCodeGen::finishRagelDef()
 		return;
 	
 	if ( codeStyle == GenSplit )
-		redFsm->partitionFsm( numSplitPartitions );
+		redFsm->partitionFsm( numSplitPartitions, partitionSize );
 
 	if ( codeStyle == GenIpGoto || codeStyle == GenSplit )
 		redFsm->setInTrans();
@@ -0,0 +1,405 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ragel.h"
+#include "nfagraph.h"
+#include "parsedata.h"
+#include "parsetree.h"
+
+using std::endl;
+
+NfaGraph::NfaGraph( const InputLoc &loc )
+:
+	loc(loc),
+	startState(-1),
+	finalState(-1),
+	reportedActions(false)
+{
+}
+
+NfaGraph::~NfaGraph()
+{
+	for ( int s = 0; s < states.length(); s++ )
+		delete states[s];
+}
+
+int NfaGraph::addState()
+{
+	states.append( new NfaState );
+	return states.length() - 1;
+}
+
+void NfaGraph::addTrans( int from, long long lowKey, long long highKey, int targ )
+{
+	NfaTrans trans;
+	trans.lowKey = lowKey;
+	trans.highKey = highKey;
+	trans.targ = targ;
+	states[from]->outList.append( trans );
+}
+
+void NfaGraph::addEps( int from, int targ )
+{
+	states[from]->epsList.append( targ );
+}
+
+/* True if anything in the graph would run code or test conditions. */
+static bool fsmHasActions( FsmAp *fsm )
+{
+	for ( StateList::Iter st = fsm->stateList; st.lte(); st++ ) {
+		if ( st->toStateActionTable.length() > 0 ||
+				st->fromStateActionTable.length() > 0 ||
+				st->outActionTable.length() > 0 ||
+				st->outCondSet.length() > 0 ||
+				st->errActionTable.length() > 0 ||
+				st->eofActionTable.length() > 0 ||
+				st->stateCondList.length() > 0 )
+			return true;
+
+		for ( TransList::Iter trans = st->outList; trans.lte(); trans++ ) {
+			if ( trans->actionTable.length() > 0 ||
+					trans->lmActionTable.length() > 0 )
+				return true;
+		}
+	}
+	return false;
+}
+
+void NfaGraph::actionError( const InputLoc &loc )
+{
+	if ( !reportedActions ) {
+		error(loc) << "--lazy needs a machine without actions, priorities "
+				"or conditions" << endl;
+		reportedActions = true;
+	}
+}
+
+NfaFrag NfaGraph::fsmFrag( FsmAp *fsm )
+{
+	if ( fsmHasActions( fsm ) )
+		actionError( loc );
+
+	NfaFrag frag;
+	frag.first = states.length();
+	fsm->setStateNumbers( frag.first );
+	for ( StateList::Iter st = fsm->stateList; st.lte(); st++ )
+		addState();
+	frag.end = addState();
+	frag.start = fsm->startState->alg.stateNum;
+
+	for ( StateList::Iter st = fsm->stateList; st.lte(); st++ ) {
+		for ( TransList::Iter trans = st->outList; trans.lte(); trans++ ) {
+			if ( trans->toState != 0 ) {
+				addTrans( st->alg.stateNum, trans->lowKey.getLongLong(),
+						trans->highKey.getLongLong(),
+						trans->toState->alg.stateNum );
+			}
+		}
+		if ( st->isFinState() )
+			addEps( st->alg.stateNum, frag.end );
+	}
+
+	frag.past = states.length();
+	delete fsm;
+	return frag;
+}
+
+NfaFrag NfaGraph::lambdaFrag()
+{
+	NfaFrag frag;
+	frag.first = states.length();
+	frag.start = addState();
+	frag.end = addState();
+	addEps( frag.start, frag.end );
+	frag.past = states.length();
+	return frag;
+}
+
+NfaFrag NfaGraph::copyFrag( const NfaFrag &frag )
+{
+	int offset = states.length() - frag.first;
+	for ( int s = frag.first; s < frag.past; s++ ) {
+		int c = addState();
+		NfaState *state = states[s];
+		for ( int t = 0; t < state->outList.length(); t++ ) {
+			NfaTrans &trans = state->outList[t];
+			addTrans( c, trans.lowKey, trans.highKey, trans.targ + offset );
+		}
+		for ( int e = 0; e < state->epsList.length(); e++ )
+			addEps( c, state->epsList[e] + offset );
+	}
+
+	NfaFrag copy;
+	copy.start = frag.start + offset;
+	copy.end = frag.end + offset;
+	copy.first = frag.first + offset;
+	copy.past = states.length();
+	return copy;
+}
+
+NfaFrag NfaGraph::concatFrag( const NfaFrag &f1, const NfaFrag &f2 )
+{
+	addEps( f1.end, f2.start );
+
+	NfaFrag frag;
+	frag.start = f1.start;
+	frag.end = f2.end;
+	frag.first = f1.first < f2.first ? f1.first : f2.first;
+	frag.past = states.length();
+	return frag;
+}
+
+NfaFrag NfaGraph::unionFrag( const NfaFrag &f1, const NfaFrag &f2 )
+{
+	NfaFrag frag;
+	frag.start = addState();
+	frag.end = addState();
+	addEps( frag.start, f1.start );
+	addEps( frag.start, f2.start );
+	addEps( f1.end, frag.end );
+	addEps( f2.end, frag.end );
+	frag.first = f1.first < f2.first ? f1.first : f2.first;
+	frag.past = states.length();
+	return frag;
+}
+
+NfaFrag NfaGraph::optionalFrag( const NfaFrag &f1 )
+{
+	NfaFrag frag;
+	frag.start = addState();
+	frag.end = addState();
+	addEps( frag.start, f1.start );
+	addEps( frag.start, frag.end );
+	addEps( f1.end, frag.end );
+	frag.first = f1.first;
+	frag.past = states.length();
+	return frag;
+}
+
+NfaFrag NfaGraph::plusFrag( const NfaFrag &f1 )
+{
+	NfaFrag frag;
+	frag.start = f1.start;
+	frag.end = addState();
+	addEps( f1.end, f1.start );
+	addEps( f1.end, frag.end );
+	frag.first = f1.first;
+	frag.past = states.length();
+	return frag;
+}
+
+NfaFrag NfaGraph::starFrag( const NfaFrag &f1 )
+{
+	return optionalFrag( plusFrag( f1 ) );
+}
+
+/* Between lower and upper copies of the piece, with an upper of -1 meaning
+ * any number. The copies are taken before the piece is joined to anything.
+ * The piece must not be empty of copies, which the callers check. */
+NfaFrag NfaGraph::repeatFrag( const NfaFrag &f1, int lower, int upper )
+{
+	int copies = upper < 0 ? ( lower > 0 ? lower : 1 ) : upper;
+	NfaFrag *pieces = new NfaFrag[copies];
+	pieces[0] = f1;
+	for ( int i = 1; i < copies; i++ )
+		pieces[i] = copyFrag( f1 );
+
+	if ( upper < 0 ) {
+		/* The last copy repeats. */
+		if ( lower == 0 )
+			pieces[0] = starFrag( pieces[0] );
+		else
+			pieces[copies-1] = plusFrag( pieces[copies-1] );
+	}
+	else {
+		for ( int i = lower; i < upper; i++ )
+			pieces[i] = optionalFrag( pieces[i] );
+	}
+
+	NfaFrag frag = pieces[0];
+	for ( int i = 1; i < copies; i++ )
+		frag = concatFrag( frag, pieces[i] );
+
+	delete[] pieces;
+	return frag;
+}
+
+/*
+ * Parse tree walks for --lazy. Operators that join machines are done on the
+ * NfaGraph. The leaves, and operators that need a deterministic graph, are
+ * made with the regular walk. Name scopes are entered as the regular walk
+ * enters them so that the two can be mixed.
+ */
+
+NfaFrag VarDef::walkNfa( ParseData *pd, NfaGraph *nfa )
+{
+	NameFrame nameFrame = pd->enterNameScope( true, 1 );
+	NfaFrag frag = machineDef->walkNfa( pd, nfa );
+	pd->popNameScope( nameFrame );
+	return frag;
+}
+
+NfaFrag MachineDef::walkNfa( ParseData *pd, NfaGraph *nfa )
+{
+	if ( type != JoinType ) {
+		error(nfa->loc) << "scanners are not supported with --lazy" << endl;
+		return nfa->lambdaFrag();
+	}
+	return join->walkNfa( pd, nfa );
+}
+
+NfaFrag Join::walkNfa( ParseData *pd, NfaGraph *nfa )
+{
+	if ( exprList.length() > 1 )
+		return nfa->fsmFrag( walkJoin( pd ) );
+	return exprList.head->walkNfa( pd, nfa );
+}
+
+NfaFrag Expression::walkNfa( ParseData *pd, NfaGraph *nfa )
+{
+	switch ( type ) {
+		case OrType: {
+			NfaFrag f1 = expression->walkNfa( pd, nfa );
+			NfaFrag f2 = term->walkNfa( pd, nfa );
+			return nfa->unionFrag( f1, f2 );
+		}
+		case TermType:
+			return term->walkNfa( pd, nfa );
+		case BuiltinType:
+			return nfa->fsmFrag( makeBuiltin( builtin, pd ) );
+		default:
+			break;
+	}
+
+	/* Intersection and subtraction. */
+	return nfa->fsmFrag( walk( pd ) );
+}
+
+NfaFrag Term::walkNfa( ParseData *pd, NfaGraph *nfa )
+{
+	switch ( type ) {
+		case ConcatType: {
+			NfaFrag f1 = term->walkNfa( pd, nfa );
+			NfaFrag f2 = factorWithAug->walkNfa( pd, nfa );
+			return nfa->concatFrag( f1, f2 );
+		}
+		case FactorWithAugType:
+			return factorWithAug->walkNfa( pd, nfa );
+		default:
+			break;
+	}
+
+	/* The guarded concatenations resolve priorities. */
+	return nfa->fsmFrag( walk( pd ) );
+}
+
+NfaFrag FactorWithAug::walkNfa( ParseData *pd, NfaGraph *nfa )
+{
+	if ( actions.length() > 0 || priorityAugs.length() > 0 ||
+			conditions.length() > 0 )
+	{
+		if ( actions.length() > 0 )
+			nfa->actionError( actions[0].loc );
+		else if ( conditions.length() > 0 )
+			nfa->actionError( conditions[0].loc );
+		else
+			nfa->actionError( nfa->loc );
+		return nfa->lambdaFrag();
+	}
+
+	if ( labels.length() > 0 || epsilonLinks.length() > 0 ) {
+		InputLoc &loc = labels.length() > 0 ?
+				labels[0].loc : epsilonLinks[0].loc;
+		error(loc) << "labels and epsilon transitions are not supported "
+				"with --lazy" << endl;
+		return nfa->lambdaFrag();
+	}
+
+	return factorWithRep->walkNfa( pd, nfa );
+}
+
+NfaFrag FactorWithRep::walkNfa( ParseData *pd, NfaGraph *nfa )
+{
+	switch ( type ) {
+		case StarType:
+			return nfa->starFrag( factorWithRep->walkNfa( pd, nfa ) );
+		case StarStarType:
+			/* Resolves priorities. */
+			return nfa->fsmFrag( walk( pd ) );
+		case OptionalType:
+			return nfa->optionalFrag( factorWithRep->walkNfa( pd, nfa ) );
+		case PlusType:
+			return nfa->plusFrag( factorWithRep->walkNfa( pd, nfa ) );
+		case ExactType:
+			if ( lowerRep == 0 )
+				return nfa->lambdaFrag();
+			return nfa->repeatFrag( factorWithRep->walkNfa( pd, nfa ),
+					lowerRep, lowerRep );
+		case MaxType:
+			if ( upperRep == 0 )
+				return nfa->lambdaFrag();
+			return nfa->repeatFrag( factorWithRep->walkNfa( pd, nfa ),
+					0, upperRep );
+		case MinType:
+			return nfa->repeatFrag( factorWithRep->walkNfa( pd, nfa ),
+					lowerRep, -1 );
+		case RangeType:
+			if ( upperRep - lowerRep < 0 ) {
+				error(loc) << "invalid range repetition" << endl;
+				return nfa->lambdaFrag();
+			}
+			if ( upperRep == 0 )
+				return nfa->lambdaFrag();
+			return nfa->repeatFrag( factorWithRep->walkNfa( pd, nfa ),
+					lowerRep, upperRep );
+		case FactorWithNegType:
+			break;
+	}
+	return factorWithNeg->walkNfa( pd, nfa );
+}
+
+NfaFrag FactorWithNeg::walkNfa( ParseData *pd, NfaGraph *nfa )
+{
+	if ( type == FactorType )
+		return factor->walkNfa( pd, nfa );
+
+	/* Negation is subtraction. */
+	return nfa->fsmFrag( walk( pd ) );
+}
+
+NfaFrag Factor::walkNfa( ParseData *pd, NfaGraph *nfa )
+{
+	switch ( type ) {
+		case ReferenceType: {
+			InputLoc prevLoc = nfa->loc;
+			nfa->loc = loc;
+			NfaFrag frag = varDef->walkNfa( pd, nfa );
+			nfa->loc = prevLoc;
+			return frag;
+		}
+		case ParenType:
+			return join->walkNfa( pd, nfa );
+		case LongestMatchType:
+			error(nfa->loc) << "scanners are not supported with --lazy" << endl;
+			return nfa->lambdaFrag();
+		default:
+			break;
+	}
+
+	/* Literals, ranges and regular expressions. */
+	return nfa->fsmFrag( walk( pd ) );
+}
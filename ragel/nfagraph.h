@@ -0,0 +1,88 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _NFAGRAPH_H
+#define _NFAGRAPH_H
+
+#include "ragel.h"
+#include "vector.h"
+
+struct FsmAp;
+
+/* The bounds are kept as long longs, which need no signedness interpretation,
+ * so the vector of them can be moved with realloc. */
+struct NfaTrans
+{
+	long long lowKey, highKey;
+	int targ;
+};
+
+struct NfaState
+{
+	Vector<NfaTrans> outList;
+	Vector<int> epsList;
+};
+
+/* A piece of the graph with one way in and one way out. The states of the
+ * piece are the ones numbered from first up to past. No transition leaves
+ * them until the piece is joined to another. */
+struct NfaFrag
+{
+	int start, end;
+	int first, past;
+};
+
+/*
+ * Nondeterministic graph made by --lazy in place of the FsmAp of a machine.
+ * The operators that make deterministic graphs blow up on are done here with
+ * epsilon transitions, as in Thompson's construction. The parts below them
+ * are made deterministically by the regular walk and copied in.
+ */
+struct NfaGraph
+{
+	NfaGraph( const InputLoc &loc );
+	~NfaGraph();
+
+	int addState();
+	void addTrans( int from, long long lowKey, long long highKey, int targ );
+	void addEps( int from, int targ );
+
+	/* Make a piece from a deterministic graph, which is deleted. */
+	NfaFrag fsmFrag( FsmAp *fsm );
+
+	NfaFrag lambdaFrag();
+	NfaFrag copyFrag( const NfaFrag &frag );
+	NfaFrag concatFrag( const NfaFrag &f1, const NfaFrag &f2 );
+	NfaFrag unionFrag( const NfaFrag &f1, const NfaFrag &f2 );
+	NfaFrag optionalFrag( const NfaFrag &frag );
+	NfaFrag plusFrag( const NfaFrag &frag );
+	NfaFrag starFrag( const NfaFrag &frag );
+	NfaFrag repeatFrag( const NfaFrag &frag, int lower, int upper );
+
+	/* Report, once, that the machine runs code or tests conditions. */
+	void actionError( const InputLoc &loc );
+
+	/* Where to report what the construction can not do. */
+	InputLoc loc;
+
+	Vector<NfaState*> states;
+	int startState;
+	int finalState;
+	bool reportedActions;
+};
+
+#endif
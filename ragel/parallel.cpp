@@ -0,0 +1,229 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ragel.h"
+#include "parallel.h"
+
+#ifdef HAVE_PTHREAD_H
+#include <unistd.h>
+#endif
+
+/* Work that is being handed out. Items are claimed a chunk at a time by
+ * bumping next. */
+struct ParallelJob
+{
+	ParallelWork work;
+	void *arg;
+	long numItems;
+	long chunk;
+	volatile long next;
+};
+
+static void runChunks( ParallelJob *job )
+{
+	while ( true ) {
+		long begin = __sync_fetch_and_add( &job->next, job->chunk );
+		if ( begin >= job->numItems )
+			break;
+
+		long end = begin + job->chunk;
+		if ( end > job->numItems )
+			end = job->numItems;
+
+		job->work( job->arg, begin, end );
+	}
+}
+
+#ifdef HAVE_PTHREAD_H
+
+/* Pool of worker threads. The workers are started on the first parallel call
+ * and then sit waiting for the next job until the program exits. */
+struct WorkerPool
+{
+	WorkerPool() : started(0), generation(0), running(0), job(0)
+	{
+		pthread_mutex_init( &mutex, 0 );
+		pthread_cond_init( &startCond, 0 );
+		pthread_cond_init( &doneCond, 0 );
+	}
+
+	void start( int numWorkers );
+	void run( ParallelJob *job );
+	void workerLoop( long seen );
+
+	int started;
+	long generation;
+	int running;
+	ParallelJob *job;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t startCond;
+	pthread_cond_t doneCond;
+};
+
+static WorkerPool workerPool;
+
+/* Given to a new worker. It holds the generation current when the worker was
+ * made, so the worker waits for the next job and not one already run. */
+struct WorkerStart
+{
+	WorkerPool *pool;
+	long seen;
+};
+
+static void *workerMain( void *arg )
+{
+	WorkerStart *workerStart = (WorkerStart*)arg;
+	WorkerPool *pool = workerStart->pool;
+	long seen = workerStart->seen;
+	delete workerStart;
+
+	pool->workerLoop( seen );
+	return 0;
+}
+
+void WorkerPool::workerLoop( long seen )
+{
+	pthread_mutex_lock( &mutex );
+	while ( true ) {
+		while ( generation == seen )
+			pthread_cond_wait( &startCond, &mutex );
+		seen = generation;
+		ParallelJob *cur = job;
+		pthread_mutex_unlock( &mutex );
+
+		runChunks( cur );
+
+		pthread_mutex_lock( &mutex );
+		if ( --running == 0 )
+			pthread_cond_signal( &doneCond );
+	}
+}
+
+void WorkerPool::start( int numWorkers )
+{
+	pthread_mutex_lock( &mutex );
+	for ( ; started < numWorkers; started++ ) {
+		WorkerStart *workerStart = new WorkerStart;
+		workerStart->pool = this;
+		workerStart->seen = generation;
+
+		pthread_t thread;
+		if ( pthread_create( &thread, 0, &workerMain, workerStart ) != 0 ) {
+			delete workerStart;
+			break;
+		}
+		pthread_detach( thread );
+	}
+	pthread_mutex_unlock( &mutex );
+}
+
+void WorkerPool::run( ParallelJob *newJob )
+{
+	pthread_mutex_lock( &mutex );
+	job = newJob;
+	running = started;
+	generation += 1;
+	pthread_cond_broadcast( &startCond );
+	pthread_mutex_unlock( &mutex );
+
+	/* The calling thread works too. */
+	runChunks( newJob );
+
+	pthread_mutex_lock( &mutex );
+	while ( running > 0 )
+		pthread_cond_wait( &doneCond, &mutex );
+	job = 0;
+	pthread_mutex_unlock( &mutex );
+}
+
+ParallelLock::ParallelLock()
+{
+	pthread_mutex_init( &mutex, 0 );
+}
+
+ParallelLock::~ParallelLock()
+{
+	pthread_mutex_destroy( &mutex );
+}
+
+void ParallelLock::lock()
+{
+	pthread_mutex_lock( &mutex );
+}
+
+void ParallelLock::unlock()
+{
+	pthread_mutex_unlock( &mutex );
+}
+
+int workerThreads()
+{
+	if ( numThreads > 0 )
+		return numThreads;
+
+	long online = sysconf( _SC_NPROCESSORS_ONLN );
+	return online > 0 ? (int)online : 1;
+}
+
+#else
+
+ParallelLock::ParallelLock() { }
+ParallelLock::~ParallelLock() { }
+void ParallelLock::lock() { }
+void ParallelLock::unlock() { }
+
+int workerThreads()
+{
+	return 1;
+}
+
+#endif
+
+void parallelFor( long numItems, long minChunk, ParallelWork work, void *arg )
+{
+	if ( numItems <= 0 )
+		return;
+
+	if ( minChunk < 1 )
+		minChunk = 1;
+
+	int threads = workerThreads();
+	if ( threads <= 1 || numItems <= minChunk ) {
+		work( arg, 0, numItems );
+		return;
+	}
+
+	/* Aim for a few chunks per thread so that uneven items even out. */
+	long chunk = numItems / ( threads * 4 );
+	if ( chunk < minChunk )
+		chunk = minChunk;
+
+	ParallelJob job;
+	job.work = work;
+	job.arg = arg;
+	job.numItems = numItems;
+	job.chunk = chunk;
+	job.next = 0;
+
+#ifdef HAVE_PTHREAD_H
+	workerPool.start( threads - 1 );
+	workerPool.run( &job );
+#else
+	runChunks( &job );
+#endif
+}
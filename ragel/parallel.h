@@ -0,0 +1,161 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _PARALLEL_H
+#define _PARALLEL_H
+
+#include "config.h"
+#include <string.h>
+#include "mergesort.h"
+
+#ifdef HAVE_PTHREAD_H
+#include <pthread.h>
+#endif
+
+/* Work item callback. Called with the user argument and a half open range of
+ * item indicies [begin, end). Calls may come from any thread and must not
+ * touch shared data that other items write. */
+typedef void (*ParallelWork)( void *arg, long begin, long end );
+
+/* Number of threads to use, as resolved from the --threads option. Never
+ * less than one. */
+int workerThreads();
+
+/* Run work over the items [0, numItems), handing out chunks of at least
+ * minChunk items to the worker threads. The calling thread takes part in the
+ * work and the call returns when all items are done. When there is only one
+ * thread, or too few items to be worth splitting, the work is done directly
+ * in the calling thread. */
+void parallelFor( long numItems, long minChunk, ParallelWork work, void *arg );
+
+/* Mutual exclusion for data shared by parallel work. Does nothing when
+ * threads are not available. */
+struct ParallelLock
+{
+	ParallelLock();
+	~ParallelLock();
+
+	void lock();
+	void unlock();
+
+#ifdef HAVE_PTHREAD_H
+	pthread_mutex_t mutex;
+#endif
+};
+
+/* Stable merge sort that sorts chunks of the array in parallel, then merges
+ * neighbouring runs pairwise, also in parallel. Gives the same order as a
+ * MergeSort with the same compare. The compare object is copied into each
+ * worker and must be safe to use from several threads at once. */
+template <class T, class Compare> struct ParallelSort
+{
+	ParallelSort( const Compare &cmp ) : cmp(cmp) { }
+
+	void sort( T *data, long len );
+
+	static void sortRuns( void *arg, long begin, long end );
+	static void mergeRuns( void *arg, long begin, long end );
+
+	Compare cmp;
+	T *data, *tmp;
+	long len, width;
+};
+
+/* Below this many items the sort is done serially. */
+#define _PS_SERIAL_THRESH 4096
+
+template <class T, class Compare> void ParallelSort<T, Compare>::
+		sortRuns( void *arg, long begin, long end )
+{
+	ParallelSort *ps = (ParallelSort*)arg;
+	MergeSort<T, Compare> mergeSort;
+	static_cast<Compare&>( mergeSort ) = ps->cmp;
+	for ( long r = begin; r < end; r++ ) {
+		long start = r * ps->width;
+		long runLen = ps->len - start < ps->width ? ps->len - start : ps->width;
+		mergeSort.sort( ps->data + start, runLen );
+	}
+}
+
+template <class T, class Compare> void ParallelSort<T, Compare>::
+		mergeRuns( void *arg, long begin, long end )
+{
+	ParallelSort *ps = (ParallelSort*)arg;
+	Compare cmp = ps->cmp;
+	for ( long r = begin; r < end; r++ ) {
+		long start = r * 2 * ps->width;
+		long mid = start + ps->width, stop = start + 2 * ps->width;
+		if ( mid > ps->len )
+			mid = ps->len;
+		if ( stop > ps->len )
+			stop = ps->len;
+
+		/* Ties go to the lower run, keeping the sort stable. */
+		T *lower = ps->data + start, *endLower = ps->data + mid;
+		T *upper = ps->data + mid, *endUpper = ps->data + stop;
+		T *dest = ps->tmp + start;
+		while ( lower < endLower && upper < endUpper ) {
+			if ( cmp.compare( *lower, *upper ) <= 0 )
+				*dest++ = *lower++;
+			else
+				*dest++ = *upper++;
+		}
+		while ( lower < endLower )
+			*dest++ = *lower++;
+		while ( upper < endUpper )
+			*dest++ = *upper++;
+	}
+}
+
+template <class T, class Compare> void ParallelSort<T, Compare>::
+		sort( T *data, long len )
+{
+	int threads = workerThreads();
+	if ( threads <= 1 || len < _PS_SERIAL_THRESH ) {
+		MergeSort<T, Compare> mergeSort;
+		static_cast<Compare&>( mergeSort ) = cmp;
+		mergeSort.sort( data, len );
+		return;
+	}
+
+	this->data = data;
+	this->len = len;
+	this->width = ( len + threads - 1 ) / threads;
+
+	long numRuns = ( len + width - 1 ) / width;
+	parallelFor( numRuns, 1, &sortRuns, this );
+
+	T *storage = new T[len];
+	tmp = storage;
+	while ( width < len ) {
+		long numPairs = ( len + 2 * width - 1 ) / ( 2 * width );
+		parallelFor( numPairs, 1, &mergeRuns, this );
+
+		/* The merged runs are now in tmp. Swap for the next pass. */
+		T *t = this->data;
+		this->data = tmp;
+		tmp = t;
+		width *= 2;
+	}
+
+	if ( this->data != data )
+		memcpy( data, this->data, sizeof(T) * len );
+
+	delete[] storage;
+}
+
+#endif
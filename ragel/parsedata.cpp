@@ -33,6 +33,8 @@
 #include "xmlcodegen.h"
 #include "version.h"
 #include "inputdata.h"
+#include "nfagraph.h"
+#include "cdlazy.h"
 
 using namespace std;
 
@@ -79,6 +81,9 @@ void afterOpMinimize( FsmAp *fsm, bool lastInSeq )
 			case MinimizePartition2:
 				fsm->minimizePartition2();
 				break;
+			case MinimizePartitionParallel:
+				fsm->minimizePartitionParallel();
+				break;
 			case MinimizeStable:
 				fsm->minimizeStable();
 				break;
@@ -475,6 +480,7 @@ ParseData::ParseData( const char *fileName, char *sectionName,
 	nextEpsilonResolvedLink(0),
 	nextLongestMatchId(1),
 	lmRequiresErrorState(false),
+	sectionNfa(0),
 	cgd(0)
 {
 	/* Initialize the dictionary of graphs. This is our symbol table. The
@@ -1131,6 +1137,9 @@ FsmAp *ParseData::makeInstance( GraphDictEl *gdNode )
 			case MinimizePartition2:
 				graph->minimizePartition2();
 				break;
+			case MinimizePartitionParallel:
+				graph->minimizePartitionParallel();
+				break;
 		}
 	}
 
@@ -1227,6 +1236,30 @@ FsmAp *ParseData::makeAll()
 	return mainGraph;
 }
 
+NfaGraph *ParseData::makeLazy()
+{
+	if ( instanceList.length() != 1 ) {
+		error(sectionLoc) << "--lazy needs exactly one machine "
+				"instantiation" << endl;
+		return 0;
+	}
+
+	/* Names are still needed by the parts made deterministically. */
+	makeNameTree( 0 );
+	initNameWalk();
+	instanceList.head->value->resolveNameRefs( this );
+	resolveActionNameRefs();
+
+	GraphDictEl *instance = instanceList.head;
+	NfaGraph *nfa = new NfaGraph( instance->loc );
+
+	initNameWalk();
+	NfaFrag frag = instance->value->walkNfa( this, nfa );
+	nfa->startState = frag.start;
+	nfa->finalState = frag.end;
+	return nfa;
+}
+
 void ParseData::analyzeAction( Action *action, InlineList *inlineList )
 {
 	/* FIXME: Actions used as conditions should be very constrained. */
@@ -1412,6 +1445,13 @@ void ParseData::prepareMachineGenTBWrapped( GraphDictEl *graphDictEl )
 	makeRootNames();
 	initLongestMatchData();
 
+	if ( lazyDfa ) {
+		/* The graph is determinized when it runs. */
+		sectionNfa = makeLazy();
+		makeExports();
+		return;
+	}
+
 	/* Make the graph, do minimization. */
 	if ( graphDictEl == 0 )
 		sectionGraph = makeAll();
@@ -1453,7 +1493,23 @@ void ParseData::generateReduced( InputData &inputData )
 {
 	beginProcessing();
 
+	if ( lazyDfa ) {
+		cgd = new CLazyCodeGen( *inputData.outStream, sectionNfa );
+		cgd->sourceFileName = inputData.inputFileName;
+		cgd->fsmName = sectionName;
+		cgd->sectionLoc = sectionLoc;
+		cgd->setAlphType( keyOps->alphType->internalName );
+
+		if ( printStatistics ) {
+			cerr << "fsm name  : " << sectionName << endl;
+			cerr << "num nfa states: " << sectionNfa->states.length() << endl;
+			cerr << endl;
+		}
+		return;
+	}
+
 	cgd = makeCodeGen( inputData.inputFileName, sectionName, *inputData.outStream );
+	cgd->sectionLoc = sectionLoc;
 
 	/* Make the generator. */
 	BackendGen backendGen( sectionName, this, sectionGraph, cgd );
@@ -56,6 +56,7 @@ struct ReOrItem;
 struct LongestMatch;
 struct InputData;
 struct CodeGenData;
+struct NfaGraph;
 typedef DList<LongestMatch> LmList;
 
 
@@ -219,6 +220,9 @@ struct ParseData
 	FsmAp *makeSpecific( GraphDictEl *gdNode );
 	FsmAp *makeAll();
 
+	/* Make the nondeterministic graph of the instance, for --lazy. */
+	NfaGraph *makeLazy();
+
 	/* Checking the contents of actions. */
 	void checkAction( Action *action );
 	void checkInlineList( Action *act, InlineList *inlineList );
@@ -232,6 +236,7 @@ struct ParseData
 	void generateXML( ostream &out );
 	void generateReduced( InputData &inputData );
 	FsmAp *sectionGraph;
+	NfaGraph *sectionNfa;
 	bool generatingSectionSubset;
 
 	void initKeyOps();
@@ -29,6 +29,8 @@
 #include "dlist.h"
 
 struct NameInst;
+struct NfaGraph;
+struct NfaFrag;
 
 /* Types of builtin machines. */
 enum BuiltinMachine
@@ -227,6 +229,7 @@ struct VarDef
 	
 	/* Parse tree traversal. */
 	FsmAp *walk( ParseData *pd );
+	NfaFrag walkNfa( ParseData *pd, NfaGraph *nfa );
 	void makeNameTree( const InputLoc &loc, ParseData *pd );
 	void resolveNameRefs( ParseData *pd );
 
@@ -339,6 +342,7 @@ struct MachineDef
 		: join(0), longestMatch(0), lengthDef(lengthDef), type(LengthDefType) {}
 
 	FsmAp *walk( ParseData *pd );
+	NfaFrag walkNfa( ParseData *pd, NfaGraph *nfa );
 	void makeNameTree( ParseData *pd );
 	void resolveNameRefs( ParseData *pd );
 	
@@ -360,6 +364,7 @@ struct Join
 	/* Tree traversal. */
 	FsmAp *walk( ParseData *pd );
 	FsmAp *walkJoin( ParseData *pd );
+	NfaFrag walkNfa( ParseData *pd, NfaGraph *nfa );
 	void makeNameTree( ParseData *pd );
 	void resolveNameRefs( ParseData *pd );
 
@@ -401,6 +406,7 @@ struct Expression
 
 	/* Tree traversal. */
 	FsmAp *walk( ParseData *pd, bool lastInSeq = true );
+	NfaFrag walkNfa( ParseData *pd, NfaGraph *nfa );
 	void makeNameTree( ParseData *pd );
 	void resolveNameRefs( ParseData *pd );
 
@@ -438,6 +444,7 @@ struct Term
 	~Term();
 
 	FsmAp *walk( ParseData *pd, bool lastInSeq = true );
+	NfaFrag walkNfa( ParseData *pd, NfaGraph *nfa );
 	void makeNameTree( ParseData *pd );
 	void resolveNameRefs( ParseData *pd );
 
@@ -459,6 +466,7 @@ struct FactorWithAug
 
 	/* Tree traversal. */
 	FsmAp *walk( ParseData *pd );
+	NfaFrag walkNfa( ParseData *pd, NfaGraph *nfa );
 	void makeNameTree( ParseData *pd );
 	void resolveNameRefs( ParseData *pd );
 
@@ -507,6 +515,7 @@ struct FactorWithRep
 
 	/* Tree traversal. */
 	FsmAp *walk( ParseData *pd );
+	NfaFrag walkNfa( ParseData *pd, NfaGraph *nfa );
 	void makeNameTree( ParseData *pd );
 	void resolveNameRefs( ParseData *pd );
 
@@ -539,6 +548,7 @@ struct FactorWithNeg
 
 	/* Tree traversal. */
 	FsmAp *walk( ParseData *pd );
+	NfaFrag walkNfa( ParseData *pd, NfaGraph *nfa );
 	void makeNameTree( ParseData *pd );
 	void resolveNameRefs( ParseData *pd );
 
@@ -597,6 +607,7 @@ struct Factor
 
 	/* Tree traversal. */
 	FsmAp *walk( ParseData *pd );
+	NfaFrag walkNfa( ParseData *pd, NfaGraph *nfa );
 	void makeNameTree( ParseData *pd );
 	void resolveNameRefs( ParseData *pd );
 
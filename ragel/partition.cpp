@@ -0,0 +1,542 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "partition.h"
+#include "mergesort.h"
+
+/* Stop coarsening at this many vertices per part. */
+#define _PG_COARSEST 16
+
+/* Parts may be this many percent heavier than the average. */
+#define _PG_IMBALANCE 5
+
+/* Most refinement passes at each level. */
+#define _PG_PASSES 8
+
+/* A Fiduccia-Mattheyses pass ends after this many moves without a gain. */
+#define _PG_FM_STALL 64
+
+PartitionGraph::PartitionGraph( int numVerts )
+:
+	numVerts(numVerts),
+	adjStart(0),
+	adj(0),
+	adjWeight(0)
+{
+	vertWeight = new long[numVerts];
+	for ( int v = 0; v < numVerts; v++ )
+		vertWeight[v] = 1;
+}
+
+PartitionGraph::~PartitionGraph()
+{
+	delete[] vertWeight;
+	delete[] adjStart;
+	delete[] adj;
+	delete[] adjWeight;
+}
+
+void PartitionGraph::addEdge( int v1, int v2, long weight )
+{
+	if ( v1 == v2 )
+		return;
+
+	PartitionEdge edge;
+	edge.v1 = v1;
+	edge.v2 = v2;
+	edge.weight = weight;
+	edges.append( edge );
+
+	edge.v1 = v2;
+	edge.v2 = v1;
+	edges.append( edge );
+}
+
+struct CmpPartitionEdge
+{
+	static int compare( const PartitionEdge &e1, const PartitionEdge &e2 )
+	{
+		if ( e1.v1 < e2.v1 )
+			return -1;
+		else if ( e1.v1 > e2.v1 )
+			return 1;
+		else if ( e1.v2 < e2.v2 )
+			return -1;
+		else if ( e1.v2 > e2.v2 )
+			return 1;
+		else
+			return 0;
+	}
+};
+
+void PartitionGraph::finish()
+{
+	MergeSort<PartitionEdge, CmpPartitionEdge> mergeSort;
+	mergeSort.sort( edges.data, edges.length() );
+
+	/* Sum up the duplicates in place. */
+	int numAdj = 0;
+	for ( int e = 0; e < edges.length(); e++ ) {
+		if ( numAdj > 0 && CmpPartitionEdge::compare(
+				edges[numAdj-1], edges[e] ) == 0 )
+			edges[numAdj-1].weight += edges[e].weight;
+		else
+			edges[numAdj++] = edges[e];
+	}
+
+	adjStart = new int[numVerts+1];
+	adj = new int[numAdj];
+	adjWeight = new long[numAdj];
+
+	int e = 0;
+	for ( int v = 0; v < numVerts; v++ ) {
+		adjStart[v] = e;
+		while ( e < numAdj && edges[e].v1 == v ) {
+			adj[e] = edges[e].v2;
+			adjWeight[e] = edges[e].weight;
+			e += 1;
+		}
+	}
+	adjStart[numVerts] = e;
+
+	edges.empty();
+}
+
+/* Join each vertex with the unjoined neighbour it has the heaviest edge to,
+ * keeping joined vertices under maxWeight. Numbers the coarse vertices in
+ * the order of the vertices they come from. */
+static PartitionGraph *coarsen( PartitionGraph &graph, long maxWeight, int *map )
+{
+	int *match = new int[graph.numVerts];
+	for ( int v = 0; v < graph.numVerts; v++ )
+		match[v] = -1;
+
+	int numCoarse = 0;
+	for ( int v = 0; v < graph.numVerts; v++ ) {
+		if ( match[v] >= 0 )
+			continue;
+
+		int best = -1;
+		long bestWeight = 0;
+		for ( int e = graph.adjStart[v]; e < graph.adjStart[v+1]; e++ ) {
+			int u = graph.adj[e];
+			if ( match[u] < 0 && graph.adjWeight[e] > bestWeight &&
+					graph.vertWeight[v] + graph.vertWeight[u] <= maxWeight )
+			{
+				best = u;
+				bestWeight = graph.adjWeight[e];
+			}
+		}
+
+		map[v] = numCoarse;
+		match[v] = v;
+		if ( best >= 0 ) {
+			map[best] = numCoarse;
+			match[v] = best;
+			match[best] = v;
+		}
+		numCoarse += 1;
+	}
+
+	PartitionGraph *coarse = new PartitionGraph( numCoarse );
+	for ( int c = 0; c < numCoarse; c++ )
+		coarse->vertWeight[c] = 0;
+
+	for ( int v = 0; v < graph.numVerts; v++ ) {
+		coarse->vertWeight[map[v]] += graph.vertWeight[v];
+
+		/* Edges are listed at both ends, so take each from one end only. */
+		for ( int e = graph.adjStart[v]; e < graph.adjStart[v+1]; e++ ) {
+			if ( v < graph.adj[e] ) {
+				coarse->addEdge( map[v], map[graph.adj[e]],
+						graph.adjWeight[e] );
+			}
+		}
+	}
+	coarse->finish();
+
+	delete[] match;
+	return coarse;
+}
+
+/* A vertex waiting to move, keyed by the gain of its best move. Entries are
+ * left in the heap when the vertex changes, stamp tells which are current. */
+struct PartitionMove
+{
+	long gain;
+	int v;
+	int stamp;
+};
+
+/* A move made by a Fiduccia-Mattheyses pass. */
+struct PartitionUndo
+{
+	int v, from;
+};
+
+/* Heap of moves with the largest gain on top, lowest vertex first on ties. */
+struct PartitionHeap
+{
+	static bool above( const PartitionMove &m1, const PartitionMove &m2 )
+	{
+		return m1.gain > m2.gain || ( m1.gain == m2.gain && m1.v < m2.v );
+	}
+
+	void push( const PartitionMove &move );
+	PartitionMove pop();
+
+	Vector<PartitionMove> moves;
+};
+
+void PartitionHeap::push( const PartitionMove &move )
+{
+	int pos = moves.length();
+	moves.append( move );
+	while ( pos > 0 && above( moves[pos], moves[(pos-1)/2] ) ) {
+		PartitionMove tmp = moves[pos];
+		moves[pos] = moves[(pos-1)/2];
+		moves[(pos-1)/2] = tmp;
+		pos = (pos-1)/2;
+	}
+}
+
+PartitionMove PartitionHeap::pop()
+{
+	PartitionMove top = moves[0];
+	moves[0] = moves[moves.length()-1];
+	moves.remove( moves.length()-1 );
+
+	int pos = 0;
+	while ( true ) {
+		int child = 2 * pos + 1;
+		if ( child >= moves.length() )
+			break;
+		if ( child + 1 < moves.length() && above( moves[child+1], moves[child] ) )
+			child += 1;
+		if ( !above( moves[child], moves[pos] ) )
+			break;
+
+		PartitionMove tmp = moves[pos];
+		moves[pos] = moves[child];
+		moves[child] = tmp;
+		pos = child;
+	}
+	return top;
+}
+
+/* Improves the parts of one graph. */
+struct PartitionRefine
+{
+	PartitionRefine( PartitionGraph &graph, int nParts, long maxWeight, int *part );
+	~PartitionRefine();
+
+	bool bestMove( int v, bool helpsOnly, int &to, long &gain );
+	void move( int v, int to );
+	bool greedyPass();
+	bool fmPass();
+
+	PartitionGraph &graph;
+	int nParts;
+	long maxWeight;
+	int *part;
+
+	long *partWeight;
+	int *partVerts;
+	long *conn;
+	int *touched;
+};
+
+PartitionRefine::PartitionRefine( PartitionGraph &graph, int nParts, 
+		long maxWeight, int *part )
+:
+	graph(graph),
+	nParts(nParts),
+	maxWeight(maxWeight),
+	part(part)
+{
+	partWeight = new long[nParts];
+	partVerts = new int[nParts];
+	conn = new long[nParts];
+	touched = new int[nParts];
+	for ( int p = 0; p < nParts; p++ ) {
+		partWeight[p] = 0;
+		partVerts[p] = 0;
+		conn[p] = -1;
+	}
+
+	for ( int v = 0; v < graph.numVerts; v++ ) {
+		partWeight[part[v]] += graph.vertWeight[v];
+		partVerts[part[v]] += 1;
+	}
+}
+
+PartitionRefine::~PartitionRefine()
+{
+	delete[] partWeight;
+	delete[] partVerts;
+	delete[] conn;
+	delete[] touched;
+}
+
+/* Find the neighbouring part that v has the most edge weight to, leaving out
+ * parts it would make heavier than maxWeight. The gain is the drop in the
+ * weight of the edges between parts, which may be negative. Ties go to the
+ * lighter part. With helpsOnly, a move must cut the weight between parts,
+ * or keep it while evening out the parts, unless v's part is over
+ * maxWeight. */
+bool PartitionRefine::bestMove( int v, bool helpsOnly, int &to, long &gain )
+{
+	int from = part[v];
+	long weight = graph.vertWeight[v];
+
+	/* Every part keeps at least one vertex. */
+	if ( partVerts[from] == 1 )
+		return false;
+
+	/* Add up the edge weight to each neighbouring part. */
+	int numTouched = 0;
+	conn[from] = 0;
+	touched[numTouched++] = from;
+	for ( int e = graph.adjStart[v]; e < graph.adjStart[v+1]; e++ ) {
+		int p = part[graph.adj[e]];
+		if ( conn[p] < 0 ) {
+			conn[p] = 0;
+			touched[numTouched++] = p;
+		}
+		conn[p] += graph.adjWeight[e];
+	}
+
+	bool over = partWeight[from] > maxWeight;
+	int best = -1;
+	long bestGain = 0;
+	for ( int t = 1; t < numTouched; t++ ) {
+		int cand = touched[t];
+		long candGain = conn[cand] - conn[from];
+		if ( partWeight[cand] + weight > maxWeight )
+			continue;
+
+		bool take;
+		if ( best < 0 ) {
+			take = !helpsOnly || candGain > 0 || over || ( candGain == 0 &&
+					partWeight[cand] + weight < partWeight[from] );
+		}
+		else {
+			take = candGain > bestGain || ( candGain == bestGain &&
+					partWeight[cand] < partWeight[best] );
+		}
+
+		if ( take ) {
+			best = cand;
+			bestGain = candGain;
+		}
+	}
+
+	for ( int t = 0; t < numTouched; t++ )
+		conn[touched[t]] = -1;
+
+	to = best;
+	gain = bestGain;
+	return best >= 0;
+}
+
+void PartitionRefine::move( int v, int to )
+{
+	int from = part[v];
+	part[v] = to;
+	partWeight[from] -= graph.vertWeight[v];
+	partVerts[from] -= 1;
+	partWeight[to] += graph.vertWeight[v];
+	partVerts[to] += 1;
+}
+
+/* Take every move that helps, going through the vertices in order. This
+ * also brings parts over maxWeight back under. */
+bool PartitionRefine::greedyPass()
+{
+	int moves = 0;
+	for ( int v = 0; v < graph.numVerts; v++ ) {
+		int to;
+		long gain;
+		if ( bestMove( v, true, to, gain ) ) {
+			move( v, to );
+			moves += 1;
+		}
+	}
+	return moves > 0;
+}
+
+/* Fiduccia-Mattheyses pass. Moves the vertex with the best gain, losing
+ * moves included, and locks it in place, until a run of moves brings no
+ * improvement. Then goes back to the best point seen. */
+bool PartitionRefine::fmPass()
+{
+	bool *locked = new bool[graph.numVerts];
+	int *stamp = new int[graph.numVerts];
+	PartitionHeap heap;
+
+	for ( int v = 0; v < graph.numVerts; v++ ) {
+		locked[v] = false;
+		stamp[v] = 0;
+
+		int to;
+		PartitionMove pm;
+		if ( bestMove( v, false, to, pm.gain ) ) {
+			pm.v = v;
+			pm.stamp = 0;
+			heap.push( pm );
+		}
+	}
+
+	Vector<PartitionUndo> undo;
+	long total = 0, bestTotal = 0;
+	int bestLen = 0;
+	while ( heap.moves.length() > 0 && 
+			undo.length() - bestLen < _PG_FM_STALL )
+	{
+		PartitionMove pm = heap.pop();
+		if ( locked[pm.v] || pm.stamp != stamp[pm.v] )
+			continue;
+
+		/* The parts may have changed weight since the move was queued. */
+		int to;
+		long gain;
+		if ( !bestMove( pm.v, false, to, gain ) )
+			continue;
+		if ( gain < pm.gain ) {
+			pm.gain = gain;
+			pm.stamp = ++stamp[pm.v];
+			heap.push( pm );
+			continue;
+		}
+
+		/* Remember where the vertex came from. */
+		PartitionUndo back;
+		back.v = pm.v;
+		back.from = part[pm.v];
+		undo.append( back );
+
+		move( pm.v, to );
+		locked[pm.v] = true;
+		total += gain;
+		if ( total > bestTotal ) {
+			bestTotal = total;
+			bestLen = undo.length();
+		}
+
+		/* The moves of the neighbours have changed. */
+		for ( int e = graph.adjStart[pm.v]; e < graph.adjStart[pm.v+1]; e++ ) {
+			int u = graph.adj[e];
+			if ( locked[u] )
+				continue;
+
+			PartitionMove um;
+			um.stamp = ++stamp[u];
+			if ( bestMove( u, false, to, um.gain ) ) {
+				um.v = u;
+				heap.push( um );
+			}
+		}
+	}
+
+	/* Undo the moves past the best point. */
+	for ( int m = undo.length() - 1; m >= bestLen; m-- )
+		move( undo[m].v, undo[m].from );
+
+	delete[] locked;
+	delete[] stamp;
+	return bestTotal > 0;
+}
+
+static void refine( PartitionGraph &graph, int nParts, long maxWeight, int *part )
+{
+	PartitionRefine refine( graph, nParts, maxWeight, part );
+	for ( int pass = 0; pass < _PG_PASSES; pass++ ) {
+		if ( !refine.greedyPass() )
+			break;
+	}
+	for ( int pass = 0; pass < _PG_PASSES; pass++ ) {
+		if ( !refine.fmPass() )
+			break;
+	}
+}
+
+void partitionGraph( PartitionGraph &graph, int nParts, int *part )
+{
+	long total = 0;
+	for ( int v = 0; v < graph.numVerts; v++ )
+		total += graph.vertWeight[v];
+
+	if ( nParts <= 1 || total == 0 ) {
+		for ( int v = 0; v < graph.numVerts; v++ )
+			part[v] = 0;
+		return;
+	}
+
+	long maxWeight = total / nParts + total * _PG_IMBALANCE / ( 100 * nParts ) + 1;
+
+	/* Coarsen until the graph is small or stops shrinking. Vertices are not
+	 * joined past a quarter of a part, so the coarsest graph can still be
+	 * split evenly. */
+	Vector<PartitionGraph*> levels;
+	Vector<int*> maps;
+	PartitionGraph *cur = &graph;
+	while ( cur->numVerts > _PG_COARSEST * nParts ) {
+		int *map = new int[cur->numVerts];
+		PartitionGraph *coarse = coarsen( *cur, total / ( 4 * nParts ) + 1, map );
+		if ( coarse->numVerts > cur->numVerts - cur->numVerts / 10 ) {
+			delete coarse;
+			delete[] map;
+			break;
+		}
+
+		levels.append( coarse );
+		maps.append( map );
+		cur = coarse;
+	}
+
+	/* Split the coarsest graph into runs of even weight, putting each vertex
+	 * in the part its middle falls in. */
+	int *curPart = new int[cur->numVerts];
+	long before = 0;
+	for ( int v = 0; v < cur->numVerts; v++ ) {
+		long middle = before + cur->vertWeight[v] / 2;
+		curPart[v] = (int)( (double)middle * nParts / total );
+		if ( curPart[v] >= nParts )
+			curPart[v] = nParts - 1;
+		before += cur->vertWeight[v];
+	}
+	refine( *cur, nParts, maxWeight, curPart );
+
+	/* Carry the parts back to each finer graph and refine there. */
+	for ( int l = levels.length() - 1; l >= 0; l-- ) {
+		PartitionGraph *fine = l > 0 ? levels[l-1] : &graph;
+		int *finePart = new int[fine->numVerts];
+		for ( int v = 0; v < fine->numVerts; v++ )
+			finePart[v] = curPart[maps[l][v]];
+
+		delete[] curPart;
+		curPart = finePart;
+		refine( *fine, nParts, maxWeight, curPart );
+
+		delete levels[l];
+		delete[] maps[l];
+	}
+
+	for ( int v = 0; v < graph.numVerts; v++ )
+		part[v] = curPart[v];
+	delete[] curPart;
+}
@@ -0,0 +1,61 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _PARTITION_H
+#define _PARTITION_H
+
+#include "vector.h"
+
+struct PartitionEdge
+{
+	int v1, v2;
+	long weight;
+};
+
+/* Undirected graph with weighted vertices and edges. Edges are collected with
+ * addEdge, then finish lays them out by vertex. */
+struct PartitionGraph
+{
+	PartitionGraph( int numVerts );
+	~PartitionGraph();
+
+	/* Edges between the same pair of vertices are added together. Loops are
+	 * dropped. */
+	void addEdge( int v1, int v2, long weight );
+	void finish();
+
+	int numVerts;
+	long *vertWeight;
+
+	/* The edges of vertex v are adj[adjStart[v]] up to adj[adjStart[v+1]].
+	 * Every edge is listed at both of its ends. */
+	int *adjStart;
+	int *adj;
+	long *adjWeight;
+
+	Vector<PartitionEdge> edges;
+};
+
+/* Split the vertices into nParts parts of about the same weight, keeping down
+ * the weight of the edges between parts. The graph is coarsened by joining
+ * the ends of heavy edges, the coarsest graph is split in vertex order, then
+ * the split is refined with Fiduccia-Mattheyses moves at each level on the
+ * way back. Vertices close in the order tend to share a part. The part of
+ * each vertex is written to part. */
+void partitionGraph( PartitionGraph &graph, int nParts, int *part );
+
+#endif
@@ -0,0 +1,128 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ * 
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA 
+ */
+
+#include <string.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include "ragel.h"
+#include "profile.h"
+
+using std::ifstream;
+using std::istringstream;
+using std::string;
+using std::endl;
+
+/* Counts for all machines in the profile file. */
+ProfileMachineList profileMachines;
+
+static bool endOfRecord( istringstream &fields )
+{
+	string extra;
+	return fields && !( fields >> extra );
+}
+
+void readProfile( const char *fileName )
+{
+	ifstream in( fileName );
+	if ( ! in.is_open() ) {
+		error() << "could not open " << fileName << " for reading" << endl;
+		return;
+	}
+
+	InputLoc loc;
+	loc.fileName = fileName;
+	loc.line = 0;
+	loc.col = 1;
+
+	ProfileMachine *machine = 0;
+	string line;
+	while ( getline( in, line ) ) {
+		loc.line += 1;
+
+		/* Strip comments. */
+		string::size_type hash = line.find( '#' );
+		if ( hash != string::npos )
+			line.erase( hash );
+
+		istringstream fields( line );
+		string kind;
+		if ( ! ( fields >> kind ) )
+			continue;
+
+		if ( kind == "machine" ) {
+			string name;
+			fields >> name;
+			if ( ! endOfRecord( fields ) ) {
+				error( loc ) << "expecting a machine name" << endl;
+				continue;
+			}
+
+			/* Sections for the same machine add up. */
+			machine = findProfile( name.c_str() );
+			if ( machine == 0 ) {
+				char *copy = new char[name.size()+1];
+				strcpy( copy, name.c_str() );
+				machine = new ProfileMachine( copy );
+				profileMachines.append( machine );
+			}
+		}
+		else if ( kind == "state" || kind == "trans" ) {
+			if ( machine == 0 ) {
+				error( loc ) << kind << " record before any machine record" << endl;
+				continue;
+			}
+
+			if ( kind == "state" ) {
+				ProfileState state;
+				fields >> state.id >> state.hits;
+				if ( ! endOfRecord( fields ) )
+					error( loc ) << "expecting a state id and a count" << endl;
+				else
+					machine->states.append( state );
+			}
+			else {
+				ProfileTrans trans;
+				fields >> trans.id >> trans.lowKey >> trans.highKey >> trans.hits;
+				if ( ! endOfRecord( fields ) || trans.lowKey > trans.highKey ) {
+					error( loc ) << "expecting a state id, a key range "
+							"and a count" << endl;
+				}
+				else {
+					machine->trans.append( trans );
+				}
+			}
+		}
+		else {
+			error( loc ) << "unknown profile record \"" << kind << "\"" << endl;
+		}
+	}
+}
+
+ProfileMachine *findProfile( const char *fsmName )
+{
+	if ( fsmName == 0 )
+		return 0;
+
+	for ( ProfileMachine *machine = profileMachines.head; machine != 0; 
+			machine = machine->next )
+	{
+		if ( strcmp( machine->name, fsmName ) == 0 )
+			return machine;
+	}
+	return 0;
+}
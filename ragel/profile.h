@@ -0,0 +1,73 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ * 
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ * 
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA 
+ */
+
+#ifndef _PROFILE_H
+#define _PROFILE_H
+
+#include "vector.h"
+#include "dlist.h"
+
+/*
+ * Hit counts read with --profile-use. The file is text, one record per line,
+ * with blank lines and everything after a # ignored:
+ *
+ *   machine <name>
+ *   state <id> <hits>
+ *   trans <id> <low key> <high key> <hits>
+ *
+ * State records give the number of times the state with the given id was
+ * entered. Trans records give the number of times the state took a
+ * transition on a key in [low, high]. Records belong to the machine named
+ * last. State ids are those written by a build without --profile-use, and
+ * keys are the values the state matches on, which for states with
+ * conditions are the wide keys.
+ */
+
+struct ProfileState
+{
+	long id;
+	unsigned long long hits;
+};
+
+struct ProfileTrans
+{
+	long id;
+	long long lowKey, highKey;
+	unsigned long long hits;
+};
+
+struct ProfileMachine
+{
+	ProfileMachine( char *name ) : name(name) {}
+
+	char *name;
+	Vector<ProfileState> states;
+	Vector<ProfileTrans> trans;
+
+	ProfileMachine *prev, *next;
+};
+
+typedef DList<ProfileMachine> ProfileMachineList;
+
+/* Read the profile file into the machine list, reporting any errors. */
+void readProfile( const char *fileName );
+
+/* Find the recorded counts for the named machine. Returns null when there
+ * are none. */
+ProfileMachine *findProfile( const char *fsmName );
+
+#endif
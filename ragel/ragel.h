@@ -37,11 +37,17 @@ enum CodeStyle
 {
 	GenTables,
 	GenFTables,
+	GenCombTables,
 	GenFlat,
 	GenFFlat,
+	GenClassFlat,
+	GenDenseFlat,
 	GenGoto,
 	GenFGoto,
 	GenIpGoto,
+	GenComputedGoto,
+	GenTailCall,
+	GenHybrid,
 	GenSplit
 };
 
@@ -50,7 +56,8 @@ enum MinimizeLevel {
 	MinimizeApprox,
 	MinimizeStable,
 	MinimizePartition1,
-	MinimizePartition2
+	MinimizePartition2,
+	MinimizePartitionParallel
 };
 
 enum MinimizeOpt {
@@ -60,6 +67,15 @@ enum MinimizeOpt {
 	MinimizeEveryOp
 };
 
+/* How the generated code orders the states. The default keeps the ids given
+ * by the frontend for table styles and orders goto styles depth first. */
+enum StateOrder {
+	StateOrderDefault,
+	StateOrderDfs,
+	StateOrderBfs,
+	StateOrderAffinity
+};
+
 /* Target implementation */
 enum RubyImplEnum
 {
@@ -70,10 +86,26 @@ enum RubyImplEnum
 /* Options. */
 extern MinimizeLevel minimizeLevel;
 extern MinimizeOpt minimizeOpt;
+extern int numThreads;
+extern bool determinizeParallel;
+extern bool condGuards;
+extern long denseLimit;
+extern bool skipLoops;
+extern bool prefilter;
+extern bool rangeBitmaps;
+extern int switchDensity;
+extern const char *profileUseFile;
+extern bool instrument;
+extern StateOrder stateOrder;
+extern bool lazyDfa;
+extern long lazyStates;
+extern long partitionSize;
 extern const char *machineSpec, *machineName;
 extern bool printStatistics;
 extern bool wantDupsRemoved;
 extern bool generateDot;
+extern bool generateBlob;
+extern bool constexprTables;
 extern bool generateXML;
 extern RubyImplEnum rubyImpl;
 
@@ -20,10 +20,13 @@
  */
 
 #include "redfsm.h"
+#include "profile.h"
+#include "partition.h"
 #include "avlmap.h"
 #include "mergesort.h"
 #include <iostream>
 #include <sstream>
+#include <limits.h>
 
 using std::ostringstream;
 
@@ -48,6 +51,7 @@ RedFsmAp::RedFsmAp()
 	errTrans(0),
 	firstFinState(0),
 	numFinStates(0),
+	profiled(false),
 	bAnyToStateActions(false),
 	bAnyFromStateActions(false),
 	bAnyRegActions(false),
@@ -62,10 +66,25 @@ RedFsmAp::RedFsmAp()
 	bAnyRegNextStmt(false),
 	bAnyRegCurStateRef(false),
 	bAnyRegBreak(false),
-	bAnyConditions(false)
+	bAnyConditions(false),
+	classMap(0),
+	classMapLen(0),
+	numClasses(0),
+	combNext(0),
+	combCheck(0),
+	combLen(0),
+	maxCombBase(0),
+	denseTrans(0),
+	denseSpan(0),
+	maxHybridIndex(0)
 {
 }
 
+RedFsmAp::~RedFsmAp()
+{
+	delete[] classMap;
+}
+
 /* Does the machine have any actions. */
 bool RedFsmAp::anyActions()
 {
@@ -117,6 +136,401 @@ void RedFsmAp::depthFirstOrdering()
 	assert( stateListLen == stateList.length() );
 }
 
+void RedFsmAp::breadthFirstOrdering()
+{
+	/* Init on state list flags. */
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ )
+		st->onStateList = false;
+	
+	/* Clear out the state list, we will rebuild it. */
+	int stateListLen = stateList.length();
+	stateList.abandon();
+
+	Vector<RedStateAp*> roots;
+	if ( startState != 0 )
+		roots.append( startState );
+	for ( RedStateSet::Iter en = entryPoints; en.lte(); en++ )
+		roots.append( *en );
+	if ( forcedErrorState )
+		roots.append( errState );
+
+	/* The state list serves as the queue. States up to and including expand
+	 * have had their targets added. */
+	RedStateAp *expand = 0;
+	for ( Vector<RedStateAp*>::Iter root = roots; root.lte(); root++ ) {
+		if ( ! (*root)->onStateList ) {
+			(*root)->onStateList = true;
+			stateList.append( *root );
+		}
+
+		RedStateAp *next = expand == 0 ? stateList.head : expand->next;
+		while ( next != 0 ) {
+			expand = next;
+
+			/* At this point transitions should only be in ranges. */
+			assert( expand->outSingle.length() == 0 );
+			assert( expand->defTrans == 0 );
+
+			for ( RedTransList::Iter rtel = expand->outRange; rtel.lte(); rtel++ ) {
+				RedStateAp *targ = rtel->value->targ;
+				if ( targ != 0 && ! targ->onStateList ) {
+					targ->onStateList = true;
+					stateList.append( targ );
+				}
+			}
+			next = expand->next;
+		}
+	}
+
+	/* Make sure we put everything back on. */
+	assert( stateListLen == stateList.length() );
+}
+
+/* Connection between two states, by state id with id1 < id2. */
+struct RedAffinity
+{
+	int id1, id2;
+	double weight;
+};
+
+struct CmpRedAffinityIds
+{
+	static int compare( const RedAffinity &a1, const RedAffinity &a2 )
+	{
+		if ( a1.id1 < a2.id1 )
+			return -1;
+		else if ( a1.id1 > a2.id1 )
+			return 1;
+		else if ( a1.id2 < a2.id2 )
+			return -1;
+		else if ( a1.id2 > a2.id2 )
+			return 1;
+		else
+			return 0;
+	}
+};
+
+struct CmpRedAffinityWeight
+{
+	static int compare( const RedAffinity &a1, const RedAffinity &a2 )
+	{
+		if ( a1.weight > a2.weight )
+			return -1;
+		else if ( a1.weight < a2.weight )
+			return 1;
+		else
+			return 0;
+	}
+};
+
+static int affinityChain( int *chain, int id )
+{
+	while ( chain[id] != id ) {
+		chain[id] = chain[chain[id]];
+		id = chain[id];
+	}
+	return id;
+}
+
+void RedFsmAp::affinityOrdering()
+{
+	/* The chains are laid out in the order their first state is found by the
+	 * depth first ordering. */
+	if ( profiled )
+		profileOrdering();
+	else
+		depthFirstOrdering();
+
+	/* Weigh the connections in each direction. Loops back to the same state
+	 * do not place it anywhere. */
+	Vector<RedAffinity> conns;
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
+		double total = 0;
+		for ( RedTransList::Iter rtel = st->outRange; rtel.lte(); rtel++ ) {
+			RedStateAp *targ = rtel->value->targ;
+			if ( targ != 0 && targ != st ) {
+				total += profiled ? (double)rtel->hits : 
+						(double)rtel->highKey.getLongLong() - 
+						(double)rtel->lowKey.getLongLong() + 1;
+			}
+		}
+
+		if ( total == 0 )
+			continue;
+
+		for ( RedTransList::Iter rtel = st->outRange; rtel.lte(); rtel++ ) {
+			RedStateAp *targ = rtel->value->targ;
+			if ( targ != 0 && targ != st ) {
+				RedAffinity conn;
+				conn.id1 = st->id < targ->id ? st->id : targ->id;
+				conn.id2 = st->id < targ->id ? targ->id : st->id;
+
+				/* Without a profile, count the share of the state's keys. */
+				conn.weight = profiled ? (double)rtel->hits : 
+						( (double)rtel->highKey.getLongLong() - 
+						(double)rtel->lowKey.getLongLong() + 1 ) / total;
+				if ( conn.weight > 0 )
+					conns.append( conn );
+			}
+		}
+	}
+
+	/* Add up the weights of connections between the same pair, then take
+	 * the heaviest first. */
+	MergeSort<RedAffinity, CmpRedAffinityIds> idSort;
+	idSort.sort( conns.data, conns.length() );
+
+	Vector<RedAffinity> pairs;
+	for ( Vector<RedAffinity>::Iter conn = conns; conn.lte(); conn++ ) {
+		if ( pairs.length() > 0 && CmpRedAffinityIds::compare( 
+				pairs[pairs.length()-1], *conn ) == 0 )
+			pairs[pairs.length()-1].weight += conn->weight;
+		else
+			pairs.append( *conn );
+	}
+
+	MergeSort<RedAffinity, CmpRedAffinityWeight> weightSort;
+	weightSort.sort( pairs.data, pairs.length() );
+
+	/* Join the pairs end to end. A state inside a chain already has both of
+	 * its neighbours. */
+	int *chainNext = new int[nextStateId];
+	int *chainPrev = new int[nextStateId];
+	int *chain = new int[nextStateId];
+	for ( int id = 0; id < nextStateId; id++ ) {
+		chainNext[id] = chainPrev[id] = -1;
+		chain[id] = id;
+	}
+
+	for ( Vector<RedAffinity>::Iter pair = pairs; pair.lte(); pair++ ) {
+		int c1 = affinityChain( chain, pair->id1 );
+		int c2 = affinityChain( chain, pair->id2 );
+		if ( c1 == c2 )
+			continue;
+
+		if ( chainNext[pair->id1] < 0 && chainPrev[pair->id2] < 0 ) {
+			chainNext[pair->id1] = pair->id2;
+			chainPrev[pair->id2] = pair->id1;
+		}
+		else if ( chainNext[pair->id2] < 0 && chainPrev[pair->id1] < 0 ) {
+			chainNext[pair->id2] = pair->id1;
+			chainPrev[pair->id1] = pair->id2;
+		}
+		else {
+			continue;
+		}
+
+		chain[c2] = c1;
+	}
+
+	/* Lay out each chain from its head. */
+	RedStateAp **byId = new RedStateAp*[nextStateId];
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
+		byId[st->id] = st;
+		st->onStateList = false;
+	}
+
+	int stateListLen = stateList.length();
+	Vector<RedStateAp*> order;
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
+		if ( st->onStateList )
+			continue;
+
+		int id = st->id;
+		while ( chainPrev[id] >= 0 )
+			id = chainPrev[id];
+
+		for ( ; id >= 0; id = chainNext[id] ) {
+			byId[id]->onStateList = true;
+			order.append( byId[id] );
+		}
+	}
+
+	stateList.abandon();
+	for ( Vector<RedStateAp*>::Iter st = order; st.lte(); st++ )
+		stateList.append( *st );
+
+	/* Make sure we put everything back on. */
+	assert( stateListLen == stateList.length() );
+
+	delete[] chainNext;
+	delete[] chainPrev;
+	delete[] chain;
+	delete[] byId;
+}
+
+bool RedFsmAp::applyProfile( ProfileMachine *profile )
+{
+	/* Locate the states by id. */
+	RedStateAp **byId = new RedStateAp*[nextStateId];
+	memset( byId, 0, sizeof(RedStateAp*) * nextStateId );
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
+		if ( 0 <= st->id && st->id < nextStateId )
+			byId[st->id] = st;
+	}
+
+	bool matches = true;
+	for ( Vector<ProfileState>::Iter ps = profile->states; ps.lte(); ps++ ) {
+		if ( ps->id < 0 || ps->id >= nextStateId || byId[ps->id] == 0 )
+			matches = false;
+		else
+			byId[ps->id]->hits += ps->hits;
+	}
+
+	for ( Vector<ProfileTrans>::Iter pt = profile->trans; pt.lte(); pt++ ) {
+		if ( pt->id < 0 || pt->id >= nextStateId || byId[pt->id] == 0 ) {
+			matches = false;
+			continue;
+		}
+
+		/* Credit every range the recorded keys fall in. */
+		bool found = false;
+		RedStateAp *state = byId[pt->id];
+		for ( RedTransList::Iter rtel = state->outRange; rtel.lte(); rtel++ ) {
+			if ( rtel->lowKey.getLongLong() <= pt->highKey && 
+					pt->lowKey <= rtel->highKey.getLongLong() )
+			{
+				rtel->hits += pt->hits;
+				found = true;
+			}
+		}
+
+		if ( !found )
+			matches = false;
+	}
+
+	delete[] byId;
+	profiled = true;
+	return matches;
+}
+
+struct CmpRedTransElHits
+{
+	static int compare( RedTransEl *el1, RedTransEl *el2 )
+	{
+		if ( el1->hits > el2->hits )
+			return -1;
+		else if ( el1->hits < el2->hits )
+			return 1;
+		else
+			return 0;
+	}
+};
+
+void RedFsmAp::profileOrdering( RedStateAp *state )
+{
+	/* Nothing to do if the state is already on the list. */
+	if ( state->onStateList )
+		return;
+
+	/* Doing depth first, put state on the list. */
+	state->onStateList = true;
+	stateList.append( state );
+
+	/* Visit the targets of the hottest ranges first, so the hot paths run
+	 * through neighbouring states. */
+	int numRanges = state->outRange.length();
+	RedTransEl **ranges = new RedTransEl*[numRanges];
+	for ( int r = 0; r < numRanges; r++ )
+		ranges[r] = state->outRange.data + r;
+
+	MergeSort<RedTransEl*, CmpRedTransElHits> mergeSort;
+	mergeSort.sort( ranges, numRanges );
+
+	for ( int r = 0; r < numRanges; r++ ) {
+		if ( ranges[r]->value->targ != 0 )
+			profileOrdering( ranges[r]->value->targ );
+	}
+
+	delete[] ranges;
+}
+
+void RedFsmAp::profileOrdering()
+{
+	/* Init on state list flags. */
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ )
+		st->onStateList = false;
+	
+	/* Clear out the state list, we will rebuild it. */
+	int stateListLen = stateList.length();
+	stateList.abandon();
+
+	/* Add back to the state list from the start state and all other entry
+	 * points. */
+	if ( startState != 0 )
+		profileOrdering( startState );
+	for ( RedStateSet::Iter en = entryPoints; en.lte(); en++ )
+		profileOrdering( *en );
+	if ( forcedErrorState )
+		profileOrdering( errState );
+	
+	/* Make sure we put everything back on. */
+	assert( stateListLen == stateList.length() );
+
+	/* Move the states that were never entered to the end, keeping their
+	 * order. */
+	RedStateList cold;
+	RedStateAp *state = stateList.head;
+	while ( state != 0 ) {
+		RedStateAp *next = state->next;
+		if ( state->hits == 0 ) {
+			stateList.detach( state );
+			cold.append( state );
+		}
+		state = next;
+	}
+	stateList.append( cold );
+}
+
+struct CmpRedStateHits
+{
+	static int compare( RedStateAp *st1, RedStateAp *st2 )
+	{
+		if ( st1->hits > st2->hits )
+			return -1;
+		else if ( st1->hits < st2->hits )
+			return 1;
+		else
+			return 0;
+	}
+};
+
+void RedFsmAp::profileStateIds()
+{
+	/* Sort the states by hits, then bring the error state to the front and
+	 * the final states to the end. */
+	int pos = 0;
+	RedStateAp **ptrList = new RedStateAp*[stateList.length()];
+	for ( RedStateList::Iter st = stateList; st.lte(); st++, pos++ )
+		ptrList[pos] = st;
+	
+	MergeSort<RedStateAp*, CmpRedStateHits> mergeSort;
+	mergeSort.sort( ptrList, stateList.length() );
+
+	stateList.abandon();
+	for ( int st = 0; st < pos; st++ )
+		stateList.append( ptrList[st] );
+	delete[] ptrList;
+
+	listStateIds();
+}
+
+void RedFsmAp::listStateIds()
+{
+	/* Both moves are stable, so the states keep their order otherwise. */
+	if ( errState != 0 ) {
+		stateList.detach( errState );
+		stateList.prepend( errState );
+	}
+
+	sortStatesByFinal();
+	sequentialStateIds();
+
+	/* The lowest final id may now belong to another state. */
+	firstFinState = 0;
+	findFirstFinState();
+}
+
 /* Assign state ids by appearance in the state list. */
 void RedFsmAp::sequentialStateIds()
 {
@@ -260,6 +674,7 @@ void RedFsmAp::moveTransToSingle( RedStateAp *state )
 			
 			/* Extend. */
 			range[rpos].highKey = range[rpos+1].highKey;
+			range[rpos].hits += range[rpos+1].hits;
 			range.remove( rpos+1 );
 		}
 		/* Maybe move it to the singles. */
@@ -279,6 +694,10 @@ void RedFsmAp::chooseSingle()
 {
 	/* Loop the states. */
 	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
+		/* Range bitmaps and key switches cover the singles too. */
+		if ( st->rangeBitmap || st->keySwitch )
+			continue;
+
 		/* Rewrite the transition list taking out the suitable single
 		 * transtions. */
 		moveTransToSingle( st );
@@ -338,6 +757,605 @@ void RedFsmAp::makeFlat()
 }
 
 
+/* The transition a flat state takes on a key. Null if the key is outside the
+ * state's range and there is no default. */
+static RedTransAp *flatTrans( RedStateAp *st, Key key )
+{
+	if ( st->transList != 0 && st->lowKey <= key && key <= st->highKey )
+		return st->transList[keyOps->span( st->lowKey, key ) - 1];
+	return st->defTrans;
+}
+
+/* Position of a value in a sorted table of distinct values that holds it. */
+static int findBound( unsigned long long *bounds, int numBounds, unsigned long long val )
+{
+	int lower = 0, upper = numBounds - 1;
+	while ( lower < upper ) {
+		int mid = lower + ( upper - lower ) / 2;
+		if ( bounds[mid] < val )
+			lower = mid + 1;
+		else
+			upper = mid;
+	}
+	return lower;
+}
+
+/* Find the classes of keys that every state treats the same, then rewrite the
+ * flat tables to be indexed by class. Class c is stored as key minKey + c, so
+ * the flat arrays can hold it. Must be called after makeFlat. If the keys that
+ * can occur, wide keys included, span more than the limit, then the tables are
+ * left as they are and false is returned. */
+bool RedFsmAp::makeFlatClasses()
+{
+	/* Find how many keys can occur. */
+	unsigned long long domain = keyOps->alphSize();
+	if ( domain == 0 || domain > _CLASS_MAP_LIMIT )
+		return false;
+
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
+		if ( st->transList != 0 ) {
+			unsigned long long span = keyOps->span( keyOps->minKey, st->highKey );
+			if ( span > domain )
+				domain = span;
+		}
+		for ( GenStateCondList::Iter sc = st->stateCondList; sc.lte(); sc++ ) {
+			int numConds = sc->condSpace->condSet.length();
+			if ( numConds >= 16 )
+				return false;
+			unsigned long long span = keyOps->span( keyOps->minKey, 
+					sc->condSpace->baseKey ) - 1 + keyOps->alphSize() * (1 << numConds);
+			if ( span > domain )
+				domain = span;
+		}
+	}
+
+	if ( domain > _CLASS_MAP_LIMIT )
+		return false;
+
+	/* Cut the keys into intervals at the ends of every state's ranges. No
+	 * state tells apart the keys of an interval. */
+	Vector<unsigned long long> bounds;
+	bounds.append( 0 );
+	bounds.append( domain );
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
+		for ( RedTransList::Iter rtel = st->outRange; rtel.lte(); rtel++ ) {
+			bounds.append( keyOps->span( keyOps->minKey, rtel->lowKey ) - 1 );
+			bounds.append( keyOps->span( keyOps->minKey, rtel->highKey ) );
+		}
+	}
+
+	MergeSort< unsigned long long, CmpOrd<unsigned long long> > boundSort;
+	boundSort.sort( bounds.data, bounds.length() );
+	int numBounds = 0;
+	for ( int b = 0; b < bounds.length(); b++ ) {
+		if ( numBounds == 0 || bounds[b] != bounds[numBounds-1] )
+			bounds[numBounds++] = bounds[b];
+	}
+	int numIntervals = numBounds - 1;
+
+	/* Refine the classes of the intervals one state at a time, by the ranges
+	 * that do not go to the state's default. Intervals a state covers move to
+	 * a new class for each pair (current class, transition taken), the others
+	 * stay where they are. */
+	int *cls = new int[numIntervals];
+	memset( cls, 0, sizeof(int) * numIntervals );
+	int curClasses = 1;
+	long long numTrans = transSet.length() + 1;
+
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
+		AvlMap< long long, int, CmpOrd<long long> > split;
+		for ( RedTransList::Iter rtel = st->outRange; rtel.lte(); rtel++ ) {
+			if ( rtel->value == st->defTrans )
+				continue;
+
+			int first = findBound( bounds.data, numBounds, 
+					keyOps->span( keyOps->minKey, rtel->lowKey ) - 1 );
+			int last = findBound( bounds.data, numBounds, 
+					keyOps->span( keyOps->minKey, rtel->highKey ) );
+			for ( int i = first; i < last; i++ ) {
+				long long pair = cls[i] * numTrans + rtel->value->id + 1;
+				AvlMapEl< long long, int > *el = split.find( pair );
+				if ( el == 0 )
+					el = split.insert( pair, curClasses++ );
+				cls[i] = el->value;
+			}
+		}
+	}
+
+	/* Number the classes in key order. */
+	int *renumber = new int[curClasses];
+	Key *rep = new Key[curClasses];
+	for ( int c = 0; c < curClasses; c++ )
+		renumber[c] = -1;
+	numClasses = 0;
+	classMapLen = domain;
+	classMap = new Key[domain];
+	for ( int i = 0; i < numIntervals; i++ ) {
+		if ( renumber[cls[i]] < 0 ) {
+			rep[numClasses] = Key( keyOps->minKey.getVal() + (long)bounds[i] );
+			renumber[cls[i]] = numClasses++;
+		}
+		Key classKey( keyOps->minKey.getVal() + renumber[cls[i]] );
+		for ( unsigned long long k = bounds[i]; k < bounds[i+1]; k++ )
+			classMap[k] = classKey;
+	}
+
+	/* Rewrite each state's flat range over the classes it does not send to
+	 * the default. */
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
+		if ( st->transList == 0 )
+			continue;
+
+		int lowClass = -1, highClass = -1;
+		for ( int c = 0; c < numClasses; c++ ) {
+			if ( flatTrans( st, rep[c] ) != st->defTrans ) {
+				if ( lowClass < 0 )
+					lowClass = c;
+				highClass = c;
+			}
+		}
+
+		RedTransAp **transList = 0;
+		if ( lowClass >= 0 ) {
+			transList = new RedTransAp*[highClass - lowClass + 1];
+			RedTransAp *fill = st->defTrans != 0 ? st->defTrans : 
+					flatTrans( st, rep[lowClass] );
+			for ( int c = lowClass; c <= highClass; c++ ) {
+				/* A class can be outside the state's keys with no default
+				 * when the state never sees it. Any entry will do. */
+				RedTransAp *trans = flatTrans( st, rep[c] );
+				transList[c - lowClass] = trans != 0 ? trans : fill;
+			}
+		}
+
+		delete[] st->transList;
+		st->transList = transList;
+		if ( transList == 0 )
+			st->lowKey = st->highKey = 0;
+		else {
+			st->lowKey = Key( keyOps->minKey.getVal() + lowClass );
+			st->highKey = Key( keyOps->minKey.getVal() + highClass );
+		}
+	}
+
+	delete[] cls;
+	delete[] renumber;
+	delete[] rep;
+	return true;
+}
+
+struct CombRow
+{
+	RedStateAp *state;
+	int numEntries;
+};
+
+/* Rows with the most entries go first. */
+struct CmpCombRow
+{
+	static int compare( const CombRow &r1, const CombRow &r2 )
+	{
+		if ( r1.numEntries > r2.numEntries )
+			return -1;
+		else if ( r1.numEntries < r2.numEntries )
+			return 1;
+		return 0;
+	}
+};
+
+/* Overlay the flat rows of the states in one pair of next and check arrays.
+ * Only the keys that do not take the default transition are stored. Each row
+ * is placed at the first offset where all of its entries land in free slots.
+ * Must be called after makeFlat. */
+void RedFsmAp::packComb()
+{
+	CombRow *rows = new CombRow[stateList.length()];
+	int numRows = 0;
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
+		rows[numRows].state = st;
+		rows[numRows].numEntries = 0;
+		if ( st->transList != 0 ) {
+			unsigned long long span = keyOps->span( st->lowKey, st->highKey );
+			for ( unsigned long long pos = 0; pos < span; pos++ ) {
+				if ( st->transList[pos] != st->defTrans )
+					rows[numRows].numEntries += 1;
+			}
+		}
+		numRows += 1;
+	}
+
+	MergeSort<CombRow, CmpCombRow> sortRows;
+	sortRows.sort( rows, numRows );
+
+	Vector<RedTransAp*> next;
+	Vector<int> check;
+	Vector<long> offsets;
+	long firstFree = 0;
+	maxCombBase = 0;
+
+	for ( int r = 0; r < numRows; r++ ) {
+		RedStateAp *st = rows[r].state;
+		st->combBase = 0;
+		if ( rows[r].numEntries == 0 )
+			continue;
+
+		offsets.empty();
+		unsigned long long span = keyOps->span( st->lowKey, st->highKey );
+		for ( unsigned long long pos = 0; pos < span; pos++ ) {
+			if ( st->transList[pos] != st->defTrans )
+				offsets.append( pos );
+		}
+
+		/* First fit, starting where the first entry could go in the first
+		 * free slot. */
+		long base = firstFree - offsets[0];
+		if ( base < 0 )
+			base = 0;
+		while ( true ) {
+			bool fits = true;
+			for ( long o = 0; o < offsets.length(); o++ ) {
+				long slot = base + offsets[o];
+				if ( slot < check.length() && check[slot] >= 0 ) {
+					fits = false;
+					break;
+				}
+			}
+			if ( fits )
+				break;
+			base += 1;
+		}
+
+		for ( long o = 0; o < offsets.length(); o++ ) {
+			long slot = base + offsets[o];
+			while ( check.length() <= slot ) {
+				check.append( -1 );
+				next.append( 0 );
+			}
+			check[slot] = st->id;
+			next[slot] = st->transList[offsets[o]];
+		}
+
+		st->combBase = base;
+		if ( base > maxCombBase )
+			maxCombBase = base;
+
+		while ( firstFree < check.length() && check[firstFree] >= 0 )
+			firstFree += 1;
+	}
+
+	/* Lookups go to base + (key - lowKey) for any key in the state's range, so
+	 * the tables must reach the end of every range. */
+	long length = check.length() > 0 ? check.length() : 1;
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
+		long end = st->combBase + 1;
+		if ( st->transList != 0 )
+			end = st->combBase + keyOps->span( st->lowKey, st->highKey );
+		if ( end > length )
+			length = end;
+	}
+
+	combLen = length;
+	combNext = new RedTransAp*[length];
+	combCheck = new int[length];
+	for ( long slot = 0; slot < length; slot++ ) {
+		if ( slot < check.length() && check[slot] >= 0 ) {
+			combNext[slot] = next[slot];
+			combCheck[slot] = check[slot];
+		}
+		else {
+			combNext[slot] = 0;
+			combCheck[slot] = nextStateId;
+		}
+	}
+
+	delete[] rows;
+}
+
+/* Lay out the transition of every state on every key of the alphabet. Keys
+ * outside a state's flat row take its default transition. Must be called
+ * after makeFlat. */
+void RedFsmAp::makeDense()
+{
+	denseSpan = keyOps->span( keyOps->minKey, keyOps->maxKey );
+	denseTrans = new RedTransAp*[nextStateId * denseSpan];
+
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
+		RedTransAp **row = denseTrans + st->id * denseSpan;
+		for ( unsigned long long pos = 0; pos < denseSpan; pos++ )
+			row[pos] = st->defTrans;
+
+		if ( st->transList != 0 ) {
+			unsigned long long base = keyOps->span( keyOps->minKey, st->lowKey ) - 1;
+			unsigned long long span = keyOps->span( st->lowKey, st->highKey );
+			for ( unsigned long long pos = 0; pos < span; pos++ )
+				row[base + pos] = st->transList[pos];
+		}
+	}
+}
+
+RedTransAp *RedFsmAp::findTrans( RedStateAp *state, Key key )
+{
+	for ( RedTransList::Iter rtel = state->outSingle; rtel.lte(); rtel++ ) {
+		if ( rtel->lowKey <= key && key <= rtel->highKey )
+			return rtel->value;
+	}
+	for ( RedTransList::Iter rtel = state->outRange; rtel.lte(); rtel++ ) {
+		if ( rtel->lowKey <= key && key <= rtel->highKey )
+			return rtel->value;
+	}
+	return state->defTrans;
+}
+
+static bool isSkipSelf( RedStateAp *state, RedTransAp *trans )
+{
+	return trans != 0 && trans->targ == state && trans->action == 0;
+}
+
+static void markSkipSelf( RedStateAp *state, RedTransList &list, bool *self )
+{
+	for ( RedTransList::Iter rtel = list; rtel.lte(); rtel++ ) {
+		if ( rtel->lowKey > keyOps->maxKey )
+			break;
+
+		bool isSelf = isSkipSelf( state, rtel->value );
+		unsigned long long base = keyOps->span( keyOps->minKey, rtel->lowKey ) - 1;
+		unsigned long long span = keyOps->span( rtel->lowKey, rtel->highKey );
+		for ( unsigned long long pos = 0; pos < span; pos++ )
+			self[base + pos] = isSelf;
+	}
+}
+
+/* Set self[key - minKey] for the keys on which the state goes back to itself
+ * with no actions. The keys must be one byte. The default is taken for the
+ * keys between the ranges. */
+void RedFsmAp::findSkipSelf( RedStateAp *state, bool *self )
+{
+	bool defSelf = isSkipSelf( state, state->defTrans );
+	unsigned long long span = keyOps->span( keyOps->minKey, keyOps->maxKey );
+	for ( unsigned long long pos = 0; pos < span; pos++ )
+		self[pos] = defSelf;
+
+	markSkipSelf( state, state->outSingle, self );
+	markSkipSelf( state, state->outRange, self );
+}
+
+void RedFsmAp::findSkipLoops( bool allStates, bool startTable )
+{
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
+		st->skipLoop = false;
+		st->skipTable = false;
+		st->numSkipExits = 0;
+
+		if ( !allStates && st != startState )
+			continue;
+
+		/* Anything that must run on every character rules out skipping. */
+		if ( st == errState || st->toStateAction != 0 || 
+				st->fromStateAction != 0 || st->stateCondList.length() > 0 )
+			continue;
+
+		bool self[256];
+		findSkipSelf( st, self );
+
+		bool anySelf = false, tooMany = false;
+		Key key = keyOps->minKey;
+		for ( int pos = 0; ; pos++ ) {
+			if ( self[pos] )
+				anySelf = true;
+			else if ( st->numSkipExits < _SKIP_LOOP_EXITS )
+				st->skipExits[st->numSkipExits++] = key;
+			else
+				tooMany = true;
+
+			if ( key == keyOps->maxKey )
+				break;
+			key.increment();
+		}
+
+		if ( anySelf && !tooMany )
+			st->skipLoop = true;
+		else if ( anySelf && startTable && st == startState ) {
+			st->skipLoop = true;
+			st->skipTable = true;
+		}
+		else
+			st->numSkipExits = 0;
+	}
+}
+
+void RedFsmAp::findRangeTargs( RedStateAp *state )
+{
+	state->rangeTargs.empty();
+	for ( RedTransList::Iter rtel = state->outRange; rtel.lte(); rtel++ ) {
+		int targ = 0;
+		while ( targ < state->rangeTargs.length() && 
+				state->rangeTargs[targ] != rtel->value )
+			targ += 1;
+		if ( targ == state->rangeTargs.length() )
+			state->rangeTargs.append( rtel->value );
+	}
+}
+
+/* Index of a range transition in the state's range targets, which must
+ * have been found. */
+int RedFsmAp::rangeTarg( RedStateAp *state, RedTransAp *trans )
+{
+	int targ = 0;
+	while ( state->rangeTargs[targ] != trans )
+		targ += 1;
+	return targ;
+}
+
+/* Bitmaps and flat rows cover the keys from the first range to the last. */
+void RedFsmAp::setRangeSpan( RedStateAp *state )
+{
+	RedTransList &outRange = state->outRange;
+	state->lowKey = outRange[0].lowKey;
+	state->highKey = outRange[outRange.length()-1].highKey;
+}
+
+/* Can the ranges be tested with bitmaps. The range targets must be found
+ * first. Conditions are translated in the compare trees. */
+bool RedFsmAp::canRangeBitmap( RedStateAp *state )
+{
+	RedTransList &outRange = state->outRange;
+	return state->stateCondList.length() == 0 &&
+			outRange.length() > 0 &&
+			state->rangeTargs.length() <= _RANGE_BITMAP_TARGS &&
+			keyOps->span( outRange[0].lowKey, outRange[outRange.length()-1].highKey )
+				<= _RANGE_BITMAP_SPAN;
+}
+
+void RedFsmAp::makeRangeBitmap( RedStateAp *state )
+{
+	RedTransList &outRange = state->outRange;
+	state->rangeBitmap = true;
+	setRangeSpan( state );
+	state->bitmapOffset = rangeBits.length();
+
+	unsigned long long bytes = rangeBitmapBytes( state );
+	for ( unsigned long long b = 0; b < bytes * state->rangeTargs.length(); b++ )
+		rangeBits.append( 0 );
+
+	for ( RedTransList::Iter rtel = outRange; rtel.lte(); rtel++ ) {
+		int targ = rangeTarg( state, rtel->value );
+		unsigned char *bits = rangeBits.data + rangeBitmapStart( state, targ );
+		unsigned long long base = keyOps->span( state->lowKey, rtel->lowKey ) - 1;
+		unsigned long long len = keyOps->span( rtel->lowKey, rtel->highKey );
+		for ( unsigned long long pos = base; pos < base + len; pos++ )
+			bits[pos/8] |= 1 << (pos%8);
+	}
+}
+
+unsigned long long RedFsmAp::rangeBitmapBytes( RedStateAp *state )
+{
+	return ( keyOps->span( state->lowKey, state->highKey ) + 7 ) / 8;
+}
+
+unsigned long long RedFsmAp::rangeBitmapStart( RedStateAp *state, int targ )
+{
+	return state->bitmapOffset + targ * rangeBitmapBytes( state );
+}
+
+void RedFsmAp::chooseRangeBitmaps()
+{
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
+		/* States going through a class jump table compare no ranges. */
+		if ( classMap != 0 && st->stateCondList.length() == 0 )
+			continue;
+
+		if ( st->outRange.length() >= _RANGE_BITMAP_RANGES ) {
+			findRangeTargs( st );
+			if ( canRangeBitmap( st ) )
+				makeRangeBitmap( st );
+		}
+	}
+}
+
+void RedFsmAp::chooseKeySwitches( int density )
+{
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
+		RedTransList &outRange = st->outRange;
+		if ( st->rangeBitmap || st->stateCondList.length() > 0 ||
+				outRange.length() < _KEY_SWITCH_TRANS )
+			continue;
+
+		unsigned long long span = keyOps->span( outRange[0].lowKey, 
+				outRange[outRange.length()-1].highKey );
+		if ( span > _KEY_SWITCH_SPAN )
+			continue;
+
+		unsigned long long covered = 0;
+		for ( RedTransList::Iter rtel = outRange; rtel.lte(); rtel++ )
+			covered += keyOps->span( rtel->lowKey, rtel->highKey );
+
+		if ( covered * 100 >= span * density ) {
+			findRangeTargs( st );
+			st->keySwitch = true;
+		}
+	}
+}
+
+HybridLookup RedFsmAp::hybridCost( RedStateAp *state )
+{
+	/* Conditions are translated in the compare trees. */
+	if ( state->stateCondList.length() > 0 || state->outRange.length() == 0 )
+		return HybridSearch;
+
+	RedTransList &outRange = state->outRange;
+	unsigned long long span = keyOps->span( outRange[0].lowKey, 
+			outRange[outRange.length()-1].highKey );
+
+	/* Estimate each lookup in compares and loads. A single key costs one
+	 * compare to test, a range two. */
+	int linearCost = 0;
+	for ( RedTransList::Iter rtel = outRange; rtel.lte(); rtel++ )
+		linearCost += rtel->lowKey == rtel->highKey ? 1 : 2;
+
+	/* The search halves the ranges with two compares at each level. */
+	int searchCost = 2;
+	for ( int n = outRange.length(); n > 1; n >>= 1 )
+		searchCost += 2;
+
+	/* Bounds checks, then a load and a bit test for each target, or a load
+	 * and a jump through the switch. Charge the flat row a little for its
+	 * size. */
+	int bitmapCost = canRangeBitmap( state ) ? 
+			2 + 2 * state->rangeTargs.length() : INT_MAX;
+	int flatCost = span <= _HYBRID_SPAN_LIMIT ? 5 + (int)(span / 64) : INT_MAX;
+
+	/* On ties prefer the lookups that need no tables. */
+	HybridLookup lookup = HybridLinear;
+	int cost = linearCost;
+	if ( searchCost < cost ) {
+		lookup = HybridSearch;
+		cost = searchCost;
+	}
+	if ( bitmapCost < cost ) {
+		lookup = HybridBitmap;
+		cost = bitmapCost;
+	}
+	if ( flatCost < cost )
+		lookup = HybridFlat;
+
+	return lookup;
+}
+
+void RedFsmAp::chooseHybrid()
+{
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
+		findRangeTargs( st );
+		st->hybridLookup = hybridCost( st );
+
+		if ( st->hybridLookup == HybridSearch || st->hybridLookup == HybridLinear )
+			moveTransToSingle( st );
+		else if ( st->hybridLookup == HybridBitmap )
+			makeRangeBitmap( st );
+		else {
+			RedTransList &outRange = st->outRange;
+			setRangeSpan( st );
+			unsigned long long span = keyOps->span( st->lowKey, st->highKey );
+
+			/* Gaps between the ranges take the default, zero. */
+			st->hybridOffset = hybridIndex.length();
+			for ( unsigned long long pos = 0; pos < span; pos++ )
+				hybridIndex.append( 0 );
+
+			for ( RedTransList::Iter rtel = outRange; rtel.lte(); rtel++ ) {
+				int targ = rangeTarg( st, rtel->value ) + 1;
+
+				if ( targ > maxHybridIndex )
+					maxHybridIndex = targ;
+
+				unsigned long long base = keyOps->span( st->lowKey, rtel->lowKey ) - 1;
+				unsigned long long len = keyOps->span( rtel->lowKey, rtel->highKey );
+				for ( unsigned long long pos = base; pos < base + len; pos++ )
+					hybridIndex[st->hybridOffset + pos] = targ;
+			}
+		}
+	}
+}
+
 /* A default transition has been picked, move it from the outRange to the
  * default pointer. */
 void RedFsmAp::moveToDefault( RedTransAp *defTrans, RedStateAp *state )
@@ -464,6 +1482,71 @@ void RedFsmAp::chooseDefaultGoto()
 	}
 }
 
+RedTransAp *RedFsmAp::chooseDefaultProfile( RedStateAp *state )
+{
+	/* Make a set of transitions from the outRange. */
+	RedTransSet stateTransSet;
+	for ( RedTransList::Iter rtel = state->outRange; rtel.lte(); rtel++ )
+		stateTransSet.insert( rtel->value );
+
+	/* Total up the span, ranges and hits of each transition. */
+	int numTrans = stateTransSet.length();
+	unsigned long long *span = new unsigned long long[numTrans];
+	unsigned long long *hits = new unsigned long long[numTrans];
+	int *numRanges = new int[numTrans];
+	memset( span, 0, sizeof(unsigned long long) * numTrans );
+	memset( hits, 0, sizeof(unsigned long long) * numTrans );
+	memset( numRanges, 0, sizeof(int) * numTrans );
+
+	unsigned long long totalHits = 0;
+	for ( RedTransList::Iter rtel = state->outRange; rtel.lte(); rtel++ ) {
+		RedTransAp **inSet = stateTransSet.find( rtel->value );
+		int pos = inSet - stateTransSet.data;
+		span[pos] += keyOps->span( rtel->lowKey, rtel->highKey );
+		hits[pos] += rtel->hits;
+		numRanges[pos] += 1;
+		totalHits += rtel->hits;
+	}
+
+	/* A transition taking most of the hits is only made the default when
+	 * the search that comes before the default is short. Otherwise it is
+	 * better left in the ranges, where the compare tree can test it first. */
+	int numOutRange = state->outRange.length();
+	RedTransAp *maxTrans = 0;
+	unsigned long long maxSpan = 0;
+	for ( RedTransSet::Iter rtel = stateTransSet; rtel.lte(); rtel++ ) {
+		int pos = rtel.pos();
+		if ( hits[pos] * 2 > totalHits && 
+				numOutRange - numRanges[pos] > _PROFILE_DEFAULT_RANGES )
+			continue;
+
+		if ( span[pos] > maxSpan ) {
+			maxSpan = span[pos];
+			maxTrans = *rtel;
+		}
+	}
+
+	delete[] span;
+	delete[] hits;
+	delete[] numRanges;
+
+	if ( maxTrans == 0 )
+		maxTrans = chooseDefaultSpan( state );
+	return maxTrans;
+}
+
+void RedFsmAp::chooseDefaultProfile()
+{
+	/* Loop the states. */
+	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
+		/* As with picking by span, only when the alphabet is covered. */
+		if ( alphabetCovered( st->outRange ) ) {
+			RedTransAp *defTrans = chooseDefaultProfile( st );
+			moveToDefault( defTrans, st );
+		}
+	}
+}
+
 RedTransAp *RedFsmAp::chooseDefaultNumRanges( RedStateAp *state )
 {
 	/* Make a set of transitions from the outRange. */
@@ -541,28 +1624,66 @@ RedTransAp *RedFsmAp::allocateTrans( RedStateAp *targ, RedAction *action )
 	return inDict;
 }
 
-void RedFsmAp::partitionFsm( int nparts )
+void RedFsmAp::partitionFsm( int nparts, long partSize )
 {
-	/* At this point the states are ordered by a depth-first traversal. We
-	 * will allocate to partitions based on this ordering. */
+	/* Weigh each state by the transitions written out for it, which is
+	 * roughly its share of the code. */
+	int numStates = stateList.length();
+	PartitionGraph graph( numStates );
+	RedStateAp **byPos = new RedStateAp*[numStates];
+	int *posById = new int[nextStateId];
+	long total = 0;
+
+	int pos = 0;
+	for ( RedStateList::Iter st = stateList; st.lte(); st++, pos++ ) {
+		byPos[pos] = st;
+		posById[st->id] = pos;
+		graph.vertWeight[pos] = 1 + st->outSingle.length() + 
+				st->outRange.length() + ( st->defTrans != 0 ? 1 : 0 );
+		total += graph.vertWeight[pos];
+	}
+
+	/* With no count given, make as many partitions as it takes to keep each
+	 * under the size asked for. */
+	if ( nparts <= 0 ) {
+		nparts = partSize > 0 ? ( total + partSize - 1 ) / partSize : 1;
+		if ( nparts < 1 )
+			nparts = 1;
+	}
 	this->nParts = nparts;
-	int partSize = stateList.length() / nparts;
-	int remainder = stateList.length() % nparts;
-	int numInPart = partSize;
-	int partition = 0;
-	if ( remainder-- > 0 )
-		numInPart += 1;
-	for ( RedStateList::Iter st = stateList; st.lte(); st++ ) {
-		st->partition = partition;
 
-		numInPart -= 1;
-		if ( numInPart == 0 ) {
-			partition += 1;
-			numInPart = partSize;
-			if ( remainder-- > 0 )
-				numInPart += 1;
+	/* A transition between partitions costs a return and another dispatch,
+	 * more so for the transitions the profile shows are taken often. Going
+	 * to the error state stops the machine wherever the state is, so those
+	 * transitions are left out. */
+	for ( pos = 0; pos < numStates; pos++ ) {
+		RedStateAp *st = byPos[pos];
+		for ( RedTransList::Iter rtel = st->outSingle; rtel.lte(); rtel++ ) {
+			RedStateAp *targ = rtel->value->targ;
+			if ( targ != 0 && targ != errState )
+				graph.addEdge( pos, posById[targ->id], 1 + rtel->hits );
+		}
+		for ( RedTransList::Iter rtel = st->outRange; rtel.lte(); rtel++ ) {
+			RedStateAp *targ = rtel->value->targ;
+			if ( targ != 0 && targ != errState )
+				graph.addEdge( pos, posById[targ->id], 1 + rtel->hits );
 		}
+		if ( st->defTrans != 0 && st->defTrans->targ != 0 && 
+				st->defTrans->targ != errState )
+			graph.addEdge( pos, posById[st->defTrans->targ->id], 1 );
 	}
+	graph.finish();
+
+	/* The states are in depth-first order, which gives the partitioner a
+	 * good place to start. */
+	int *part = new int[numStates];
+	partitionGraph( graph, nparts, part );
+	for ( pos = 0; pos < numStates; pos++ )
+		byPos[pos]->partition = part[pos];
+
+	delete[] byPos;
+	delete[] posById;
+	delete[] part;
 }
 
 void RedFsmAp::setInTrans()
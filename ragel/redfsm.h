@@ -41,6 +41,34 @@
 #include "sbsttable.h"
 
 
+/* Most keys a character class map may cover. */
+#define _CLASS_MAP_LIMIT  0x10000
+
+/* Most exit characters a self loop may have and still be scanned. */
+#define _SKIP_LOOP_EXITS  4
+
+/* Most keys a hybrid state's flat row may span. */
+#define _HYBRID_SPAN_LIMIT  256
+
+/* Goto styles test a bitmap for each target of a state's ranges, in place
+ * of a compare tree, when there are at least _RANGE_BITMAP_RANGES ranges
+ * going to at most _RANGE_BITMAP_TARGS targets within a span of at most
+ * _RANGE_BITMAP_SPAN keys. */
+#define _RANGE_BITMAP_RANGES  4
+#define _RANGE_BITMAP_TARGS   3
+#define _RANGE_BITMAP_SPAN    256
+
+/* Goto styles switch on the key, in place of a compare tree, when a state
+ * has at least _KEY_SWITCH_TRANS singles and ranges within a span of at
+ * most _KEY_SWITCH_SPAN keys, enough of which have transitions. */
+#define _KEY_SWITCH_TRANS  4
+#define _KEY_SWITCH_SPAN   256
+
+/* With a profile, goto styles keep a transition taking most of a state's
+ * hits out of the default when more than _PROFILE_DEFAULT_RANGES ranges
+ * would be left to search before reaching the default. */
+#define _PROFILE_DEFAULT_RANGES  4
+
 #define TRANS_ERR_TRANS   0
 #define STATE_ERR_STATE   0
 #define FUNC_NO_FUNC      0
@@ -248,10 +276,13 @@ struct RedTransEl
 {
 	/* Constructors. */
 	RedTransEl( Key lowKey, Key highKey, RedTransAp *value ) 
-		: lowKey(lowKey), highKey(highKey), value(value) { }
+		: lowKey(lowKey), highKey(highKey), value(value), hits(0) { }
 
 	Key lowKey, highKey;
 	RedTransAp *value;
+
+	/* Times the range was taken in the profile. */
+	unsigned long long hits;
 };
 
 typedef Vector<RedTransEl> RedTransList;
@@ -319,6 +350,15 @@ typedef DList<GenStateCond> GenStateCondList;
 typedef Vector<GenStateCond*> StateCondVect;
 
 /* Reduced state. */
+/* How a state locates its transition in the hybrid code style. */
+enum HybridLookup
+{
+	HybridSearch,      /* Switch on the singles, binary search the ranges. */
+	HybridLinear,      /* Test the singles and ranges one after another. */
+	HybridBitmap,      /* Test a range bitmap for each target. */
+	HybridFlat         /* Switch on an index from a row over the key span. */
+};
+
 struct RedStateAp
 {
 	RedStateAp()
@@ -338,7 +378,18 @@ struct RedStateAp
 		bAnyRegCurStateRef(false),
 		partitionBoundary(false),
 		inTrans(0),
-		numInTrans(0)
+		numInTrans(0),
+		combBase(0),
+		skipLoop(false),
+		skipTable(false),
+		numSkipExits(0),
+		rangeBitmap(false),
+		bitmapOffset(0),
+		keySwitch(false),
+		hybridLookup(HybridSearch),
+		hybridOffset(0),
+		hits(0),
+		profileId(0)
 	{ }
 
 	/* Transitions out. */
@@ -380,6 +431,42 @@ struct RedStateAp
 
 	RedTransAp **inTrans;
 	int numInTrans;
+
+	/* Where the state's flat row starts in the row displaced tables. */
+	int combBase;
+
+	/* The state loops on itself for every character but the exits, so the
+	 * input can be scanned ahead for the next exit. When there are too many
+	 * exits to list, skipTable says to look them up in a table instead. */
+	bool skipLoop;
+	bool skipTable;
+	Key skipExits[_SKIP_LOOP_EXITS];
+	int numSkipExits;
+
+	/* Targets of the ranges, in order of first appearance. */
+	Vector<RedTransAp*> rangeTargs;
+
+	/* The ranges are tested with a bitmap for each target, covering lowKey
+	 * to highKey. The bitmaps follow one another from bitmapOffset in the
+	 * range bits. */
+	bool rangeBitmap;
+	int bitmapOffset;
+
+	/* The ranges are dense enough to switch on every key they cover. */
+	bool keySwitch;
+
+	/* Chosen lookup for the hybrid style. A flat row covers lowKey to
+	 * highKey and starts at hybridOffset in the hybrid index. The targets are
+	 * numbered from one in rangeTargs order, zero being the default. */
+	HybridLookup hybridLookup;
+	int hybridOffset;
+
+	/* Times the state was entered in the profile. */
+	unsigned long long hits;
+
+	/* The id given by the frontend. Profiles refer to states by this id, so
+	 * it is kept when the states are renumbered. */
+	int profileId;
 };
 
 /* List of states. */
@@ -388,10 +475,13 @@ typedef DList<RedStateAp> RedStateList;
 /* Set of reduced transitons. Comparison is by pointer. */
 typedef BstSet< RedTransAp*, CmpOrd<RedTransAp*> > RedTransSet;
 
+struct ProfileMachine;
+
 /* Next version of the fsm machine. */
 struct RedFsmAp
 {
 	RedFsmAp();
+	~RedFsmAp();
 
 	bool forcedErrorState;
 
@@ -413,6 +503,9 @@ struct RedFsmAp
 	int numFinStates;
 	int nParts;
 
+	/* Hit counts have been read from a profile. */
+	bool profiled;
+
 	bool bAnyToStateActions;
 	bool bAnyFromStateActions;
 	bool bAnyRegActions;
@@ -448,6 +541,30 @@ struct RedFsmAp
 	int maxCondIndexOffset;
 	int maxCond;
 
+	/* Character classes, indexed by key - minKey. */
+	Key *classMap;
+	unsigned long long classMapLen;
+	int numClasses;
+
+	/* Row displaced tables. Slots hold the owning state's id, or nextStateId
+	 * when free. */
+	RedTransAp **combNext;
+	int *combCheck;
+	int combLen;
+	int maxCombBase;
+
+	/* Transitions for every state and key, indexed by
+	 * state id * denseSpan + key - minKey. */
+	RedTransAp **denseTrans;
+	unsigned long long denseSpan;
+
+	/* Bitmaps of states tested with range bitmaps. */
+	Vector<unsigned char> rangeBits;
+
+	/* Flat rows of the hybrid style. */
+	Vector<int> hybridIndex;
+	int maxHybridIndex;
+
 	bool anyActions();
 	bool anyToStateActions()        { return bAnyToStateActions; }
 	bool anyFromStateActions()      { return bAnyFromStateActions; }
@@ -476,6 +593,46 @@ struct RedFsmAp
 
 	void makeFlat();
 
+	/* Index the flat tables by character class instead of key. */
+	bool makeFlatClasses();
+
+	/* Overlay the flat rows in one table. */
+	void packComb();
+
+	/* Expand the flat rows to the whole alphabet. */
+	void makeDense();
+
+	/* Mark states that sit in a plain self loop until one of a few
+	 * characters. With allStates false only the start state is considered.
+	 * With startTable true the start state may have any number of exits. */
+	RedTransAp *findTrans( RedStateAp *state, Key key );
+	void findSkipSelf( RedStateAp *state, bool *self );
+	void findSkipLoops( bool allStates, bool startTable );
+
+	/* Test the ranges of states with many ranges but few targets using
+	 * bitmaps. Must come before chooseSingle. */
+	void findRangeTargs( RedStateAp *state );
+	int rangeTarg( RedStateAp *state, RedTransAp *trans );
+	void setRangeSpan( RedStateAp *state );
+	bool canRangeBitmap( RedStateAp *state );
+	void makeRangeBitmap( RedStateAp *state );
+	void chooseRangeBitmaps();
+
+	/* Layout of a state's range bitmaps. The bit for a key of target targ is
+	 * bit (key - lowKey) & 7 of the byte at rangeBitmapStart( state, targ )
+	 * + ((key - lowKey) >> 3) in the range bits. */
+	unsigned long long rangeBitmapBytes( RedStateAp *state );
+	unsigned long long rangeBitmapStart( RedStateAp *state, int targ );
+
+	/* Switch on the key in states where at least density percent of the
+	 * keys spanned by the ranges have transitions. Must come before
+	 * chooseSingle. */
+	void chooseKeySwitches( int density );
+
+	/* Pick each state's lookup by estimated cost. */
+	HybridLookup hybridCost( RedStateAp *state );
+	void chooseHybrid();
+
 	/* Move a selected transition from ranges to default. */
 	void moveToDefault( RedTransAp *defTrans, RedStateAp *state );
 
@@ -491,6 +648,11 @@ struct RedFsmAp
 	RedTransAp *chooseDefaultGoto( RedStateAp *state );
 	void chooseDefaultGoto();
 
+	/* Pick a default transition by largest span, leaving out a transition
+	 * that the profile shows taking most of the hits. */
+	RedTransAp *chooseDefaultProfile( RedStateAp *state );
+	void chooseDefaultProfile();
+
 	/* Ordering states by transition connections. */
 	void optimizeStateOrdering( RedStateAp *state );
 	void optimizeStateOrdering();
@@ -499,6 +661,31 @@ struct RedFsmAp
 	void depthFirstOrdering( RedStateAp *state );
 	void depthFirstOrdering();
 
+	/* Breadth first ordering from the start state and entry points. */
+	void breadthFirstOrdering();
+
+	/* Order the states in chains that join the most heavily connected pairs
+	 * first. Connections are weighed by hit counts when there is a profile
+	 * and otherwise by the share of a state's keys that lead to the other. */
+	void affinityOrdering();
+
+	/* Load the hit counts of a profile into the states and ranges. Returns
+	 * false if the profile names states or keys the machine does not have. */
+	bool applyProfile( ProfileMachine *profile );
+
+	/* Depth first ordering following the hottest transitions first, with the
+	 * states never entered moved to the end. */
+	void profileOrdering( RedStateAp *state );
+	void profileOrdering();
+
+	/* Renumber the states hottest first, keeping the final states after the
+	 * non-final states and the error state first. */
+	void profileStateIds();
+
+	/* Number the states in list order, with the error state first and the
+	 * final states last. */
+	void listStateIds();
+
 	/* Set state ids. */
 	void sequentialStateIds();
 	void sortStateIdsByFinal();
@@ -523,7 +710,10 @@ struct RedFsmAp
 
 	RedTransAp *allocateTrans( RedStateAp *targState, RedAction *actionTable );
 
-	void partitionFsm( int nParts );
+	/* Assign the states to nParts partitions, cutting as few transitions
+	 * between them as it can. With nParts zero the count is chosen to keep
+	 * each partition under partSize transitions. */
+	void partitionFsm( int nParts, long partSize );
 
 	void setInTrans();
 };
@@ -0,0 +1,145 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _RLBFORMAT_H
+#define _RLBFORMAT_H
+
+#include <stdint.h>
+
+/*
+ * Layout of the machine files written by ragel --blob.
+ *
+ * A file starts with an RlbHeader followed by one RlbMachine for each
+ * machine. Everything else is found through RlbSections, which give the byte
+ * offset from the start of the file and the number of items. Sections start
+ * on eight byte boundaries, so a file mapped into memory can be used in
+ * place. Numbers are in the byte order of the machine that wrote the file;
+ * the magic number reads wrong on a machine of the other order.
+ *
+ * The version is raised whenever the layout changes. Readers reject
+ * versions they do not know.
+ */
+
+#define RLB_MAGIC    0x4d424c52   /* "RLBM" in little endian order. */
+#define RLB_VERSION  1
+
+#define RLB_ALIGN    8
+
+/* A list of items elsewhere in the file. */
+struct RlbSection
+{
+	uint32_t offset;
+	uint32_t length;
+};
+
+struct RlbHeader
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t numMachines;
+	uint32_t fileLength;
+};
+
+/* A range of keys and the transition taken on it. The ranges of a state are
+ * in order, do not overlap and cover every key that does not go to the error
+ * state. Keys with conditions are the wide keys made from the key and the
+ * values of the conditions. */
+struct RlbRange
+{
+	int64_t lowKey;
+	int64_t highKey;
+	uint32_t trans;
+	uint32_t pad;
+};
+
+/* A range of keys on which a state tests the conditions of a space. */
+struct RlbCondRange
+{
+	int64_t lowKey;
+	int64_t highKey;
+	uint32_t condSpace;
+	uint32_t pad;
+};
+
+/* The wide key for a space is baseKey + (key - minKey), plus alphSize << i
+ * for each condition i that holds. The conditions are action ids, found at
+ * firstCond in the condition items. */
+struct RlbCondSpace
+{
+	int64_t baseKey;
+	uint32_t firstCond;
+	uint32_t numConds;
+};
+
+/* An action, with the offset of its name in the strings. Actions without a
+ * name are called by the line and column of their definition. */
+struct RlbAction
+{
+	uint32_t name;
+	uint32_t pad;
+};
+
+/* A named entry point, for use as the target of a goto or call. */
+struct RlbEntry
+{
+	uint32_t name;
+	uint32_t state;
+};
+
+/*
+ * One machine. The transition actions and the state actions are offsets in
+ * the action items of lists made of a count and then that many action ids.
+ * The list at offset zero is empty. States of the range and condition range
+ * lists are given by the offsets of their first item, with one more offset
+ * at the end. Eof transitions are one more than the transition, zero for
+ * none.
+ */
+struct RlbMachine
+{
+	int64_t minKey;
+	int64_t maxKey;
+	uint64_t alphSize;
+
+	uint32_t name;
+	uint32_t keySize;
+	uint32_t keySigned;
+
+	uint32_t numStates;
+	uint32_t numTrans;
+	uint32_t startState;
+	uint32_t firstFinal;
+	uint32_t errState;
+
+	RlbSection stateRanges;
+	RlbSection ranges;
+	RlbSection transTargs;
+	RlbSection transActions;
+	RlbSection toStateActions;
+	RlbSection fromStateActions;
+	RlbSection eofActions;
+	RlbSection eofTrans;
+	RlbSection actionItems;
+	RlbSection actions;
+	RlbSection stateConds;
+	RlbSection condRanges;
+	RlbSection condSpaces;
+	RlbSection condItems;
+	RlbSection entries;
+	RlbSection strings;
+};
+
+#endif
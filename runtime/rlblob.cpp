@@ -0,0 +1,403 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "rlblob.h"
+#include "vector.h"
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+RlMachine::RlMachine()
+:
+	name(0),
+	numClasses(0),
+	classMap(0),
+	classTrans(0)
+{
+}
+
+RlMachine::~RlMachine()
+{
+	delete[] classMap;
+	delete[] classTrans;
+}
+
+int RlMachine::findAction( const char *name ) const
+{
+	for ( int a = 0; a < numActions; a++ ) {
+		if ( strcmp( actionName( a ), name ) == 0 )
+			return a;
+	}
+	return -1;
+}
+
+int RlMachine::findEntry( const char *name ) const
+{
+	for ( int e = 0; e < numEntries; e++ ) {
+		if ( strcmp( entryName( e ), name ) == 0 )
+			return entries[e].state;
+	}
+	return -1;
+}
+
+/* Give each state a row of transitions over the classes of keys that every
+ * state treats alike. Keys between the same range bounds of all the states
+ * are alike, so only the spans between bounds are compared. */
+void RlMachine::makeClassRows()
+{
+	if ( alphSize == 0 || alphSize > 256 || numCondSpaces > 0 )
+		return;
+
+	int size = (int)alphSize;
+	bool bound[257];
+	memset( bound, 0, sizeof(bound) );
+	bound[0] = true;
+	for ( uint32_t r = 0; r < stateRanges[numStates]; r++ ) {
+		bound[ranges[r].lowKey - minKey] = true;
+		bound[ranges[r].highKey - minKey + 1] = true;
+	}
+
+	/* The transitions of every state on a key of each span. */
+	int numSpans = 0;
+	int spanKey[256];
+	for ( int k = 0; k < size; k++ ) {
+		if ( bound[k] )
+			spanKey[numSpans++] = k;
+	}
+
+	if ( (long)numStates * numSpans > RL_CLASS_ROWS_LIMIT )
+		return;
+
+	uint32_t *cols = new uint32_t[(size_t)numSpans * numStates];
+	for ( int s = 0; s < numStates; s++ ) {
+		const RlbRange *r = ranges + stateRanges[s];
+		const RlbRange *end = ranges + stateRanges[s+1];
+		for ( int sp = 0; sp < numSpans; sp++ ) {
+			int64_t key = minKey + spanKey[sp];
+			while ( r < end && r->highKey < key )
+				r++;
+			cols[(size_t)sp * numStates + s] = r < end && r->lowKey <= key ?
+					r->trans : RL_NO_TRANS;
+		}
+	}
+
+	/* Spans with the same column are one class. */
+	int spanClass[256];
+	int classSpan[256];
+	numClasses = 0;
+	for ( int sp = 0; sp < numSpans; sp++ ) {
+		const uint32_t *col = cols + (size_t)sp * numStates;
+		int c = 0;
+		while ( c < numClasses && memcmp( col, cols + (size_t)classSpan[c] *
+				numStates, numStates * sizeof(uint32_t) ) != 0 )
+			c++;
+		if ( c == numClasses )
+			classSpan[numClasses++] = sp;
+		spanClass[sp] = c;
+	}
+
+	classMap = new uint8_t[size];
+	for ( int k = 0, sp = -1; k < size; k++ ) {
+		if ( bound[k] )
+			sp += 1;
+		classMap[k] = spanClass[sp];
+	}
+
+	classTrans = new uint32_t[(size_t)numStates * numClasses];
+	for ( int s = 0; s < numStates; s++ ) {
+		for ( int c = 0; c < numClasses; c++ ) {
+			classTrans[(size_t)s * numClasses + c] =
+					cols[(size_t)classSpan[c] * numStates + s];
+		}
+	}
+
+	delete[] cols;
+}
+
+RlBlob::RlBlob()
+:
+	data(0),
+	length(0),
+	mapped(0),
+	machines(0),
+	nMachines(0),
+	errorMsg(0)
+{
+}
+
+RlBlob::~RlBlob()
+{
+	close();
+}
+
+void RlBlob::close()
+{
+	delete[] machines;
+	machines = 0;
+	nMachines = 0;
+
+	if ( mapped != 0 )
+		munmap( mapped, length );
+	mapped = 0;
+	data = 0;
+	length = 0;
+}
+
+bool RlBlob::fail( const char *msg )
+{
+	close();
+	errorMsg = msg;
+	return false;
+}
+
+bool RlBlob::open( const char *fileName )
+{
+	close();
+
+	int fd = ::open( fileName, O_RDONLY );
+	if ( fd < 0 )
+		return fail( "could not open the file" );
+
+	struct stat st;
+	if ( fstat( fd, &st ) != 0 || st.st_size == 0 ) {
+		::close( fd );
+		return fail( "could not read the file" );
+	}
+
+	void *addr = mmap( 0, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	::close( fd );
+	if ( addr == MAP_FAILED )
+		return fail( "could not map the file" );
+
+	mapped = addr;
+	data = (const char*)addr;
+	length = st.st_size;
+	return loadData();
+}
+
+/* Check that a section lies in the file and find its items. */
+#define SECTION( ptr, type, sect, expect ) \
+	do { \
+		if ( (sect).offset % RLB_ALIGN != 0 || (sect).offset > length || \
+				( (expect) >= 0 && (long)(sect).length != (expect) ) || \
+				(sect).length > ( length - (sect).offset ) / sizeof(type) ) \
+			return false; \
+		ptr = (const type*)( data + (sect).offset ); \
+	} while ( 0 )
+
+/* An action list must start where one of the lists does. */
+#define ACTION_LIST( off ) \
+	do { \
+		if ( (off) >= numItems || ! listStart[off] ) \
+			return false; \
+	} while ( 0 )
+
+static bool stringOk( const char *strings, uint32_t length, uint32_t offset )
+{
+	return offset < length && memchr( strings + offset, 0, length - offset ) != 0;
+}
+
+bool RlBlob::loadMachine( RlMachine *m, const RlbMachine *bm )
+{
+	m->minKey = bm->minKey;
+	m->alphSize = bm->alphSize;
+	m->keySize = bm->keySize;
+	m->keySigned = bm->keySigned != 0;
+	m->numStates = bm->numStates;
+	m->numTrans = bm->numTrans;
+	m->startState = bm->startState;
+	m->firstFinal = bm->firstFinal;
+	m->errState = bm->errState;
+	m->numActions = bm->actions.length;
+	m->numEntries = bm->entries.length;
+	m->numCondSpaces = bm->condSpaces.length;
+
+	if ( bm->numStates == 0 || bm->numStates > 0x7fffffff ||
+			bm->numTrans > 0x7fffffff || bm->startState >= bm->numStates ||
+			bm->errState >= bm->numStates || bm->firstFinal > bm->numStates )
+		return false;
+
+	/* The class rows index arrays by the offset of a key in the alphabet. */
+	if ( bm->minKey > bm->maxKey || bm->alphSize !=
+			(uint64_t)bm->maxKey - (uint64_t)bm->minKey + 1 )
+		return false;
+
+	long numStates = bm->numStates;
+	SECTION( m->strings, char, bm->strings, -1 );
+	SECTION( m->stateRanges, uint32_t, bm->stateRanges, numStates + 1 );
+	SECTION( m->ranges, RlbRange, bm->ranges, -1 );
+	SECTION( m->transTargs, uint32_t, bm->transTargs, (long)bm->numTrans );
+	SECTION( m->transActions, uint32_t, bm->transActions, (long)bm->numTrans );
+	SECTION( m->toStateActions, uint32_t, bm->toStateActions, numStates );
+	SECTION( m->fromStateActions, uint32_t, bm->fromStateActions, numStates );
+	SECTION( m->eofActions, uint32_t, bm->eofActions, numStates );
+	SECTION( m->eofTrans, uint32_t, bm->eofTrans, numStates );
+	SECTION( m->actionItems, uint32_t, bm->actionItems, -1 );
+	SECTION( m->actions, RlbAction, bm->actions, -1 );
+	SECTION( m->stateConds, uint32_t, bm->stateConds, numStates + 1 );
+	SECTION( m->condRanges, RlbCondRange, bm->condRanges, -1 );
+	SECTION( m->condSpaces, RlbCondSpace, bm->condSpaces, -1 );
+	SECTION( m->condItems, uint32_t, bm->condItems, -1 );
+	SECTION( m->entries, RlbEntry, bm->entries, -1 );
+
+	uint32_t numStrings = bm->strings.length;
+	if ( ! stringOk( m->strings, numStrings, bm->name ) )
+		return false;
+	m->name = m->strings + bm->name;
+
+	/* Actions and the lists of them. */
+	uint32_t numItems = bm->actionItems.length;
+	if ( numItems == 0 || m->actionItems[0] != 0 )
+		return false;
+	Vector<bool> listStart;
+	listStart.setAsNew( numItems );
+	for ( uint32_t i = 0; i < numItems; ) {
+		uint32_t n = m->actionItems[i];
+		if ( n >= numItems - i )
+			return false;
+		for ( uint32_t a = 1; a <= n; a++ ) {
+			if ( m->actionItems[i+a] >= bm->actions.length )
+				return false;
+		}
+		listStart[i] = true;
+		i += n + 1;
+	}
+	for ( uint32_t a = 0; a < bm->actions.length; a++ ) {
+		if ( ! stringOk( m->strings, numStrings, m->actions[a].name ) )
+			return false;
+	}
+
+	/* Transitions. */
+	for ( uint32_t t = 0; t < bm->numTrans; t++ ) {
+		if ( m->transTargs[t] >= bm->numStates )
+			return false;
+		ACTION_LIST( m->transActions[t] );
+	}
+
+	/* Condition spaces. Their wide keys lie above the alphabet and are the
+	 * only keys of the ranges that may. */
+	int64_t maxWideKey = bm->maxKey;
+	for ( uint32_t c = 0; c < bm->condSpaces.length; c++ ) {
+		const RlbCondSpace *space = m->condSpaces + c;
+		if ( space->numConds > 30 || space->firstCond > bm->condItems.length ||
+				space->numConds > bm->condItems.length - space->firstCond )
+			return false;
+		for ( uint32_t i = 0; i < space->numConds; i++ ) {
+			if ( m->condItems[space->firstCond + i] >= bm->actions.length )
+				return false;
+		}
+
+		uint64_t wideKeys = bm->alphSize << space->numConds;
+		if ( space->baseKey <= bm->maxKey || wideKeys == 0 ||
+				( wideKeys >> space->numConds ) != bm->alphSize ||
+				wideKeys - 1 > (uint64_t)( INT64_MAX - space->baseKey ) )
+			return false;
+		if ( space->baseKey + (int64_t)( wideKeys - 1 ) > maxWideKey )
+			maxWideKey = space->baseKey + (int64_t)( wideKeys - 1 );
+	}
+
+	/* States, their ranges and their condition ranges. */
+	if ( m->stateRanges[0] != 0 || m->stateConds[0] != 0 ||
+			m->stateRanges[numStates] != bm->ranges.length ||
+			m->stateConds[numStates] != bm->condRanges.length )
+		return false;
+	for ( long s = 0; s < numStates; s++ ) {
+		if ( m->stateRanges[s] > m->stateRanges[s+1] ||
+				m->stateConds[s] > m->stateConds[s+1] )
+			return false;
+
+		for ( uint32_t r = m->stateRanges[s]; r < m->stateRanges[s+1]; r++ ) {
+			const RlbRange *range = m->ranges + r;
+			if ( range->lowKey > range->highKey || range->trans >= bm->numTrans )
+				return false;
+			if ( r > m->stateRanges[s] && range[-1].highKey >= range->lowKey )
+				return false;
+			if ( range->lowKey < bm->minKey || range->highKey > maxWideKey )
+				return false;
+		}
+
+		for ( uint32_t c = m->stateConds[s]; c < m->stateConds[s+1]; c++ ) {
+			const RlbCondRange *condRange = m->condRanges + c;
+			if ( condRange->condSpace >= bm->condSpaces.length ||
+					condRange->lowKey > condRange->highKey ||
+					condRange->lowKey < bm->minKey ||
+					condRange->highKey > bm->maxKey )
+				return false;
+		}
+
+		ACTION_LIST( m->toStateActions[s] );
+		ACTION_LIST( m->fromStateActions[s] );
+		ACTION_LIST( m->eofActions[s] );
+		if ( m->eofTrans[s] > bm->numTrans )
+			return false;
+	}
+
+	/* Entry points. */
+	for ( uint32_t e = 0; e < bm->entries.length; e++ ) {
+		if ( ! stringOk( m->strings, numStrings, m->entries[e].name ) ||
+				m->entries[e].state >= bm->numStates )
+			return false;
+	}
+
+	m->makeClassRows();
+	return true;
+}
+
+bool RlBlob::load( const void *d, size_t len )
+{
+	close();
+	data = (const char*)d;
+	length = len;
+	return loadData();
+}
+
+bool RlBlob::loadData()
+{
+	const RlbHeader *header = (const RlbHeader*)data;
+	if ( length < sizeof(RlbHeader) || header->magic != RLB_MAGIC )
+		return fail( "not a machine file, or one of the other byte order" );
+
+	if ( header->version != RLB_VERSION )
+		return fail( "machine file version is not supported" );
+
+	if ( header->fileLength != length || header->numMachines >
+			( length - sizeof(RlbHeader) ) / sizeof(RlbMachine) )
+		return fail( "machine file is truncated" );
+
+	nMachines = header->numMachines;
+	machines = new RlMachine[nMachines];
+
+	const RlbMachine *bm = (const RlbMachine*)( data + sizeof(RlbHeader) );
+	for ( int i = 0; i < nMachines; i++ ) {
+		if ( ! loadMachine( machines + i, bm + i ) )
+			return fail( "machine file is corrupt" );
+	}
+
+	errorMsg = 0;
+	return true;
+}
+
+const RlMachine *RlBlob::findMachine( const char *name ) const
+{
+	for ( int i = 0; i < nMachines; i++ ) {
+		if ( strcmp( machines[i].name, name ) == 0 )
+			return machines + i;
+	}
+	return 0;
+}
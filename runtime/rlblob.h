@@ -0,0 +1,359 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _RLBLOB_H
+#define _RLBLOB_H
+
+#include <stddef.h>
+#include "rlbformat.h"
+
+/* Returned by RlMachine::findTrans for keys that no range covers. */
+#define RL_NO_TRANS 0xffffffffu
+
+/* Largest number of entries in the class rows made for small alphabets. */
+#define RL_CLASS_ROWS_LIMIT 4194304
+
+/*
+ * A machine of a loaded file. The tables point into the file. Machines over
+ * alphabets of at most 256 keys and without conditions are also given a row
+ * of transitions over character classes for each state, which is made when
+ * the file is loaded. Other machines search the ranges of the state.
+ */
+struct RlMachine
+{
+	RlMachine();
+	~RlMachine();
+
+	const char *name;
+
+	int64_t minKey;
+	uint64_t alphSize;
+	int keySize;
+	bool keySigned;
+
+	int numStates;
+	int numTrans;
+	int startState;
+	int firstFinal;
+	int errState;
+	int numActions;
+	int numEntries;
+	int numCondSpaces;
+
+	const uint32_t *stateRanges;
+	const RlbRange *ranges;
+	const uint32_t *transTargs;
+	const uint32_t *transActions;
+	const uint32_t *toStateActions;
+	const uint32_t *fromStateActions;
+	const uint32_t *eofActions;
+	const uint32_t *eofTrans;
+	const uint32_t *actionItems;
+	const RlbAction *actions;
+	const uint32_t *stateConds;
+	const RlbCondRange *condRanges;
+	const RlbCondSpace *condSpaces;
+	const uint32_t *condItems;
+	const RlbEntry *entries;
+	const char *strings;
+
+	int numClasses;
+	uint8_t *classMap;
+	uint32_t *classTrans;
+
+	/* Ids of actions and entry points by name, -1 if there is none. */
+	int findAction( const char *name ) const;
+	int findEntry( const char *name ) const;
+
+	const char *actionName( int id ) const
+		{ return strings + actions[id].name; }
+	const char *entryName( int i ) const
+		{ return strings + entries[i].name; }
+
+	bool isFinal( int cs ) const
+		{ return cs >= firstFinal && cs != errState; }
+
+	bool anyConds( int cs ) const
+		{ return stateConds[cs] != stateConds[cs+1]; }
+
+	/* The transition taken by cs on a key, after conditions. */
+	uint32_t findTrans( int cs, int64_t key ) const
+	{
+		if ( classTrans != 0 ) {
+			uint64_t offset = (uint64_t)(key - minKey);
+			if ( offset >= alphSize )
+				return RL_NO_TRANS;
+			return classTrans[(size_t)cs * numClasses + classMap[offset]];
+		}
+
+		const RlbRange *lower = ranges + stateRanges[cs];
+		const RlbRange *upper = ranges + stateRanges[cs+1];
+		while ( lower < upper ) {
+			const RlbRange *mid = lower + ( ( upper - lower ) >> 1 );
+			if ( key < mid->lowKey )
+				upper = mid;
+			else if ( key > mid->highKey )
+				lower = mid + 1;
+			else
+				return mid->trans;
+		}
+		return RL_NO_TRANS;
+	}
+
+	void makeClassRows();
+};
+
+/*
+ * A file written by ragel --blob. Every table is checked when the file is
+ * loaded, so running a machine does no checking of its own. A new file can
+ * be loaded beside one in use and the runs moved over to it; the old one
+ * must stay open until no run uses its machines.
+ */
+class RlBlob
+{
+public:
+	RlBlob();
+	~RlBlob();
+
+	/* Map a file into memory. */
+	bool open( const char *fileName );
+
+	/* Use a file already in memory, which must stay there and be aligned
+	 * to eight bytes. */
+	bool load( const void *data, size_t length );
+
+	void close();
+
+	/* Why open or load failed. */
+	const char *error() const { return errorMsg; }
+
+	int numMachines() const { return nMachines; }
+	const RlMachine *machine( int i ) const { return machines + i; }
+	const RlMachine *findMachine( const char *name ) const;
+
+private:
+	bool fail( const char *msg );
+	bool loadData();
+	bool loadMachine( RlMachine *m, const RlbMachine *bm );
+
+	const char *data;
+	size_t length;
+	void *mapped;
+	RlMachine *machines;
+	int nMachines;
+	const char *errorMsg;
+
+	/* Not copyable. */
+	RlBlob( const RlBlob & );
+	RlBlob &operator=( const RlBlob & );
+};
+
+enum RlJump
+{
+	RlJumpNone,
+	RlJumpAgain,
+	RlJumpBreak
+};
+
+/*
+ * Running a machine over keys of type T, which must be the alphabet type the
+ * machine was written for. The program gives a table of functions indexed by
+ * action id. A missing function does nothing, or is false as a condition.
+ * Functions are passed the run and change it with the members named after
+ * the statements of action code. The value returned is used only when the
+ * action is a condition.
+ */
+template <typename T> struct RlRun
+{
+	typedef bool (*Action)( RlRun<T> &run );
+
+	RlRun( const RlMachine *machine, Action *actionTable, void *user = 0 )
+	:
+		machine(machine), actionTable(actionTable), user(user),
+		cs(machine->startState), ps(machine->startState),
+		p(0), pe(0), eof(0), stack(0), stackSize(0), top(0),
+		jump(RlJumpNone)
+	{}
+
+	const RlMachine *machine;
+	Action *actionTable;
+	void *user;
+
+	int cs, ps;
+	const T *p, *pe, *eof;
+
+	/* Needed by fcall and fret only. */
+	int *stack;
+	int stackSize;
+	int top;
+
+	int jump;
+
+	void init()
+		{ cs = machine->startState; top = 0; }
+
+	/* Run from p to pe, then the eof actions if p reaches eof. */
+	void exec();
+
+	bool isFinal() const { return machine->isFinal( cs ); }
+	bool isError() const { return cs == machine->errState; }
+
+	/* Statements of action code. A call with a full stack or a return with
+	 * an empty one goes to the error state and breaks out. */
+	void fhold() { p -= 1; }
+	void fexec( const T *to ) { p = to - 1; }
+	void fgoto( int targ ) { cs = targ; jump = RlJumpAgain; }
+	void fnext( int targ ) { cs = targ; }
+	void fcall( int targ );
+	void fret();
+	void fbreak() { p += 1; jump = RlJumpBreak; }
+	int fcurs() const { return ps; }
+	int ftargs() const { return cs; }
+
+private:
+	int runActions( uint32_t list );
+	int64_t wideKey( int64_t key );
+};
+
+template <typename T> void RlRun<T>::fcall( int targ )
+{
+	if ( top == stackSize ) {
+		cs = machine->errState;
+		fbreak();
+	}
+	else {
+		stack[top++] = cs;
+		cs = targ;
+		jump = RlJumpAgain;
+	}
+}
+
+template <typename T> void RlRun<T>::fret()
+{
+	if ( top == 0 ) {
+		cs = machine->errState;
+		fbreak();
+	}
+	else {
+		cs = stack[--top];
+		jump = RlJumpAgain;
+	}
+}
+
+template <typename T> int RlRun<T>::runActions( uint32_t list )
+{
+	const uint32_t *acts = machine->actionItems + list;
+	uint32_t nacts = *acts++;
+	jump = RlJumpNone;
+	while ( nacts-- > 0 ) {
+		Action action = actionTable[*acts++];
+		if ( action != 0 ) {
+			action( *this );
+			if ( jump != RlJumpNone )
+				break;
+		}
+	}
+	return jump;
+}
+
+template <typename T> int64_t RlRun<T>::wideKey( int64_t key )
+{
+	const RlbCondRange *cr = machine->condRanges + machine->stateConds[cs];
+	const RlbCondRange *end = machine->condRanges + machine->stateConds[cs+1];
+	for ( ; cr < end; cr++ ) {
+		if ( cr->lowKey <= key && key <= cr->highKey ) {
+			const RlbCondSpace *space = machine->condSpaces + cr->condSpace;
+			const uint32_t *cond = machine->condItems + space->firstCond;
+			int64_t widec = space->baseKey + ( key - machine->minKey );
+			for ( uint32_t c = 0; c < space->numConds; c++ ) {
+				Action action = actionTable[cond[c]];
+				if ( action != 0 && action( *this ) )
+					widec += (int64_t)machine->alphSize << c;
+			}
+			return widec;
+		}
+	}
+	return key;
+}
+
+template <typename T> void RlRun<T>::exec()
+{
+	const RlMachine *m = machine;
+	uint32_t trans;
+
+	if ( p == pe )
+		goto test_eof;
+
+	if ( cs == m->errState )
+		goto out;
+
+resume:
+	if ( m->fromStateActions[cs] != 0 ) {
+		switch ( runActions( m->fromStateActions[cs] ) ) {
+			case RlJumpAgain: goto again;
+			case RlJumpBreak: goto out;
+		}
+	}
+
+	if ( m->anyConds( cs ) )
+		trans = m->findTrans( cs, wideKey( (int64_t)*p ) );
+	else
+		trans = m->findTrans( cs, (int64_t)*p );
+
+	ps = cs;
+	if ( trans == RL_NO_TRANS ) {
+		cs = m->errState;
+		goto again;
+	}
+
+eof_trans:
+	cs = m->transTargs[trans];
+	if ( m->transActions[trans] != 0 ) {
+		if ( runActions( m->transActions[trans] ) == RlJumpBreak )
+			goto out;
+	}
+
+again:
+	if ( m->toStateActions[cs] != 0 ) {
+		switch ( runActions( m->toStateActions[cs] ) ) {
+			case RlJumpAgain: goto again;
+			case RlJumpBreak: goto out;
+		}
+	}
+
+	if ( cs == m->errState )
+		goto out;
+
+	if ( ++p != pe )
+		goto resume;
+
+test_eof:
+	if ( p == eof ) {
+		if ( m->eofTrans[cs] != 0 ) {
+			trans = m->eofTrans[cs] - 1;
+			ps = cs;
+			goto eof_trans;
+		}
+		if ( m->eofActions[cs] != 0 )
+			runActions( m->eofActions[cs] );
+	}
+
+out:
+	jump = RlJumpNone;
+}
+
+#endif
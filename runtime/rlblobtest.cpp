@@ -0,0 +1,288 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/*
+ * Feeds the loader a small machine file, then copies of it that are cut
+ * short or have one field spoiled. The good file must load and run, the
+ * others must be turned away before anything reads outside them.
+ */
+
+#include "rlblob.h"
+#include "vector.h"
+#include <stdio.h>
+#include <string.h>
+
+/* A machine over a to z. State 1 starts and goes to the final state 2 on a
+ * letter. With a condition, state 1 tests it on a to f, and takes the letter
+ * only when it holds. State 0 is the error state. */
+struct TestFile
+{
+	TestFile( bool withCond );
+
+	RlbMachine *machine()
+		{ return (RlbMachine*)( data.data + sizeof(RlbHeader) ); }
+	RlbHeader *header()
+		{ return (RlbHeader*)data.data; }
+
+	template <typename T> T *items( const RlbSection &section )
+		{ return (T*)( data.data + section.offset ); }
+
+	RlbSection section( const void *items, long itemSize, long length );
+	void finish();
+
+	Vector<char> data;
+};
+
+RlbSection TestFile::section( const void *items, long itemSize, long length )
+{
+	while ( data.length() % RLB_ALIGN != 0 )
+		data.append( (char)0 );
+
+	RlbSection section;
+	section.offset = data.length();
+	section.length = length;
+	if ( length > 0 )
+		data.append( (const char*)items, itemSize * length );
+	return section;
+}
+
+TestFile::TestFile( bool withCond )
+{
+	long front = sizeof(RlbHeader) + sizeof(RlbMachine);
+	data.setAsNew( front );
+	memset( data.data, 0, front );
+
+	RlbMachine m;
+	memset( &m, 0, sizeof(m) );
+	m.minKey = 'a';
+	m.maxKey = 'z';
+	m.alphSize = 26;
+	m.keySize = 1;
+	m.keySigned = 1;
+	m.numStates = 3;
+	m.numTrans = 1;
+	m.startState = 1;
+	m.firstFinal = 2;
+	m.errState = 0;
+
+	const char strings[] = "test\0c";
+	uint32_t stateRanges[] = { 0, 0, 1, 1 };
+	RlbRange range = { 'a', 'z', 0, 0 };
+	uint32_t transTargs[] = { 2 };
+	uint32_t transActions[] = { 0 };
+	uint32_t zeros[] = { 0, 0, 0, 0 };
+	uint32_t actionItems[] = { 0 };
+	RlbAction action = { 5, 0 };
+	uint32_t stateConds[] = { 0, 0, 1, 1 };
+	RlbCondRange condRange = { 'a', 'f', 0, 0 };
+	RlbCondSpace condSpace = { 'z' + 1, 0, 1 };
+	uint32_t condItems[] = { 0 };
+
+	/* With the condition the letters a to f are taken on the wide keys
+	 * where it holds. */
+	RlbRange condRanges[] = {
+		{ 'g', 'z', 0, 0 },
+		{ 'z' + 1 + 26, 'z' + 1 + 26 + 5, 0, 0 }
+	};
+	if ( withCond ) {
+		stateRanges[2] = stateRanges[3] = 2;
+		m.ranges = section( condRanges, sizeof(RlbRange), 2 );
+	}
+	else {
+		m.ranges = section( &range, sizeof(RlbRange), 1 );
+	}
+
+	m.strings = section( strings, 1, sizeof(strings) );
+	m.stateRanges = section( stateRanges, sizeof(uint32_t), 4 );
+	m.transTargs = section( transTargs, sizeof(uint32_t), 1 );
+	m.transActions = section( transActions, sizeof(uint32_t), 1 );
+	m.toStateActions = section( zeros, sizeof(uint32_t), 3 );
+	m.fromStateActions = section( zeros, sizeof(uint32_t), 3 );
+	m.eofActions = section( zeros, sizeof(uint32_t), 3 );
+	m.eofTrans = section( zeros, sizeof(uint32_t), 3 );
+	m.actionItems = section( actionItems, sizeof(uint32_t), 1 );
+	m.actions = section( &action, sizeof(RlbAction), withCond ? 1 : 0 );
+	m.stateConds = section( withCond ? stateConds : zeros, sizeof(uint32_t), 4 );
+	m.condRanges = section( &condRange, sizeof(RlbCondRange), withCond ? 1 : 0 );
+	m.condSpaces = section( &condSpace, sizeof(RlbCondSpace), withCond ? 1 : 0 );
+	m.condItems = section( condItems, sizeof(uint32_t), withCond ? 1 : 0 );
+	m.entries = section( 0, sizeof(RlbEntry), 0 );
+
+	memcpy( machine(), &m, sizeof(RlbMachine) );
+	finish();
+}
+
+void TestFile::finish()
+{
+	while ( data.length() % RLB_ALIGN != 0 )
+		data.append( (char)0 );
+
+	RlbHeader h;
+	h.magic = RLB_MAGIC;
+	h.version = RLB_VERSION;
+	h.numMachines = 1;
+	h.fileLength = data.length();
+	memcpy( data.data, &h, sizeof(RlbHeader) );
+}
+
+static int failures = 0;
+
+static void expect( bool cond, const char *what )
+{
+	if ( !cond ) {
+		printf( "FAILED: %s\n", what );
+		failures += 1;
+	}
+}
+
+static void expectLoad( TestFile &file, long length, bool loads, const char *what )
+{
+	RlBlob blob;
+	bool loaded = blob.load( file.data.data, length );
+	expect( loaded == loads, what );
+	if ( !loaded )
+		expect( blob.error() != 0, "a failed load gives its reason" );
+}
+
+static bool condHolds;
+
+static bool cond( RlRun<char> & )
+{
+	return condHolds;
+}
+
+static int run( const RlMachine *m, const char *input )
+{
+	RlRun<char>::Action table[1] = { cond };
+	RlRun<char> run( m, table, 0 );
+	run.p = input;
+	run.pe = input + strlen( input );
+	run.eof = run.pe;
+	run.exec();
+	return run.cs;
+}
+
+int main()
+{
+	/* The good files load and run. */
+	TestFile plain( false );
+	RlBlob blob;
+	expect( blob.load( plain.data.data, plain.data.length() ), "plain file loads" );
+	if ( blob.numMachines() == 1 ) {
+		const RlMachine *m = blob.findMachine( "test" );
+		expect( m != 0 && run( m, "q" ) == 2, "plain machine takes a letter" );
+		expect( m != 0 && run( m, "5" ) == 0, "plain machine fails on a digit" );
+	}
+
+	TestFile withCond( true );
+	expect( blob.load( withCond.data.data, withCond.data.length() ),
+			"file with a condition loads" );
+	if ( blob.numMachines() == 1 ) {
+		const RlMachine *m = blob.machine( 0 );
+		condHolds = true;
+		expect( run( m, "b" ) == 2, "condition that holds takes the letter" );
+		condHolds = false;
+		expect( run( m, "b" ) == 0, "condition that fails does not" );
+		expect( run( m, "x" ) == 2, "letter without the condition is taken" );
+	}
+
+	/* Cut short, with and without the length in the header agreeing. */
+	for ( long cut = 8; cut < plain.data.length(); cut += 8 ) {
+		expectLoad( plain, plain.data.length() - cut, false,
+				"truncated file is turned away" );
+
+		TestFile file( false );
+		file.header()->fileLength -= cut;
+		expectLoad( file, file.data.length() - cut, false,
+				"truncated file with a matching length is turned away" );
+	}
+
+	{
+		TestFile file( false );
+		file.machine()->alphSize = 256;
+		expectLoad( file, file.data.length(), false,
+				"alphabet size that disagrees with the keys" );
+	}
+
+	{
+		/* The class rows would be made for keys past the end of them. */
+		TestFile file( false );
+		file.machine()->maxKey = 'a' + 999;
+		file.items<RlbRange>( file.machine()->ranges )[0].highKey = 'a' + 999;
+		expectLoad( file, file.data.length(), false,
+				"alphabet size smaller than the keys" );
+	}
+
+	{
+		TestFile file( false );
+		file.machine()->minKey = 'z' + 1;
+		expectLoad( file, file.data.length(), false, "min key above max key" );
+	}
+
+	{
+		TestFile file( false );
+		file.items<RlbRange>( file.machine()->ranges )[0].highKey = 'z' + 200;
+		expectLoad( file, file.data.length(), false,
+				"range above the alphabet" );
+	}
+
+	{
+		TestFile file( false );
+		file.items<RlbRange>( file.machine()->ranges )[0].lowKey = 'a' - 100;
+		expectLoad( file, file.data.length(), false,
+				"range below the alphabet" );
+	}
+
+	{
+		TestFile file( true );
+		file.items<RlbRange>( file.machine()->ranges )[1].highKey = 'z' + 1 + 52;
+		expectLoad( file, file.data.length(), false,
+				"range above the wide keys" );
+	}
+
+	{
+		TestFile file( true );
+		file.items<RlbCondRange>( file.machine()->condRanges )[0].highKey = 'z' + 1;
+		expectLoad( file, file.data.length(), false,
+				"condition range above the alphabet" );
+	}
+
+	{
+		TestFile file( true );
+		file.items<RlbCondSpace>( file.machine()->condSpaces )[0].baseKey = 'm';
+		expectLoad( file, file.data.length(), false,
+				"condition space inside the alphabet" );
+	}
+
+	{
+		TestFile file( true );
+		file.items<RlbCondSpace>( file.machine()->condSpaces )[0].baseKey =
+				INT64_MAX - 10;
+		expectLoad( file, file.data.length(), false,
+				"condition space past the largest key" );
+	}
+
+	{
+		TestFile file( false );
+		file.machine()->ranges.offset += 4;
+		expectLoad( file, file.data.length(), false, "misaligned section" );
+	}
+
+	if ( failures == 0 )
+		printf( "rlblobtest: passed\n" );
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,246 @@
+/*  This file is part of Ragel.
+ *
+ *  Ragel is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  Ragel is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with Ragel; if not, write to the Free Software
+ *  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _RLEXEC_H
+#define _RLEXEC_H
+
+/*
+ * The engine run by machines written with -T0 --constexpr. It needs C++17.
+ *
+ * The tables of a machine are constexpr members of a struct named after the
+ * machine. The engine is a template over the struct, so the parts of the
+ * loop for features the machine does not have are not compiled, and the
+ * machines of a program share the one engine.
+ */
+
+/* Labels the engine may not jump to, for the features a machine lacks. */
+#if defined(__GNUC__)
+#define RL_EXEC_LABEL_UNUSED __attribute__((unused))
+#else
+#define RL_EXEC_LABEL_UNUSED
+#endif
+
+/* Returned by the action code to say where the engine goes next. */
+enum RlExecJump
+{
+	RlExecNone,
+	RlExecAgain,
+	RlExecBreak,
+	RlExecTestEof
+};
+
+/* What the engine knows of a machine. A program may specialize it to turn
+ * off a feature the machine has but a run will not use. */
+template <typename M> struct RlTraits
+{
+	typedef typename M::key_type Key;
+	typedef typename M::wide_key_type WideKey;
+
+	static constexpr bool hasActions = M::has_actions;
+	static constexpr bool hasToStateActions = M::has_to_state_actions;
+	static constexpr bool hasFromStateActions = M::has_from_state_actions;
+	static constexpr bool hasEofActions = M::has_eof_actions;
+	static constexpr bool hasEofTrans = M::has_eof_trans;
+	static constexpr bool hasConds = M::has_conds;
+	static constexpr bool hasIndicies = M::has_indicies;
+	static constexpr bool hasError = M::has_error;
+};
+
+/* Run the action list at the given offset, stopping at a jump. */
+template <typename M, typename Act>
+	inline int rlExecActions( int list, int ps, Act &act )
+{
+	const auto *acts = M::actions + list;
+	unsigned int nacts = *acts++;
+	while ( nacts-- > 0 ) {
+		int jump = act( *acts++, ps );
+		if ( jump != RlExecNone )
+			return jump;
+	}
+	return RlExecNone;
+}
+
+/*
+ * Run machine M from p to pe, then the eof actions if p reaches eof. The
+ * generated code passes functions for the key at p, for the actions and eof
+ * actions, which are given the action id and the state left, and for the
+ * conditions, which are given the action id. With NoEnd there is no pe and
+ * the run stops only by leaving the action code.
+ */
+template <typename M, bool NoEnd = false, typename CS, typename P,
+		typename PE, typename E, typename GetKey, typename Act,
+		typename EofAct, typename Cond>
+	inline void rlExec( CS &cs, P *&p, PE pe, E eof, GetKey key, Act act,
+		EofAct eofAct, Cond cond )
+{
+	typedef RlTraits<M> T;
+	typedef typename T::WideKey WideKey;
+
+	int ps = cs;
+	unsigned int trans = 0;
+	int keys, klen, lower, upper, mid;
+	WideKey widec;
+
+	if constexpr ( !NoEnd ) {
+		if ( p == pe )
+			goto test_eof;
+	}
+
+	if constexpr ( T::hasError ) {
+		if ( cs == M::error )
+			goto out;
+	}
+
+resume:
+	if constexpr ( T::hasFromStateActions ) {
+		switch ( rlExecActions<M>( M::from_state_actions[cs], ps, act ) ) {
+			case RlExecAgain: goto again;
+			case RlExecBreak: goto out;
+		}
+	}
+
+	widec = key();
+	if constexpr ( T::hasConds ) {
+		keys = M::cond_offsets[cs] * 2;
+		klen = M::cond_lengths[cs];
+		lower = keys;
+		upper = keys + ( klen << 1 ) - 2;
+		while ( lower <= upper ) {
+			mid = lower + ( ( ( upper - lower ) >> 1 ) & ~1 );
+			if ( widec < M::cond_keys[mid] )
+				upper = mid - 2;
+			else if ( widec > M::cond_keys[mid+1] )
+				lower = mid + 2;
+			else {
+				int space = M::cond_spaces[M::cond_offsets[cs] +
+						( ( mid - keys ) >> 1 )];
+				int first = M::cond_space_offsets[space];
+				int last = M::cond_space_offsets[space+1];
+				widec = (WideKey)( M::cond_space_base[space] +
+						( key() - M::min_key ) );
+				for ( int c = first; c < last; c++ ) {
+					if ( cond( M::cond_space_conds[c] ) )
+						widec = (WideKey)( widec + ( M::alph_size << ( c - first ) ) );
+				}
+				break;
+			}
+		}
+	}
+
+	keys = M::key_offsets[cs];
+	trans = M::index_offsets[cs];
+
+	klen = M::single_lengths[cs];
+	if ( klen > 0 ) {
+		lower = keys;
+		upper = keys + klen - 1;
+		while ( lower <= upper ) {
+			mid = lower + ( ( upper - lower ) >> 1 );
+			if ( widec < M::trans_keys[mid] )
+				upper = mid - 1;
+			else if ( widec > M::trans_keys[mid] )
+				lower = mid + 1;
+			else {
+				trans += (unsigned int)( mid - keys );
+				goto match;
+			}
+		}
+		keys += klen;
+		trans += klen;
+	}
+
+	klen = M::range_lengths[cs];
+	if ( klen > 0 ) {
+		lower = keys;
+		upper = keys + ( klen << 1 ) - 2;
+		while ( lower <= upper ) {
+			mid = lower + ( ( ( upper - lower ) >> 1 ) & ~1 );
+			if ( widec < M::trans_keys[mid] )
+				upper = mid - 2;
+			else if ( widec > M::trans_keys[mid+1] )
+				lower = mid + 2;
+			else {
+				trans += (unsigned int)( ( mid - keys ) >> 1 );
+				goto match;
+			}
+		}
+		trans += klen;
+	}
+
+match:
+	if constexpr ( T::hasIndicies )
+		trans = M::indicies[trans];
+
+eof_trans: RL_EXEC_LABEL_UNUSED;
+	ps = cs;
+	cs = M::trans_targs[trans];
+
+	if constexpr ( T::hasActions ) {
+		if ( M::trans_actions[trans] != 0 ) {
+			switch ( rlExecActions<M>( M::trans_actions[trans], ps, act ) ) {
+				case RlExecBreak: goto out;
+			}
+		}
+	}
+
+again: RL_EXEC_LABEL_UNUSED;
+	if constexpr ( T::hasToStateActions ) {
+		switch ( rlExecActions<M>( M::to_state_actions[cs], ps, act ) ) {
+			case RlExecAgain: goto again;
+			case RlExecBreak: goto out;
+		}
+	}
+
+	if constexpr ( T::hasError ) {
+		if ( cs == M::error )
+			goto out;
+	}
+
+	if constexpr ( NoEnd ) {
+		p += 1;
+		goto resume;
+	}
+	else {
+		if ( ++p != pe )
+			goto resume;
+	}
+
+test_eof: RL_EXEC_LABEL_UNUSED;
+	if constexpr ( T::hasEofTrans || T::hasEofActions ) {
+		if ( p == eof ) {
+			if constexpr ( T::hasEofTrans ) {
+				if ( M::eof_trans[cs] > 0 ) {
+					trans = M::eof_trans[cs] - 1;
+					goto eof_trans;
+				}
+			}
+
+			if constexpr ( T::hasEofActions ) {
+				switch ( rlExecActions<M>( M::eof_actions[cs], ps, eofAct ) ) {
+					case RlExecAgain: goto again;
+					case RlExecTestEof: goto test_eof;
+					case RlExecBreak: goto out;
+				}
+			}
+		}
+	}
+
+out: RL_EXEC_LABEL_UNUSED;
+	return;
+}
+
+#endif
@@ -0,0 +1,106 @@
+/*
+ * @LANG: c++
+ * @BLOB: yes
+ * @CFLAGS: -I../runtime -I../aapl ../runtime/rlblob.cpp
+ *
+ * Words, numbers behind a condition and a stop that breaks out. The same
+ * machine is also written with --blob and run by the engine in runtime,
+ * with functions in place of the actions, which must print the same and
+ * stop in the same place as the exec code.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <string>
+#include "rlblob.h"
+
+std::string out;
+
+%%{
+	machine blob1;
+
+	action small { fc < '5' }
+	action word { out += 'w'; }
+	action num { out += 'n'; }
+	action stop { out += '!'; fbreak; }
+
+	main := (
+		[a-z]+ ' ' @word |
+		'N' ( digit when small )+ ';' @num |
+		'!' @stop
+	)*;
+}%%
+
+%% write data;
+
+bool small( RlRun<char> &run ) { return *run.p < '5'; }
+bool word( RlRun<char> &run ) { out += 'w'; return false; }
+bool num( RlRun<char> &run ) { out += 'n'; return false; }
+bool stop( RlRun<char> &run ) { out += '!'; run.fbreak(); return false; }
+
+const RlMachine *machine;
+RlRun<char>::Action table[16];
+
+const char *result( bool final, bool error )
+{
+	return final ? "ACCEPT" : error ? "FAIL" : "PARTIAL";
+}
+
+void test( const char *buf )
+{
+	int cs;
+	const char *p = buf;
+	const char *pe = buf + strlen( buf );
+
+	out.clear();
+	%% write init;
+	%% write exec;
+
+	std::string exec_out = out;
+	const char *exec_res = result( cs >= blob1_first_final, cs == blob1_error );
+	int exec_at = p - buf;
+
+	out.clear();
+	RlRun<char> run( machine, table );
+	run.p = buf;
+	run.pe = pe;
+	run.exec();
+
+	const char *res = result( run.isFinal(), run.isError() );
+	int at = run.p - buf;
+	printf( "%s %s at %d%s\n", out.c_str(), res, at,
+			out == exec_out && res == exec_res && at == exec_at ?
+			"" : " differs" );
+}
+
+int main()
+{
+	RlBlob blob;
+	if ( ! blob.open( "blob1.rlb" ) ) {
+		printf( "%s\n", blob.error() );
+		return 1;
+	}
+
+	machine = blob.findMachine( "blob1" );
+	table[machine->findAction( "small" )] = small;
+	table[machine->findAction( "word" )] = word;
+	table[machine->findAction( "num" )] = num;
+	table[machine->findAction( "stop" )] = stop;
+
+	test( "abc def N12;" );
+	test( "N0;N1234;x " );
+	test( "ab N15;" );
+	test( "word !more words " );
+	test( "abc" );
+	test( "a!" );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+wwn ACCEPT at 12
+nnw ACCEPT at 11
+w FAIL at 5
+w! ACCEPT at 6
+ PARTIAL at 3
+ FAIL at 1
+#endif
@@ -0,0 +1,86 @@
+/*
+ * @LANG: c
+ * @CFLAGS: -pthread
+ *
+ * Lines of words and quoted fields. Buffers large enough are run by write
+ * chunks on several threads, with chunks starting inside words and inside
+ * quotes, and must end in the same state as the exec code.
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+%%{
+	machine chunks1;
+
+	main := (
+		( [a-z]+ | '"' [^"]* '"' ) ( ',' | '\n' )
+	)*;
+}%%
+
+%% write data;
+%% write chunks;
+
+char big[300000];
+
+void test( const char *buf, int len )
+{
+	int cs, chunk_cs;
+	const char *p = buf;
+	const char *pe = buf + len;
+
+	%% write init;
+	chunk_cs = chunks1_chunk_exec( cs, p, pe, 4 );
+	%% write exec;
+
+	if ( cs >= chunks1_first_final )
+		printf( "ACCEPT" );
+	else if ( cs == chunks1_error )
+		printf( "FAIL" );
+	else
+		printf( "PARTIAL" );
+	printf( chunk_cs == cs ? " same\n" : " differs\n" );
+}
+
+/* Repeats a line until the buffer is nearly full, leaving room for an end. */
+int fill( const char *line )
+{
+	int len = 0, n = strlen( line );
+	while ( len + n < (int)sizeof(big) - 16 ) {
+		memcpy( big + len, line, n );
+		len += n;
+	}
+	return len;
+}
+
+int main()
+{
+	int len;
+
+	test( "abc,\"d,e\"\n", 10 );
+	test( "abc,\"d", 6 );
+
+	/* Thirty characters a line, so 200010 starts a word. */
+	len = fill( "alpha,\"a quoted, field\",beta\n" );
+	test( big, len );
+
+	big[200010] = 'X';
+	test( big, len );
+
+	len = fill( "one,\"two\nthree\",four\n" );
+	memcpy( big + len, "\"open", 5 );
+	test( big, len + 5 );
+
+	memcpy( big + len, "five\n", 5 );
+	test( big, len + 5 );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+ACCEPT same
+PARTIAL same
+ACCEPT same
+FAIL same
+PARTIAL same
+ACCEPT same
+#endif
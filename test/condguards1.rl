@@ -0,0 +1,67 @@
+/*
+ * @LANG: c
+ * @COMPARE_FLAGS: --cond-guards
+ *
+ * Three condition spaces in different states. With --cond-guards they share
+ * their keys and the states tell them apart, which must not change what is
+ * matched.
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+%%{
+	machine condguards1;
+
+	action lo { fc < '5' }
+	action hi { fc >= '5' }
+	action even { ( fc - '0' ) % 2 == 0 }
+	action dig { printf( "%c", fc ); }
+
+	main := (
+		'a' ( digit when lo )+ $dig ';' |
+		'b' ( digit when hi )+ $dig ';' |
+		'c' ( digit when lo when even )+ $dig ';'
+	)*;
+}%%
+
+%% write data;
+
+void test( const char *buf )
+{
+	int cs;
+	const char *p = buf;
+	const char *pe = buf + strlen( buf );
+
+	%% write init;
+	%% write exec;
+
+	if ( cs >= condguards1_first_final )
+		printf( " ACCEPT\n" );
+	else
+		printf( " FAIL at %d\n", (int)(p - buf) );
+}
+
+int main()
+{
+	test( "a123;b987;c024;" );
+	test( "a1234;" );
+	test( "a1237;" );
+	test( "b55;a44;" );
+	test( "b554;" );
+	test( "c2424;c0;" );
+	test( "c243;" );
+	test( "c246;" );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+123987024 ACCEPT
+1234 ACCEPT
+123 FAIL at 4
+5544 ACCEPT
+55 FAIL at 3
+24240 ACCEPT
+24 FAIL at 3
+24 FAIL at 3
+#endif
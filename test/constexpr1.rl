@@ -0,0 +1,70 @@
+/*
+ * @LANG: c++
+ * @ALLOW_GENFLAGS: -T0
+ * @COMPARE_FLAGS: --constexpr
+ * @CFLAGS: -std=c++17 -I../runtime
+ *
+ * Words, numbers behind a condition and a stop that breaks out. With
+ * --constexpr the tables are members of a struct run by the template engine
+ * in rlexec.h, which must print the same and stop in the same place as the
+ * -T0 code.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include "rlexec.h"
+
+%%{
+	machine constexpr1;
+
+	action small { fc < '5' }
+	action word { printf( "w" ); }
+	action num { printf( "n" ); }
+	action stop { printf( "!" ); fbreak; }
+
+	main := (
+		[a-z]+ ' ' @word |
+		'N' ( digit when small )+ ';' @num |
+		'!' @stop
+	)*;
+}%%
+
+%% write data;
+
+void test( const char *buf )
+{
+	int cs;
+	const char *p = buf;
+	const char *pe = buf + strlen( buf );
+
+	%% write init;
+	%% write exec;
+
+	if ( cs >= constexpr1_first_final )
+		printf( " ACCEPT" );
+	else if ( cs == constexpr1_error )
+		printf( " FAIL" );
+	else
+		printf( " PARTIAL" );
+	printf( " at %d\n", (int)(p - buf) );
+}
+
+int main()
+{
+	test( "abc def N12;" );
+	test( "N0;N1234;x " );
+	test( "ab N15;" );
+	test( "word !more words " );
+	test( "abc" );
+	test( "a!" );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+wwn ACCEPT at 12
+nnw ACCEPT at 11
+w FAIL at 5
+w! ACCEPT at 6
+ PARTIAL at 3
+ FAIL at 1
+#endif
@@ -0,0 +1,50 @@
+/*
+ * @LANG: c
+ *
+ * An x seven characters before the current one. Determinizing it takes a
+ * state for each mix of the last eight characters being x or not, made in
+ * waves of 64 and then 128 states, large enough for --determinize-parallel
+ * to fill them on the threads. The machine must be the one the serial fill
+ * makes.
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+%%{
+	machine fillwave1;
+
+	action hit { printf( " %d", (int)(fpc - buf) ); }
+
+	main := ( any* 'x' any{7} ) @hit;
+}%%
+
+%% write data;
+
+void test( const char *buf )
+{
+	int cs;
+	const char *p = buf;
+	const char *pe = buf + strlen( buf );
+
+	%% write init;
+	%% write exec;
+
+	printf( "\n" );
+}
+
+int main()
+{
+	test( "x1234567" );
+	test( "abcdefgh" );
+	test( "xx_xyz____x____________" );
+	test( "the extra exits next to the exact box exist" );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+ 7
+
+ 7 8 10 17
+ 12 18 25 36
+#endif
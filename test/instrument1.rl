@@ -0,0 +1,60 @@
+/*
+ * @LANG: c
+ * @COMPARE_FLAGS: --instrument
+ *
+ * Words and small numbers, the numbers behind a condition. With --instrument
+ * every state entered and key taken is counted, in the states with
+ * conditions after the wide key is known. Counting must not change what is
+ * matched.
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+%%{
+	machine instrument1;
+
+	action small { fc < '5' }
+	action word { printf( "word " ); }
+	action num { printf( "num " ); }
+
+	main := (
+		[a-z]+ ' ' @word |
+		'N' ( digit when small )+ ';' @num
+	)*;
+}%%
+
+%% write data;
+
+void test( const char *buf )
+{
+	int cs;
+	const char *p = buf;
+	const char *pe = buf + strlen( buf );
+
+	%% write init;
+	%% write exec;
+
+	if ( cs >= instrument1_first_final )
+		printf( "ACCEPT\n" );
+	else
+		printf( "FAIL at %d\n", (int)(p - buf) );
+}
+
+int main()
+{
+	test( "abc N12;de " );
+	test( "N0;N1234;N4;" );
+	test( "x N15;" );
+	test( "Nab;" );
+	test( "this and that " );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+word num word ACCEPT
+num num num ACCEPT
+word FAIL at 4
+FAIL at 1
+word word word ACCEPT
+#endif
@@ -0,0 +1,65 @@
+/*
+ * @LANG: c
+ * @ALLOW_GENFLAGS: -T0
+ * @RAGEL_FLAGS: --lazy
+ * @COMPARE_FLAGS: --lazy-states=4
+ *
+ * Strings of a and b with an a fourth from the end, which as a DFA needs a
+ * state for each of the last four keys. The expected output is that of the
+ * machine made by the default styles. With --lazy-states=4 the cache fills
+ * and starts again, which must not change the result. The code styles do
+ * not apply, so only one is run.
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+%%{
+	machine lazy1;
+
+	main := [ab]* 'a' [ab] [ab] [ab];
+}%%
+
+%% write lazy;
+
+struct lazy1_lazy m;
+
+void test( const char *buf )
+{
+	const char *p = buf;
+	const char *pe = buf + strlen( buf );
+
+	lazy1_lazy_init( &m );
+	p = lazy1_lazy_exec( &m, p, pe );
+
+	if ( lazy1_lazy_final( &m ) )
+		printf( "ACCEPT\n" );
+	else if ( m.cs < 0 )
+		printf( "FAIL at %d\n", (int)(p - buf) );
+	else
+		printf( "PARTIAL\n" );
+}
+
+int main()
+{
+	test( "abbb" );
+	test( "bbbb" );
+	test( "abababbbaaababbbabaabbbbaaab" );
+	test( "abababbbaaababbbabaabbbbabab" );
+	test( "abababbbaaababbbabaabbbbbaab" );
+	test( "aaaaaaaaaaaaaaaaaaaaaaaaaaaa" );
+	test( "abbbabbc" );
+	test( "ab" );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+ACCEPT
+PARTIAL
+ACCEPT
+ACCEPT
+PARTIAL
+ACCEPT
+FAIL at 7
+PARTIAL
+#endif
@@ -0,0 +1,54 @@
+/*
+ * @LANG: c
+ * @ALLOW_GENFLAGS: -T0 -F1
+ * @ALLOW_MINFLAGS: -m
+ *
+ * An x twelve characters before the current one, which takes 8192 states.
+ * The first partition of --minimize-parallel puts the final and the other
+ * states in blocks of 4096, large enough to be sorted and split with all
+ * the threads, and the machine must be the one -m makes. The tables styles
+ * keep the code small enough to compile quickly.
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+%%{
+	machine minimize2;
+
+	main := any* 'x' any{12};
+}%%
+
+%% write data;
+
+/* Runs a key at a time, printing where the machine is in a final state. */
+void test( const char *buf )
+{
+	int cs;
+	const char *p = buf, *pe;
+	const char *end = buf + strlen( buf );
+
+	%% write init;
+	for ( pe = buf + 1; pe <= end; pe++ ) {
+		%% write exec;
+		if ( cs >= minimize2_first_final )
+			printf( " %d", (int)(p - buf) - 1 );
+	}
+	printf( "\n" );
+}
+
+int main()
+{
+	test( "x123456789abc" );
+	test( "x123456789ab" );
+	test( "the extra exits next to the exact box exist" );
+	test( "xxxxxxxxxxxxxxxxxxxx" );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+ 12
+
+ 17 23 30 41
+ 12 13 14 15 16 17 18 19
+#endif
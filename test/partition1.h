@@ -0,0 +1,9 @@
+#ifndef _PARTITION1_H
+#define _PARTITION1_H
+
+struct partition1
+{
+	int cs;
+};
+
+#endif
@@ -0,0 +1,68 @@
+/*
+ * @LANG: c
+ * @ALLOW_GENFLAGS: -T0 -P2
+ * @COMPARE_FLAGS: -P0 --partition-size=12
+ * @COMPARE_FLAGS: -P0 --partition-size=40
+ *
+ * Keywords and numbers. With -P0 --partition-size the machine is split
+ * into as many partitions as it takes to keep each under the size, and
+ * moving between them must take the same transitions as the default code.
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+#include "partition1.h"
+
+%%{
+	machine partition1;
+	variable cs fsm->cs;
+
+	action kw { printf( "%c", fc ); }
+	action num { printf( "#" ); }
+
+	main := (
+		(
+			'alpha' @kw | 'bravo' @kw | 'charlie' @kw | 'delta' @kw |
+			'echo' @kw | 'foxtrot' @kw | [0-9]+ %num
+		) ' '+
+	)*;
+}%%
+
+%% write data;
+struct partition1 the_fsm;
+
+void test( char *buf )
+{
+	struct partition1 *fsm = &the_fsm;
+	char *p = buf;
+	char *pe = buf + strlen( buf );
+
+	%% write init;
+	%% write exec;
+
+	if ( fsm->cs >= partition1_first_final )
+		printf( " ACCEPT\n" );
+	else if ( fsm->cs == partition1_error )
+		printf( " FAIL at %d\n", (int)(p - buf) );
+	else
+		printf( " PARTIAL\n" );
+}
+
+int main()
+{
+	test( "alpha bravo charlie delta echo foxtrot " );
+	test( "12 echo 345 " );
+	test( "foxtrat " );
+	test( "delta  7" );
+	test( "charl" );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+aoeaot ACCEPT
+#o# ACCEPT
+ FAIL at 5
+a PARTIAL
+ PARTIAL
+#endif
@@ -0,0 +1,110 @@
+/*
+ * @LANG: c
+ * @COMPARE_FLAGS: --prefilter
+ *
+ * Unanchored searches, started again after each match. With --prefilter
+ * the start state scans ahead for a character that can begin a match,
+ * using vector compares for the first machine's two characters and a table
+ * for the second's six. The same matches must be found.
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+%%{
+	machine few;
+
+	action found {
+		printf( "few: match ending at %d\n", (int)(fpc - buf) );
+		fbreak;
+	}
+
+	main := any* ( 'foo' | 'bar' ) @found;
+}%%
+
+%% write data;
+
+%%{
+	machine many;
+
+	action found {
+		printf( "many: match ending at %d\n", (int)(fpc - buf) );
+		fbreak;
+	}
+
+	main := any* (
+		'alpha' | 'bravo' | 'charlie' | 'delta' | 'echo' | 'foxtrot'
+	) @found;
+}%%
+
+%% write data;
+
+void test_few( const char *buf )
+{
+	int cs;
+	const char *p = buf;
+	const char *pe = buf + strlen( buf );
+
+	/* Look again after each match, from the start state. */
+	%%{ machine few; }%%
+	while ( p != pe ) {
+		%% write init;
+		%% write exec;
+	}
+	printf( "few: done\n" );
+}
+
+void test_many( const char *buf )
+{
+	int cs;
+	const char *p = buf;
+	const char *pe = buf + strlen( buf );
+
+	/* Look again after each match, from the start state. */
+	%%{ machine many; }%%
+	while ( p != pe ) {
+		%% write init;
+		%% write exec;
+	}
+	printf( "many: done\n" );
+}
+
+void test( const char *buf )
+{
+	test_few( buf );
+	test_many( buf );
+}
+
+int main()
+{
+	test( "there is nothing to be found in this line of text" );
+	test( "a long run of text before the word foo comes along" );
+	test( "fo fob ba bat boo barfoo" );
+	test( "the charlie and delta and echo" );
+	test( "ech alph foxtro bravo" );
+	test( "bar" );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+few: done
+many: done
+few: match ending at 37
+few: done
+many: done
+few: match ending at 20
+few: match ending at 23
+few: done
+many: done
+few: done
+many: match ending at 10
+many: match ending at 20
+many: match ending at 29
+many: done
+few: done
+many: match ending at 20
+many: done
+few: match ending at 2
+few: done
+many: done
+#endif
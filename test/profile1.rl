@@ -0,0 +1,64 @@
+/*
+ * @LANG: c
+ * @COMPARE_FLAGS: --profile-use=profile1.prof
+ *
+ * Words and numbers separated by spaces and commas. The profile was taken
+ * with --instrument over the inputs below, where words are far more common
+ * than numbers. Ordering the states and picking the default transitions by
+ * it must not change what is matched.
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+int words, numbers;
+
+%%{
+	machine profile1;
+
+	action word { words++; }
+	action number { numbers++; }
+
+	main := (
+		( [a-z]+ %word | [0-9]+ %number ) [ ,]+
+	)*;
+}%%
+
+%% write data;
+
+void test( const char *buf )
+{
+	int cs;
+	const char *p = buf;
+	const char *pe = buf + strlen( buf );
+
+	words = numbers = 0;
+
+	%% write init;
+	%% write exec;
+
+	if ( cs >= profile1_first_final )
+		printf( "ACCEPT %d %d\n", words, numbers );
+	else
+		printf( "FAIL at %d\n", (int)(p - buf) );
+}
+
+int main()
+{
+	test( "the quick brown fox jumps over the lazy dog " );
+	test( "one, two, three and 4 more, " );
+	test( "a b c d e f g h i j k l m n o p 16 " );
+	test( "words, words and more words, 3 " );
+	test( "no Capitals " );
+	test( "12ab " );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+ACCEPT 9 0
+ACCEPT 5 1
+ACCEPT 16 1
+ACCEPT 5 1
+FAIL at 3
+FAIL at 2
+#endif
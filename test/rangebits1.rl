@@ -0,0 +1,70 @@
+/*
+ * @LANG: c
+ * @COMPARE_FLAGS: --range-bitmaps
+ *
+ * The states of identifiers and operators have many ranges going to a few
+ * targets. With --range-bitmaps the goto styles test them against bitmaps,
+ * which must take the same transitions as the compare trees.
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+int idents, numbers, ops;
+
+%%{
+	machine rangebits1;
+
+	action ident { idents++; }
+	action number { numbers++; }
+	action op { ops++; }
+
+	main := (
+		(
+			[A-Za-z_] [A-Za-z0-9_]* %ident |
+			[0-9]+ %number |
+			[+\-*/%=<>!&|^~]+ %op
+		) ' '+
+	)*;
+}%%
+
+%% write data;
+
+void test( const char *buf )
+{
+	int cs;
+	const char *p = buf;
+	const char *pe = buf + strlen( buf );
+
+	idents = numbers = ops = 0;
+
+	%% write init;
+	%% write exec;
+
+	if ( cs >= rangebits1_first_final )
+		printf( "ACCEPT %d %d %d\n", idents, numbers, ops );
+	else
+		printf( "FAIL at %d\n", (int)(p - buf) );
+}
+
+int main()
+{
+	test( "a = b + 42 " );
+	test( "_x1 <<= y_2 ^ ~ z " );
+	test( "Foo != bar && 7 || Baz9 " );
+	test( "a = (b) " );
+	test( "x += 1; " );
+	test( "count  --   " );
+	test( "count-- " );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+ACCEPT 2 1 2
+ACCEPT 3 0 3
+ACCEPT 3 1 3
+FAIL at 4
+FAIL at 6
+ACCEPT 1 0 1
+FAIL at 5
+#endif
@@ -0,0 +1,78 @@
+/*
+ * @LANG: c
+ * @ALLOW_GENFLAGS: -G0 -G1 -G2 -G3
+ * @COMPARE_FLAGS: --range-bitmaps
+ *
+ * As rangebits1, over int keys. They span too much for the -G3 class jump
+ * tables, so -G3 tests its states with compare trees and the bitmaps must
+ * be used there as well.
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+int idents, numbers, ops;
+
+%%{
+	machine rangebits2;
+	alphtype int;
+
+	action ident { idents++; }
+	action number { numbers++; }
+	action op { ops++; }
+
+	main := (
+		(
+			[A-Za-z_] [A-Za-z0-9_]* %ident |
+			[0-9]+ %number |
+			[+\-*/%=<>!&|^~]+ %op
+		) ' '+
+	)*;
+}%%
+
+%% write data;
+
+void test( const char *str )
+{
+	int cs;
+	int buf[64];
+	int len = strlen( str );
+	const int *p = buf;
+	const int *pe = buf + len;
+	int i;
+
+	for ( i = 0; i < len; i++ )
+		buf[i] = str[i];
+
+	idents = numbers = ops = 0;
+
+	%% write init;
+	%% write exec;
+
+	if ( cs >= rangebits2_first_final )
+		printf( "ACCEPT %d %d %d\n", idents, numbers, ops );
+	else
+		printf( "FAIL at %d\n", (int)(p - buf) );
+}
+
+int main()
+{
+	test( "a = b + 42 " );
+	test( "_x1 <<= y_2 ^ ~ z " );
+	test( "Foo != bar && 7 || Baz9 " );
+	test( "a = (b) " );
+	test( "x += 1; " );
+	test( "count  --   " );
+	test( "count-- " );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+ACCEPT 2 1 2
+ACCEPT 3 0 3
+ACCEPT 3 1 3
+FAIL at 4
+FAIL at 6
+ACCEPT 1 0 1
+FAIL at 5
+#endif
@@ -0,0 +1,76 @@
+/*
+ * @LANG: c
+ * @COMPARE_FLAGS: --skip-loops
+ *
+ * Strings, comments and tags loop on themselves until one of a few
+ * characters. With --skip-loops those states scan ahead to the next one,
+ * which must find the same ends, also when the input runs out first.
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+%%{
+	machine skiploop1;
+
+	action str { printf( "string ends at %d\n", (int)(fpc - buf) ); }
+	action comment { printf( "comment ends at %d\n", (int)(fpc - buf) ); }
+	action tag { printf( "tag ends at %d\n", (int)(fpc - buf) ); }
+
+	main := (
+		[a-z]+ ' ' |
+		'"' [^"]* '"' @str |
+		'#' [^\n]* '\n' @comment |
+		'<' [^<>&]* '>' @tag
+	)*;
+}%%
+
+%% write data;
+
+void test( const char *buf )
+{
+	int cs;
+	const char *p = buf;
+	const char *pe = buf + strlen( buf );
+
+	%% write init;
+	%% write exec;
+
+	if ( cs >= skiploop1_first_final )
+		printf( "ACCEPT\n" );
+	else if ( cs == skiploop1_error )
+		printf( "FAIL at %d\n", (int)(p - buf) );
+	else
+		printf( "PARTIAL\n" );
+}
+
+int main()
+{
+	test( "abc \"\"def \"x\"" );
+	test( "\"a string that is longer than sixteen characters\"" );
+	test( "# a comment running past the first block of sixteen\nabc " );
+	test( "<tag with some attributes=1 and more of them>x " );
+	test( "\"a string that does not end before the input does" );
+	test( "<tag & more>" );
+	test( "# one\n# two\n\"three\"<four>" );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+string ends at 5
+string ends at 12
+ACCEPT
+string ends at 48
+ACCEPT
+comment ends at 51
+ACCEPT
+tag ends at 44
+ACCEPT
+PARTIAL
+FAIL at 5
+comment ends at 5
+comment ends at 11
+string ends at 18
+tag ends at 24
+ACCEPT
+#endif
@@ -0,0 +1,9 @@
+#ifndef _SPLIT1_H
+#define _SPLIT1_H
+
+struct split1
+{
+	int cs;
+};
+
+#endif
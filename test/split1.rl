@@ -0,0 +1,64 @@
+/*
+ * @LANG: c
+ * @ALLOW_GENFLAGS: -T0 -T1 -F0 -F1 -G0 -G1 -G2 -G4 -P2
+ *
+ * With -P2 the error state lies in one partition and most of the states
+ * going to it in the other. The machine must stop on the character that
+ * failed, not carry on past it. The -G4 state functions take the machine
+ * the same way.
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+#include "split1.h"
+
+%%{
+	machine split1;
+	variable cs fsm->cs;
+
+	main := (
+		'alpha' | 'bravo' | 'charlie' | 'delta' | 'echo' | 'foxtrot'
+	) ( ' ' | '\n' )+;
+}%%
+
+%% write data;
+struct split1 the_fsm;
+
+void test( char *buf )
+{
+	struct split1 *fsm = &the_fsm;
+	char *p = buf;
+	char *pe = buf + strlen( buf );
+
+	%% write init;
+	%% write exec;
+
+	if ( fsm->cs >= split1_first_final )
+		printf( "ACCEPT\n" );
+	else if ( fsm->cs == split1_error )
+		printf( "FAIL at %d\n", (int)(p - buf) );
+	else
+		printf( "FAIL\n" );
+}
+
+int main()
+{
+	test( "alpha\n" );
+	test( "charlie  \n" );
+	test( "foxtrat\n" );
+	test( "delta\nx" );
+	test( "ech" );
+	test( "bravo bravo\n" );
+
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+ACCEPT
+ACCEPT
+FAIL at 5
+FAIL at 6
+FAIL
+FAIL at 6
+#endif
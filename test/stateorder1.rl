@@ -0,0 +1,66 @@
+/*
+ * @LANG: c
+ * @COMPARE_FLAGS: --state-order=dfs
+ * @COMPARE_FLAGS: --state-order=bfs
+ * @COMPARE_FLAGS: --state-order=affinity
+ *
+ * Keywords sharing prefixes, with a loop over numbers. Each --state-order
+ * numbers and lays out the states differently, which must not change what
+ * is matched or where the final states start.
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+%%{
+	machine stateorder1;
+
+	action kw { printf( "%c", fc ); }
+	action num { printf( "#" ); }
+
+	main := (
+		(
+			'if' @kw | 'in' @kw | 'int' @kw | 'for' @kw | 'float' @kw |
+			'while' @kw | [0-9]+ ( '.' [0-9]+ )? %num
+		) ' '+
+	)*;
+}%%
+
+%% write data;
+
+void test( const char *buf )
+{
+	int cs;
+	const char *p = buf;
+	const char *pe = buf + strlen( buf );
+
+	%% write init;
+	%% write exec;
+
+	if ( cs >= stateorder1_first_final )
+		printf( " ACCEPT\n" );
+	else if ( cs == stateorder1_error )
+		printf( " FAIL at %d\n", (int)(p - buf) );
+	else
+		printf( " PARTIAL\n" );
+}
+
+int main()
+{
+	test( "if in int for float while " );
+	test( "12 3.5 float 42 " );
+	test( "for 1. " );
+	test( "fort " );
+	test( "while 7" );
+	test( "whi" );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+fnntrte ACCEPT
+##t# ACCEPT
+r FAIL at 6
+r FAIL at 3
+e PARTIAL
+ PARTIAL
+#endif
@@ -0,0 +1,101 @@
+/*
+ * @LANG: c
+ *
+ * Words and numbers, counting the numbers in an action. Ten streams are
+ * advanced together by write streams, which stops each before the action,
+ * and are finished with the exec code. They must end the same as running
+ * the exec code over each alone.
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+int nums;
+
+%%{
+	machine streams1;
+
+	action num { nums++; }
+
+	main := ( [a-z]+ ' ' | [0-9]+ ' ' @num )*;
+}%%
+
+%% write data;
+%% write streams;
+
+const char *inputs[] = {
+	"abc def ",
+	"12 ab 34 ",
+	"",
+	"a b c d e f g h i j k l m n o p ",
+	"one 2 three 4 five 6 ",
+	"abc!def ",
+	"xyz",
+	"777",
+	"a 1 b 2 c 3 d 4 e 5 ",
+	"the end "
+};
+
+/* The goto styles do not switch on the error state, so streams that
+ * stopped in it are left there. */
+int finish( int cs, const char *p, const char *pe )
+{
+	if ( cs != streams1_error ) {
+		%% write exec;
+	}
+	return cs;
+}
+
+void result( int cs )
+{
+	if ( cs >= streams1_first_final )
+		printf( "ACCEPT" );
+	else if ( cs == streams1_error )
+		printf( "FAIL" );
+	else
+		printf( "PARTIAL" );
+}
+
+int main()
+{
+	struct streams1_stream streams[10];
+	int exec_cs[10], exec_nums[10], i, cs;
+
+	for ( i = 0; i < 10; i++ ) {
+		nums = 0;
+		exec_cs[i] = finish( streams1_start, inputs[i], 
+				inputs[i] + strlen( inputs[i] ) );
+		exec_nums[i] = nums;
+
+		streams[i].cs = streams1_start;
+		streams[i].p = inputs[i];
+		streams[i].pe = inputs[i] + strlen( inputs[i] );
+	}
+
+	printf( "stopped %d\n", streams1_stream_exec( streams, 10 ) );
+
+	for ( i = 0; i < 10; i++ ) {
+		nums = 0;
+		cs = finish( streams[i].cs, streams[i].p, streams[i].pe );
+		printf( "%d: ", i );
+		result( cs );
+		printf( " %d", nums );
+		printf( cs == exec_cs[i] && nums == exec_nums[i] ? 
+				" same\n" : " differs\n" );
+	}
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+stopped 3
+0: ACCEPT 0 same
+1: ACCEPT 2 same
+2: ACCEPT 0 same
+3: ACCEPT 0 same
+4: ACCEPT 3 same
+5: FAIL 0 same
+6: PARTIAL 0 same
+7: PARTIAL 0 same
+8: ACCEPT 5 same
+9: ACCEPT 0 same
+#endif
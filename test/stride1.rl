@@ -0,0 +1,93 @@
+/*
+ * @LANG: c
+ *
+ * Words, numbers counted by an action, and digits behind a condition.
+ * write stride steps two keys at a time up to the first action or
+ * condition, and the exec code finishes from there. The result must be
+ * the same as running the exec code alone, for odd and even lengths.
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+int nums;
+
+%%{
+	machine stride1;
+
+	action small { fc < '5' }
+	action num { nums++; }
+
+	main := (
+		[a-z]+ ' ' |
+		[0-9]+ ' ' @num |
+		'<' ( digit when small )+ '>'
+	)*;
+}%%
+
+%% write data;
+%% write stride;
+
+/* The goto styles do not switch on the error state, so runs that stopped
+ * in it are left there. */
+int finish( int cs, const char *p, const char *pe )
+{
+	if ( cs != stride1_error ) {
+		%% write exec;
+	}
+	return cs;
+}
+
+void test( const char *buf )
+{
+	int cs, exec_cs, exec_nums;
+	const char *p = buf;
+	const char *pe = buf + strlen( buf );
+
+	nums = 0;
+	exec_cs = finish( stride1_start, p, pe );
+	exec_nums = nums;
+
+	nums = 0;
+	cs = stride1_start;
+	p = stride1_stride_exec( &cs, p, pe );
+	printf( "stopped at %d: ", (int)(p - buf) );
+	cs = finish( cs, p, pe );
+
+	if ( cs >= stride1_first_final )
+		printf( "ACCEPT" );
+	else if ( cs == stride1_error )
+		printf( "FAIL" );
+	else
+		printf( "PARTIAL" );
+	printf( " %d", nums );
+	printf( cs == exec_cs && nums == exec_nums ? " same\n" : " differs\n" );
+}
+
+int main()
+{
+	test( "" );
+	test( "abc " );
+	test( "abcd " );
+	test( "hello there world " );
+	test( "one 22 three " );
+	test( "four <1234>five " );
+	test( "<12>9 " );
+	test( "abc d!ef " );
+	test( "abcde" );
+	test( "<1239>" );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+stopped at 0: ACCEPT 0 same
+stopped at 4: ACCEPT 0 same
+stopped at 5: ACCEPT 0 same
+stopped at 18: ACCEPT 0 same
+stopped at 6: ACCEPT 1 same
+stopped at 6: ACCEPT 0 same
+stopped at 1: ACCEPT 1 same
+stopped at 5: FAIL 0 same
+stopped at 5: PARTIAL 0 same
+stopped at 1: FAIL 0 same
+#endif
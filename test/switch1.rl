@@ -0,0 +1,70 @@
+/*
+ * @LANG: c
+ * @COMPARE_FLAGS: --switch-density=1
+ * @COMPARE_FLAGS: --switch-density=50
+ *
+ * Escapes in a quoted string and codes. The state after the backslash has a
+ * few keys spread over a wide span and the state after x fills its span. With
+ * --switch-density the goto styles switch on the key in the states covered
+ * densely enough, which must take the same transitions as the compare trees.
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+%%{
+	machine switch1;
+
+	action out { printf( "%c", fc ); }
+	action nl { printf( "<nl>" ); }
+	action tab { printf( "<tab>" ); }
+	action quote { printf( "<q>" ); }
+	action bs { printf( "<bs>" ); }
+	action zero { printf( "<0>" ); }
+	action code { printf( " [%c]", fc ); }
+
+	main := (
+		'"' (
+			[^"\\] @out |
+			'\\' ( 'n' @nl | 't' @tab | '"' @quote | '\\' @bs | '0' @zero )
+		)* '"' |
+		'x' ( '1' 'a' | '2' 'b' | '3' 'c' | '4' 'd' ) @code
+	)*;
+}%%
+
+%% write data;
+
+void test( const char *buf )
+{
+	int cs;
+	const char *p = buf;
+	const char *pe = buf + strlen( buf );
+
+	%% write init;
+	%% write exec;
+
+	if ( cs >= switch1_first_final )
+		printf( " ACCEPT\n" );
+	else
+		printf( " FAIL at %d\n", (int)(p - buf) );
+}
+
+int main()
+{
+	test( "\"plain\"" );
+	test( "\"tab\\there\\nand \\\"quoted\\\" \\\\ \\0\"" );
+	test( "x1ax4d\"x\"x2b" );
+	test( "\"bad \\q\"" );
+	test( "x3d" );
+	test( "\"open" );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+plain ACCEPT
+tab<tab>here<nl>and <q>quoted<q> <bs> <0> ACCEPT
+ [a] [d]x [b] ACCEPT
+bad  FAIL at 6
+ FAIL at 2
+open FAIL at 5
+#endif
@@ -0,0 +1,79 @@
+/*
+ * @LANG: c
+ * @ALLOW_GENFLAGS: -G4
+ * @ALLOW_MINFLAGS: -n -m
+ * @CFLAGS: -O0
+ *
+ * The -G4 state functions must not grow the stack with the input, even
+ * unoptimized and without musttail. One exec runs over a few million keys.
+ * The c action reads fcurs so the functions carry the previous state too.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+struct tailcall1
+{
+	int cs;
+	int count;
+	int last;
+};
+
+%%{
+	machine tailcall1;
+	variable cs fsm->cs;
+
+	main := (
+		'a' >{ fsm->count += 1; } 'b'* |
+		'c' @{ fsm->last = fcurs; }
+	)*;
+}%%
+
+%% write data;
+struct tailcall1 the_fsm;
+
+void test( char *buf, int len )
+{
+	struct tailcall1 *fsm = &the_fsm;
+	char *p = buf;
+	char *pe = buf + len;
+
+	%% write init;
+	fsm->count = 0;
+	fsm->last = -1;
+	%% write exec;
+
+	if ( fsm->cs >= tailcall1_first_final )
+		printf( "ACCEPT %d %d\n", fsm->count, fsm->last >= 0 );
+	else
+		printf( "FAIL at %d\n", (int)(p - buf) );
+}
+
+#define BIG (1 << 22)
+
+int main()
+{
+	char *buf = malloc( BIG );
+	int i;
+
+	test( "abbcab", 6 );
+	test( "abxa", 4 );
+
+	for ( i = 0; i < BIG; i++ )
+		buf[i] = i % 4 == 0 ? 'a' : 'b';
+	test( buf, BIG );
+
+	buf[BIG - 1] = 'c';
+	test( buf, BIG );
+
+	free( buf );
+	return 0;
+}
+
+#ifdef _____OUTPUT_____
+ACCEPT 2 1
+FAIL at 2
+ACCEPT 1048576 0
+ACCEPT 1048576 1
+#endif